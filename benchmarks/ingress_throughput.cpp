@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+#include "../include/ingress.h"
+#include "../include/lockfree_queue.h"
+#include "../include/message.h"
+#include "../include/config.h"
+#include <thread>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+using namespace MessageRouter;
+
+static void BM_IngressTcpThroughput(benchmark::State& state) {
+    int connections = state.range(0);
+    
+    IngressConfig config;
+    config.enabled = true;
+    config.tcp_port = 0;
+    
+    std::vector<std::shared_ptr<MessageQueue>> queues;
+    for (int i = 0; i < 4; ++i) {
+        queues.push_back(std::make_shared<MessageQueue>());
+    }
+    
+    for (auto _ : state) {
+        IngressServer server(config, queues);
+        IngressLoadClient client(config.bind_address, server.get_tcp_port(), connections, 0);
+        
+        std::atomic<bool> draining{true};
+        std::thread drain([&]() {
+            Message message;
+            while (draining.load(std::memory_order_relaxed)) {
+                bool any = false;
+                for (auto& queue : queues) {
+                    while (queue->try_pop(message)) {
+                        any = true;
+                    }
+                }
+                if (!any) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        
+        server.start();
+        client.start();
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        
+        client.stop();
+        server.stop();
+        draining.store(false);
+        drain.join();
+        
+        state.SetItemsProcessed(state.items_processed() + server.get_messages_received());
+        state.SetBytesProcessed(state.bytes_processed() + server.get_bytes_received());
+        state.counters["dropped"] = static_cast<double>(server.get_messages_dropped());
+    }
+}
+
+BENCHMARK(BM_IngressTcpThroughput)->Arg(1)->Arg(4)->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
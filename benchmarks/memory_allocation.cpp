@@ -1,8 +1,10 @@
 #include <benchmark/benchmark.h>
 #include "../include/lockfree_queue.h"
 #include "../include/message.h"
+#include "../include/payload_arena.h"
 #include <vector>
 #include <memory>
+#include <cstring>
 
 using namespace MessageRouter;
 
@@ -85,10 +87,80 @@ static void BM_MessageMoving(benchmark::State& state) {
     state.SetBytesProcessed(state.iterations() * sizeof(Message));
 }
 
+// One body delivered to range(0) consumers, range(1) bytes each. The copy
+// variant gives every consumer its own arena block; the shared variant
+// writes the body once and fans out a refcounted handle. Consumers check
+// the body and release it in batches.
+static void fan_out_payloads(benchmark::State& state, bool shared) {
+    const size_t consumers = state.range(0);
+    const size_t body_bytes = state.range(1);
+    constexpr size_t kMessages = 64;
+    
+    PayloadConfig config;
+    config.slots_per_class = 4096;
+    PayloadArenas arenas(config, 1);
+    PayloadArena* arena = arenas.arena(0);
+    std::vector<std::unique_ptr<LockFreeSPSCQueue<Message, 1024>>> queues;
+    std::vector<std::unique_ptr<PayloadReleaser>> releasers;
+    for (size_t i = 0; i < consumers; ++i) {
+        queues.push_back(std::make_unique<LockFreeSPSCQueue<Message, 1024>>());
+        releasers.push_back(std::make_unique<PayloadReleaser>(arenas));
+    }
+    
+    std::vector<uint8_t> source(body_bytes);
+    SequenceNumber sequence = 0;
+    uint64_t mismatches = 0;
+    
+    for (auto _ : state) {
+        for (size_t i = 0; i < kMessages; ++i) {
+            Message message(0, 0, ++sequence, 0);
+            message.payload_kind = PayloadKind::Arena;
+            message.payload_size = static_cast<uint16_t>(body_bytes);
+            fill_payload(source.data(), body_bytes, sequence);
+            
+            if (shared) {
+                std::memcpy(arena->allocate(body_bytes, message.payload_handle), source.data(), body_bytes);
+                arenas.share(message, static_cast<uint32_t>(consumers));
+                for (auto& queue : queues) {
+                    queue->try_push(message);
+                }
+            } else {
+                for (auto& queue : queues) {
+                    std::memcpy(arena->allocate(body_bytes, message.payload_handle), source.data(), body_bytes);
+                    queue->try_push(message);
+                }
+            }
+        }
+        
+        for (size_t i = 0; i < consumers; ++i) {
+            Message received;
+            while (queues[i]->try_pop(received)) {
+                mismatches += !check_payload(arenas.data(received), received.payload_size, received.sequence_number);
+                releasers[i]->release(received);
+            }
+            releasers[i]->flush();
+        }
+    }
+    
+    benchmark::DoNotOptimize(mismatches);
+    state.SetItemsProcessed(state.iterations() * kMessages * consumers);
+    state.SetBytesProcessed(state.iterations() * kMessages * consumers * body_bytes);
+}
+
+static void BM_PayloadFanOutCopy(benchmark::State& state) {
+    fan_out_payloads(state, false);
+}
+
+static void BM_PayloadFanOutSharedHandle(benchmark::State& state) {
+    fan_out_payloads(state, true);
+}
+
 BENCHMARK(BM_QueueMemoryAllocation)->UseRealTime();
 BENCHMARK(BM_MessageMemoryAllocation)->UseRealTime();
 BENCHMARK(BM_SharedPtrMemoryAllocation)->UseRealTime();
 BENCHMARK(BM_MessageCopying)->UseRealTime();
 BENCHMARK(BM_MessageMoving)->UseRealTime();
+BENCHMARK(BM_PayloadFanOutCopy)->ArgsProduct({{1, 4, 16}, {256, 4096}})->UseRealTime();
+BENCHMARK(BM_PayloadFanOutSharedHandle)->ArgsProduct({{1, 4, 16}, {256, 4096}})->UseRealTime();
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -2,10 +2,14 @@
 #include "../include/lockfree_queue.h"
 #include "../include/message.h"
 #include "../include/config.h"
+#include "../include/batch_classifier.h"
+#include "../include/ordering_buffer.h"
+#include "../include/perf_counters.h"
 #include <thread>
 #include <vector>
 #include <atomic>
 #include <memory>
+#include <random>
 
 using namespace MessageRouter;
 
@@ -102,8 +106,217 @@ static void BM_RoutingScaling(benchmark::State& state) {
     state.SetBytesProcessed(state.iterations() * sizeof(Message));
 }
 
+// Stage1 routing of one 64-message batch across 8 processors, drained after
+// every batch so only the routing work is measured
+using BenchQueue = LockFreeSPSCQueue<Message, 4096>;
+
+static std::unique_ptr<SystemConfig> make_routing_config() {
+    auto config = std::make_unique<SystemConfig>();
+    config->processors.count = 8;
+    for (int msg_type = 0; msg_type < 16; ++msg_type) {
+        config->stage1_rules.push_back({static_cast<MessageType>(msg_type), {static_cast<ProcessorId>(msg_type % 8)}});
+    }
+    return config;
+}
+
+static std::vector<Message> make_routing_batch() {
+    std::mt19937 rng(42);
+    std::vector<Message> batch;
+    for (size_t i = 0; i < BatchClassifier::kBatchSize; ++i) {
+        batch.emplace_back(static_cast<MessageType>(rng() % 16), 0, i, 0);
+    }
+    return batch;
+}
+
+// Hardware cost per message as counters, where perf events are permitted
+static void report_perf_costs(benchmark::State& state, const PerfCounters& perf, uint64_t messages) {
+    if (!perf.is_open()) {
+        return;
+    }
+    PerfSample sample;
+    perf.read(sample);
+    const PerfCost cost = per_message(sample, messages);
+    if (cost.cycles >= 0) {
+        state.counters["cycles/msg"] = cost.cycles;
+    }
+    if (cost.ipc >= 0) {
+        state.counters["IPC"] = cost.ipc;
+    }
+    if (cost.llc_misses >= 0) {
+        state.counters["llc_miss/msg"] = cost.llc_misses;
+    }
+    if (cost.branch_misses >= 0) {
+        state.counters["br_miss/msg"] = cost.branch_misses;
+    }
+}
+
+static void drain_queues(std::vector<std::unique_ptr<BenchQueue>>& queues) {
+    Message received;
+    for (auto& queue : queues) {
+        while (queue->try_pop(received)) {
+        }
+    }
+}
+
+// The router loop before batching: rule lookup, bounds check and push per message
+static void BM_RouteBatchScalarLoop(benchmark::State& state) {
+    auto config = make_routing_config();
+    auto batch = make_routing_batch();
+    std::vector<std::unique_ptr<BenchQueue>> queues;
+    for (int i = 0; i < 8; ++i) {
+        queues.push_back(std::make_unique<BenchQueue>());
+    }
+    
+    PerfCounters perf;
+    perf.open();
+    for (auto _ : state) {
+        for (const Message& message : batch) {
+            ProcessorId processor_id = config->get_processor_for_message(message.msg_type);
+            if (processor_id < queues.size()) {
+                queues[processor_id]->try_push(message);
+            }
+        }
+        drain_queues(queues);
+    }
+    
+    state.SetItemsProcessed(state.iterations() * batch.size());
+    report_perf_costs(state, perf, state.iterations() * batch.size());
+}
+
+// Classify + histogram + scatter, then one bulk push per processor; arg is the ClassifierIsa
+static void BM_RouteBatchClassified(benchmark::State& state) {
+    auto config = make_routing_config();
+    auto batch = make_routing_batch();
+    std::vector<std::unique_ptr<BenchQueue>> queues;
+    for (int i = 0; i < 8; ++i) {
+        queues.push_back(std::make_unique<BenchQueue>());
+    }
+    std::array<uint32_t, 256> destinations;
+    for (size_t msg_type = 0; msg_type < destinations.size(); ++msg_type) {
+        destinations[msg_type] = config->get_processor_for_message(static_cast<MessageType>(msg_type));
+    }
+    BatchClassifier classifier(destinations, queues.size(), static_cast<ClassifierIsa>(state.range(0)));
+    state.SetLabel(classifier.kernel_name());
+    
+    Message staging[BatchClassifier::kBatchSize];
+    uint16_t begin[BatchClassifier::kMaxGroups + 2];
+    PerfCounters perf;
+    perf.open();
+    for (auto _ : state) {
+        classifier.partition(batch.data(), batch.size(), staging, begin);
+        for (size_t group = 0; group < classifier.num_groups(); ++group) {
+            queues[classifier.group_output(group)]->try_push_batch(staging + begin[group],
+                                                                   begin[group + 1] - begin[group]);
+        }
+        drain_queues(queues);
+    }
+    
+    state.SetItemsProcessed(state.iterations() * batch.size());
+    report_perf_costs(state, perf, state.iterations() * batch.size());
+}
+
+// The type -> processor lookup alone; arg is the ClassifierIsa
+static void BM_ClassifyKernel(benchmark::State& state) {
+    auto config = make_routing_config();
+    auto batch = make_routing_batch();
+    std::array<uint32_t, 256> destinations;
+    for (size_t msg_type = 0; msg_type < destinations.size(); ++msg_type) {
+        destinations[msg_type] = config->get_processor_for_message(static_cast<MessageType>(msg_type));
+    }
+    BatchClassifier classifier(destinations, 8, static_cast<ClassifierIsa>(state.range(0)));
+    state.SetLabel(classifier.kernel_name());
+    
+    uint8_t dest[BatchClassifier::kBatchSize];
+    for (auto _ : state) {
+        classifier.classify(batch.data(), batch.size(), dest);
+        benchmark::DoNotOptimize(dest);
+        benchmark::ClobberMemory();
+    }
+    
+    state.SetItemsProcessed(state.iterations() * batch.size());
+}
+
+// Producers number sequences across their types, so every (producer, type)
+// stream skips numbers; one message in 16 arrives twice. Nothing is held.
+static void BM_OrderingBufferForward(benchmark::State& state) {
+    constexpr ProducerId kProducers = 4;
+    constexpr size_t kMessages = 256;
+    OrderingBuffer buffer(1024);
+    auto output = std::make_shared<MessageQueue>();
+    SequenceNumber next_sequence[kProducers] = {};
+    
+    PerfCounters perf;
+    perf.open();
+    for (auto _ : state) {
+        for (size_t i = 0; i < kMessages; ++i) {
+            const ProducerId producer = static_cast<ProducerId>(i % kProducers);
+            const Message message(static_cast<MessageType>((i / kProducers) % 4), producer,
+                                  next_sequence[producer]++, 0);
+            buffer.add_message(message, output);
+            if (i % 16 == 15) {
+                buffer.add_message(message, output);
+            }
+        }
+        
+        Message received;
+        while (output->try_pop(received)) {
+            benchmark::DoNotOptimize(received);
+        }
+    }
+    
+    const size_t messages = kMessages + kMessages / 16;
+    state.SetItemsProcessed(state.iterations() * messages);
+    state.counters["peak_buffered"] = buffer.get_peak_buffer_size();
+    state.counters["duplicates"] = buffer.get_messages_duplicate();
+    report_perf_costs(state, perf, state.iterations() * messages);
+}
+
+// The output queue stays full: each round range(0) messages per producer
+// wait in the pool, then the consumer frees as many slots and the streams'
+// next arrivals send what their stream held
+static void BM_OrderingBufferBackpressure(benchmark::State& state) {
+    const size_t burst = state.range(0);
+    constexpr ProducerId kProducers = 4;
+    OrderingBuffer buffer(2 * kProducers * burst);
+    auto output = std::make_shared<MessageQueue>();
+    while (output->try_push(Message(0, kProducers, 0, 0))) {
+    }
+    SequenceNumber next_sequence[kProducers] = {};
+    
+    PerfCounters perf;
+    perf.open();
+    for (auto _ : state) {
+        for (ProducerId producer = 0; producer < kProducers; ++producer) {
+            for (size_t i = 0; i < burst; ++i) {
+                const SequenceNumber sequence = next_sequence[producer]++;
+                buffer.add_message(Message(static_cast<MessageType>(sequence % 4), producer, sequence, 0), output);
+            }
+        }
+        
+        Message received;
+        for (size_t i = 0; i < kProducers * burst && output->try_pop(received); ++i) {
+            benchmark::DoNotOptimize(received);
+        }
+    }
+    
+    state.SetItemsProcessed(state.iterations() * kProducers * burst);
+    state.counters["peak_buffered"] = buffer.get_peak_buffer_size();
+    state.counters["dropped"] = buffer.get_messages_dropped();
+    report_perf_costs(state, perf, state.iterations() * kProducers * burst);
+}
+
 BENCHMARK(BM_RoutingLatency)->UseManualTime();
 BENCHMARK(BM_RoutingThroughput)->UseRealTime();
 BENCHMARK(BM_RoutingScaling)->Range(1, 16)->UseRealTime();
+BENCHMARK(BM_RouteBatchScalarLoop);
+BENCHMARK(BM_RouteBatchClassified)->Arg(static_cast<int>(ClassifierIsa::Scalar))
+                                  ->Arg(static_cast<int>(ClassifierIsa::Avx2))
+                                  ->Arg(static_cast<int>(ClassifierIsa::Avx512));
+BENCHMARK(BM_ClassifyKernel)->Arg(static_cast<int>(ClassifierIsa::Scalar))
+                            ->Arg(static_cast<int>(ClassifierIsa::Avx2))
+                            ->Arg(static_cast<int>(ClassifierIsa::Avx512));
+
+BENCHMARK(BM_OrderingBufferForward);
+BENCHMARK(BM_OrderingBufferBackpressure)->Arg(8)->Arg(64)->Arg(512);
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include <benchmark/benchmark.h>
 #include "../include/lockfree_queue.h"
 #include "../include/message.h"
+#include "../include/tsc_clock.h"
+#include <chrono>
 #include <vector>
 
 using namespace MessageRouter;
@@ -57,8 +59,31 @@ static void BM_MessageCreation(benchmark::State& state) {
 }
 
 
+static void BM_HighResolutionClockNow(benchmark::State& state) {
+    for (auto _ : state) {
+        uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        benchmark::DoNotOptimize(timestamp);
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+
+
+static void BM_TscClockNow(benchmark::State& state) {
+    for (auto _ : state) {
+        uint64_t timestamp = TscClock::now();
+        benchmark::DoNotOptimize(timestamp);
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+
+
 BENCHMARK(BM_QueuePushPop)->Range(1, 100000);
 BENCHMARK(BM_QueueFill)->Range(1, 1000);
 BENCHMARK(BM_MessageCreation)->Range(1, 1000000);
+BENCHMARK(BM_HighResolutionClockNow);
+BENCHMARK(BM_TscClockNow);
 
 BENCHMARK_MAIN();
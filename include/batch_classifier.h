@@ -0,0 +1,74 @@
+#pragma once
+
+#include "message.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace MessageRouter {
+
+enum class ClassifierIsa {
+    Auto,       // best kernel the CPU supports
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+// Routes a popped batch by msg_type in one pass instead of message by
+// message: a table lookup turns every msg_type into a group, one per output
+// the table uses, a histogram of the groups sizes each destination's range,
+// and the messages are scattered into a staging buffer grouped by
+// destination, so the router pushes each output queue once per batch.
+// With 256 message types there are at most 256 groups, so the lookup
+// stays byte-wide however many outputs there are. The lookup runs as
+// AVX-512 (VBMI) or AVX2 code when the CPU has it (checked once, at
+// construction) and as a scalar loop otherwise.
+class BatchClassifier {
+public:
+    static constexpr size_t kBatchSize = 64;
+    // At most one group per msg_type
+    static constexpr size_t kMaxGroups = 256;
+
+    // destinations[t] is the output for msg_type t; anything >= num_outputs
+    // is unroutable. A requested ISA the CPU lacks falls back to the next one down.
+    BatchClassifier(const std::array<uint32_t, 256>& destinations, size_t num_outputs,
+                    ClassifierIsa isa = ClassifierIsa::Auto);
+
+    // Output for a single message type; num_outputs() when unroutable
+    uint32_t destination(MessageType msg_type) const { return output_table_[msg_type]; }
+
+    // Writes each message's group (or num_groups() when unroutable) into dest
+    void classify(const Message* batch, size_t count, uint8_t* dest) const {
+        kernel_(byte_table_.data(), word_table_.data(), batch, count, dest);
+    }
+
+    // Copies batch (count <= kBatchSize) into staging grouped by output,
+    // keeping arrival order within each group. Group g, bound for
+    // group_output(g), occupies staging[begin[g]] .. staging[begin[g + 1]]
+    // and unroutable messages take the tail from begin[num_groups()]; begin
+    // needs num_groups() + 2 entries, at most kMaxGroups + 2.
+    void partition(const Message* batch, size_t count, Message* staging, uint16_t* begin) const;
+
+    size_t num_outputs() const { return num_outputs_; }
+    // Groups are the outputs some msg_type maps to, in ascending output order
+    size_t num_groups() const { return num_groups_; }
+    uint32_t group_output(size_t group) const { return group_outputs_[group]; }
+    const char* kernel_name() const { return kernel_name_; }
+
+private:
+    using Kernel = void (*)(const uint8_t* byte_table, const uint32_t* word_table,
+                           const Message* batch, size_t count, uint8_t* dest);
+
+    // The same type -> group mapping twice: bytes for scalar and in-register
+    // lookups, words for AVX2 gathers
+    alignas(64) std::array<uint8_t, 256> byte_table_;
+    alignas(64) std::array<uint32_t, 256> word_table_;
+    std::array<uint32_t, 256> output_table_;
+    std::array<uint32_t, kMaxGroups> group_outputs_;
+    size_t num_outputs_;
+    size_t num_groups_;
+    Kernel kernel_;
+    const char* kernel_name_;
+};
+
+} // namespace MessageRouter
@@ -12,16 +12,34 @@ struct ProducerConfig {
     int count;
     int messages_per_sec;
     std::map<std::string, double> distribution;
+    // Open loop: send on a fixed intended schedule and stamp messages with the
+    // intended send time, so pipeline stalls show up as latency, not lower load
+    bool open_loop = false;
+    uint64_t schedule_lag_tolerance_ns = 1000;
+};
+
+struct ProcessorAutoscaleConfig {
+    bool enabled = false;
+    int min_active = 1;
+    uint64_t sample_interval_us = 1000;
+    uint64_t scale_up_depth = 4096;      // stage1 backlog per active worker
+    uint64_t scale_down_depth = 64;
+    double scale_up_utilization = 0.9;
+    double scale_down_utilization = 0.3;
+    uint64_t scale_down_hold_ms = 50;
 };
 
 struct ProcessorConfig {
     int count;
     std::map<std::string, uint64_t> processing_times_ns;
+    ProcessorAutoscaleConfig autoscale;
 };
 
 struct StrategyConfig {
     int count;
     std::map<std::string, uint64_t> processing_times_ns;
+    int scheduler_threads = 0; // 0 = one dedicated thread per strategy
+    size_t conflation_keys = 4096;  // latest-value slots per strategy with conflated rules
 };
 
 struct Stage1Rule {
@@ -33,6 +51,166 @@ struct Stage2Rule {
     MessageType msg_type;
     StrategyId strategy;
     bool ordering_required;
+    bool conflate = false;  // deliver only the latest message per (producer, type)
+};
+
+// Record every message crossing a stage boundary to a capture file.
+// stage: "producers" | "stage1" | "processors" | "stage2" (messages leaving it)
+struct CaptureConfig {
+    bool enabled = false;
+    std::string file;
+    std::string stage = "producers";
+};
+
+// Replace the synthetic producers with a capture file.
+// speed: 1.0 = original timing, N = N times faster, 0 = as fast as possible
+struct ReplayConfig {
+    bool enabled = false;
+    std::string file;
+    double speed = 1.0;
+};
+
+// Socket ingress replacing the synthetic producers.
+// Ports: -1 = disabled, 0 = pick an ephemeral port.
+struct IngressConfig {
+    bool enabled = false;
+    std::string bind_address = "127.0.0.1";
+    int tcp_port = -1;
+    int udp_port = -1;
+    std::string unix_path;
+    unsigned ring_entries = 4096;
+    unsigned buffer_count = 1024;     // provided receive buffers (power of two)
+    unsigned buffer_size = 16384;
+    ProducerId first_producer_id = 0;
+    // In-process loopback TCP client, for running the binary end to end
+    int loopback_connections = 0;
+    int loopback_messages_per_sec = 0; // per connection, 0 = unthrottled
+};
+
+// Where strategy outputs are written.
+// type: "file" | "fifo" | "unix" (connect to a listening stream socket)
+struct EgressDestination {
+    std::string type = "file";
+    std::string path;
+    std::vector<StrategyId> strategies;  // unlisted strategies use the first destination
+};
+
+struct EgressConfig {
+    bool enabled = false;
+    std::vector<EgressDestination> destinations;
+    size_t batch_records = 256;         // flush when a batch reaches this size
+    uint64_t flush_interval_us = 100;   // or when its oldest record is this old
+};
+
+// Journal of delivered messages.
+// Durability per type ("msg_type_<n>" keys, n in 0-255): "none" = not journaled,
+// "async" = synced within group_commit_us after the output went out,
+// "sync" = write-ahead, the output waits for the group commit that makes
+// the record durable, right after the journal thread's current drain pass.
+struct JournalConfig {
+    bool enabled = false;
+    std::string directory = "journal";
+    size_t segment_bytes = 64 << 20;
+    size_t group_commit_records = 4096;
+    uint64_t group_commit_us = 1000;
+    std::string default_durability = "async";
+    std::map<std::string, std::string> durability;
+    bool recover = true;                // false discards existing segments
+    size_t retain_segments = 0;         // segments kept on disk while running, 0 = all
+};
+
+// Spill full SPSC edges to disk instead of dropping (see SpillFile)
+struct OverflowConfig {
+    bool enabled = false;
+    std::string directory = "spill";
+    size_t max_bytes_per_edge = size_t(4) << 30;
+};
+
+// Periodic pipeline snapshots for fast restart (see SnapshotCoordinator).
+// restore = true resumes from file on startup when it matches the topology.
+struct SnapshotConfig {
+    bool enabled = false;
+    std::string file = "snapshot.bin";
+    uint64_t interval_ms = 1000;
+    bool restore = true;
+};
+
+// Drop duplicate deliveries in Stage2Router (see DedupFilter).
+// max_keys bounds memory at 64 bytes per (producer, type) key.
+struct DedupConfig {
+    bool enabled = false;
+    size_t max_keys = 1 << 19;
+};
+
+// Per-type time-to-live from Message.timestamp; processors and strategies
+// drop expired messages. ttl_us keys follow producers.distribution
+// ("msg_type_<n>", n in 0-255); 0 = never expires.
+struct TtlConfig {
+    bool enabled = false;
+    uint64_t default_ttl_us = 0;
+    std::map<std::string, uint64_t> ttl_us;
+};
+
+// Synthetic message bodies of min_bytes..max_bytes (uniform). Up to 24
+// bytes ride inline in the message; larger bodies are allocated from the
+// producer's PayloadArena (slots_per_class blocks of each size class) and
+// travel as a handle until the strategy releases them.
+struct PayloadConfig {
+    bool enabled = false;
+    size_t min_bytes = 32;
+    size_t max_bytes = 4096;
+    size_t slots_per_class = 16384;
+};
+
+// Periodic report of per-stage throughput, queue depths, drops and
+// ordering violations from a sampling thread; on unless disabled.
+struct MonitorConfig {
+    bool enabled = true;
+    uint64_t interval_ms = 1000;
+};
+
+// HTTP endpoint serving GET /metrics in OpenMetrics text format
+// (port 0 = any free port, printed at startup).
+struct MetricsHttpConfig {
+    bool enabled = false;
+    std::string bind_address = "127.0.0.1";
+    int port = 9464;
+};
+
+// Per-thread rings of binary trace events (batches, full queues, retries,
+// idling, parking, reorder holds), written as Chrome trace JSON to file on
+// SIGUSR1 and, with dump_on_exit, at shutdown. On unless disabled.
+struct TraceConfig {
+    bool enabled = true;
+    size_t records_per_thread = 16384;
+    std::string file = "trace.json";
+    bool dump_on_exit = false;
+};
+
+// Per-hop latency of 1 in sample_every messages (a power of two, picked by
+// sequence number); end-to-end times above outlier_us are listed with
+// their breakdown.
+struct HopTraceConfig {
+    bool enabled = false;
+    uint64_t sample_every = 1024;
+    size_t table_slots = 4096;
+    uint64_t outlier_us = 1000;
+    size_t max_outliers = 16;
+};
+
+// Hardware counters (cycles, instructions, LLC and branch misses) on every
+// stage thread via perf_event_open, reported per message in the summary.
+// Left out, with the reason, where the kernel does not permit them.
+struct PerfConfig {
+    bool enabled = false;
+};
+
+// Thread spinning on the TSC that records every gap of at least
+// threshold_ns as a platform stall; cpu >= 0 pins it there.
+struct HiccupConfig {
+    bool enabled = false;
+    uint64_t threshold_ns = 1000;
+    int cpu = -1;
 };
 
 struct SystemConfig {
@@ -43,6 +221,22 @@ struct SystemConfig {
     StrategyConfig strategies;
     std::vector<Stage1Rule> stage1_rules;
     std::vector<Stage2Rule> stage2_rules;
+    CaptureConfig capture;
+    ReplayConfig replay;
+    IngressConfig ingress;
+    EgressConfig egress;
+    JournalConfig journal;
+    OverflowConfig overflow;
+    SnapshotConfig snapshot;
+    DedupConfig dedup;
+    TtlConfig ttl;
+    PayloadConfig payloads;
+    MonitorConfig monitor;
+    MetricsHttpConfig metrics_http;
+    TraceConfig trace;
+    HopTraceConfig hop_trace;
+    PerfConfig perf;
+    HiccupConfig hiccups;
     
     static std::unique_ptr<SystemConfig> load_from_file(const std::string& filename);
     bool validate() const;
@@ -50,6 +244,7 @@ struct SystemConfig {
     ProcessorId get_processor_for_message(MessageType msg_type) const;
     StrategyId get_strategy_for_message(MessageType msg_type) const;
     bool is_ordering_required(MessageType msg_type) const;
+    bool is_conflated(MessageType msg_type) const;
 };
 
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+namespace MessageRouter {
+
+struct ConflationStats {
+    uint64_t updates = 0;           // messages published into a slot
+    uint64_t delivered = 0;         // latest values handed to strategies
+    uint64_t overflows = 0;         // sent through the queue, table was full
+    uint64_t keys = 0;
+};
+
+// Latest-value slots between Stage2Router (writer) and one strategy
+// (reader) for conflated message types. Each (producer, type) key owns a
+// slot guarded by a seqlock; publishing overwrites the slot and queues its
+// index only when the key turns dirty, so the strategy receives each dirty
+// key once with its newest value and its load tracks distinct keys, not
+// the raw update rate.
+class ConflationTable {
+public:
+    // The dirty-key queue must hold every key at once
+    static constexpr size_t kMaxKeys = 65535;
+
+    explicit ConflationTable(size_t max_keys);
+
+    ConflationTable(const ConflationTable&) = delete;
+    ConflationTable& operator=(const ConflationTable&) = delete;
+
+    // Writer side. Returns false when every slot is taken by other keys;
+    // the caller then delivers the message through the normal queue.
+    bool publish(const Message& message);
+
+    // Reader side: hands the current value of up to max_messages dirty keys
+    // to deliver(const Message&) and returns how many were delivered
+    template<typename Deliver>
+    size_t drain(size_t max_messages, Deliver&& deliver) {
+        size_t drained = 0;
+        uint32_t index;
+        while (drained < max_messages && dirty_.try_pop(index)) {
+            Slot& slot = slots_[index];
+            // From here on, a new publish queues the key again
+            slot.dirty.store(false, std::memory_order_seq_cst);
+
+            Message message;
+            uint64_t version = read(slot, message);
+            if (version == slot.delivered_version) {
+                continue; // already handed out when the key was last drained
+            }
+            slot.delivered_version = version;
+            deliver(message);
+            ++drained;
+        }
+        delivered_.fetch_add(drained, std::memory_order_relaxed);
+        return drained;
+    }
+
+    bool empty() const { return dirty_.empty(); }
+
+    uint64_t get_updates() const { return updates_.load(); }
+    uint64_t get_delivered() const { return delivered_.load(); }
+    uint64_t get_overflows() const { return overflows_.load(); }
+    uint64_t get_keys() const { return keys_.load(); }
+    void collect_stats(ConflationStats& out) const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> version{0};   // odd while the writer is mid-update
+        std::atomic<bool> dirty{false};
+        uint64_t delivered_version = 0;     // reader-private
+        Message message;
+    };
+
+    static uint64_t read(const Slot& slot, Message& message);
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t max_keys_;
+    std::unordered_map<uint64_t, uint32_t> index_;   // writer-private key -> slot
+    LockFreeSPSCQueue<uint32_t, kMaxKeys + 1> dirty_;
+
+    std::atomic<uint64_t> updates_;
+    std::atomic<uint64_t> delivered_;
+    std::atomic<uint64_t> overflows_;
+    std::atomic<uint64_t> keys_;
+};
+
+} // namespace MessageRouter
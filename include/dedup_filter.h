@@ -0,0 +1,61 @@
+#pragma once
+
+#include "message.h"
+#include <atomic>
+#include <memory>
+
+namespace MessageRouter {
+
+// Exactly-once filter keyed by (producer_id, msg_type). Each key keeps the
+// highest sequence seen plus a sliding bitmap of the kWindowBits sequences
+// below it, so a lookup is a hash probe and a few word-level bit ops.
+// Keys live in a fixed, set-associative table of cache-line entries: memory
+// is max_keys * 64 bytes no matter how many producers connect, and when a
+// set is full its least recently used key is evicted (forgetting that
+// key's window). Sequences older than the window are rejected as too old,
+// since they can no longer be told apart from duplicates.
+class DedupFilter {
+public:
+    static constexpr size_t kWindowBits = 256;
+    static constexpr size_t kWays = 4;
+
+    // max_keys is rounded up to a power of two
+    explicit DedupFilter(size_t max_keys);
+
+    DedupFilter(const DedupFilter&) = delete;
+    DedupFilter& operator=(const DedupFilter&) = delete;
+
+    // True the first time (producer, type, sequence) is seen
+    bool accept(const Message& message);
+
+    uint64_t get_duplicates() const { return duplicates_.load(); }
+    uint64_t get_too_old() const { return too_old_.load(); }
+    uint64_t get_evictions() const { return evictions_.load(); }
+    uint64_t get_tracked_keys() const { return tracked_keys_.load(); }
+    size_t get_capacity() const { return (set_mask_ + 1) * kWays; }
+
+private:
+    static constexpr size_t kWindowWords = kWindowBits / 64;
+
+    struct alignas(64) Entry {
+        uint64_t key;                       // packed (producer, type) + 1; 0 = free
+        SequenceNumber highest;
+        uint64_t last_used;                 // accept() count at the last hit
+        uint64_t window[kWindowWords];      // bit i set = highest - i was seen
+    };
+    static_assert(sizeof(Entry) == 64, "DedupFilter entries are one cache line");
+
+    Entry& find_or_evict(uint64_t key);
+    static void shift_window(uint64_t* window, uint64_t shift);
+
+    std::unique_ptr<Entry[]> entries_;
+    size_t set_mask_;
+    uint64_t clock_;
+
+    std::atomic<uint64_t> duplicates_;
+    std::atomic<uint64_t> too_old_;
+    std::atomic<uint64_t> evictions_;
+    std::atomic<uint64_t> tracked_keys_;
+};
+
+} // namespace MessageRouter
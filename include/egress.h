@@ -0,0 +1,93 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include "config.h"
+#include "latency_histogram.h"
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+
+namespace MessageRouter {
+
+// One strategy output, in its on-the-wire form
+struct EgressRecord {
+    SequenceNumber sequence_number;
+    uint64_t timestamp;             // producer timestamp, TscClock ticks
+    uint64_t output_timestamp;      // when the strategy emitted it, TscClock ticks
+    ProducerId producer_id;
+    uint16_t strategy_id;
+    MessageType msg_type;
+    uint8_t reserved;
+};
+static_assert(sizeof(EgressRecord) == 32, "EgressRecord is a fixed 32-byte wire format");
+
+// Precedes every flushed batch on the destination
+struct EgressBatchHeader {
+    static constexpr uint32_t kMagic = 0x45475231; // "EGR1"
+
+    uint32_t magic;
+    uint32_t record_count;
+    uint64_t flush_timestamp;       // TscClock ticks
+};
+static_assert(sizeof(EgressBatchHeader) == 16, "EgressBatchHeader is a fixed 16-byte wire format");
+
+using EgressQueue = LockFreeSPSCQueue<EgressRecord, 65536>;
+
+// Collects strategy outputs from one SPSC queue per strategy into one
+// batch per destination and writes each batch (header + records) with a
+// single writev. A batch is flushed when it reaches batch_records or when
+// its oldest record has waited flush_interval_us.
+class EgressStage {
+public:
+    EgressStage(const SystemConfig* config);
+    ~EgressStage();
+
+    void start();
+    void stop();
+    void wait_for_completion();
+    bool is_running() const { return running_.load(); }
+
+    // Queue the given strategy pushes its outputs to
+    EgressQueue* get_input_queue(StrategyId strategy_id) const { return input_queues_[strategy_id].get(); }
+
+    uint64_t get_records_written() const { return records_written_.load(); }
+    uint64_t get_bytes_written() const { return bytes_written_.load(); }
+    uint64_t get_batches_written() const { return batches_written_.load(); }
+    uint64_t get_size_flushes() const { return size_flushes_.load(); }
+    uint64_t get_deadline_flushes() const { return deadline_flushes_.load(); }
+    uint64_t get_write_errors() const { return write_errors_.load(); }
+    // Strategy output to write completion, in TscClock ticks; read after stop()
+    const LatencyHistogram& get_latency() const { return latency_; }
+
+private:
+    struct Destination {
+        int fd = -1;
+        std::vector<EgressRecord> pending;
+        uint64_t oldest_pending = 0;
+    };
+
+    void egress_loop();
+    void flush(Destination& destination);
+    static int open_destination(const EgressDestination& destination);
+
+    const SystemConfig* config_;
+    std::vector<std::unique_ptr<EgressQueue>> input_queues_;
+    std::vector<Destination> destinations_;
+    std::vector<size_t> destination_for_strategy_;
+    uint64_t flush_interval_ticks_;
+
+    std::atomic<bool> running_;
+    std::unique_ptr<std::thread> egress_thread_;
+
+    std::atomic<uint64_t> records_written_;
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> batches_written_;
+    std::atomic<uint64_t> size_flushes_;
+    std::atomic<uint64_t> deadline_flushes_;
+    std::atomic<uint64_t> write_errors_;
+    LatencyHistogram latency_;
+};
+
+} // namespace MessageRouter
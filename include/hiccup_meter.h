@@ -0,0 +1,44 @@
+#pragma once
+
+#include "config.h"
+#include "latency_histogram.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace MessageRouter {
+
+// Measures stalls the platform inflicts on a thread that never blocks:
+// scheduler preemption, interrupts, SMIs, hypervisor steal. The meter spins
+// reading the TSC; any gap between two consecutive reads of at least
+// threshold_ns is time the thread was not running, and is recorded in
+// ticks like the stage latencies. It costs the CPU it spins on.
+class HiccupMeter {
+public:
+    explicit HiccupMeter(const HiccupConfig& config);
+    ~HiccupMeter();
+
+    HiccupMeter(const HiccupMeter&) = delete;
+    HiccupMeter& operator=(const HiccupMeter&) = delete;
+
+    void start();
+    void stop();
+
+    // Stalls of at least the threshold, in TscClock ticks
+    const LatencyHistogram& get_stalls() const { return stalls_; }
+    uint64_t get_stalled_ticks() const { return stalled_ticks_.load(std::memory_order_relaxed); }
+    uint64_t get_measured_ticks() const { return measured_ticks_.load(std::memory_order_relaxed); }
+
+private:
+    void meter_loop();
+
+    HiccupConfig config_;
+    std::atomic<bool> running_;
+    std::unique_ptr<std::thread> meter_thread_;
+
+    LatencyHistogram stalls_;
+    std::atomic<uint64_t> stalled_ticks_;
+    std::atomic<uint64_t> measured_ticks_;
+};
+
+} // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "message.h"
+#include "config.h"
+#include "latency_histogram.h"
+#include "tsc_clock.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MessageRouter {
+
+// One sampled message's trip, in TscClock ticks
+struct HopSample {
+    ProducerId producer_id;
+    SequenceNumber sequence_number;
+    MessageType msg_type;
+    StrategyId strategy_id;
+    uint64_t produced;      // Message.timestamp
+    uint64_t stage1;
+    uint64_t processed;     // Message.processing_timestamp
+    uint64_t stage2;
+    uint64_t delivered;
+};
+
+// Breaks the latency of 1 in sample_every messages into its hops. The
+// sample is picked by sequence number, so every stage agrees on it without
+// a flag in the Message. The routers stamp their hop into a slot keyed by
+// (producer_id, sequence_number); the strategy reads it back on delivery
+// together with the producer and processor timestamps the Message already
+// carries. A slot reused before its message is delivered loses that sample.
+class HopTracer {
+public:
+    enum Hop {
+        ProducerToStage1,
+        Stage1ToProcessor,
+        ProcessorToStage2,
+        Stage2ToStrategy,
+        EndToEnd,
+        kHops
+    };
+
+    HopTracer(const HopTraceConfig& config, size_t strategy_count);
+
+    HopTracer(const HopTracer&) = delete;
+    HopTracer& operator=(const HopTracer&) = delete;
+
+    bool sampled(const Message& message) const {
+        return (message.sequence_number & sample_mask_) == 0;
+    }
+
+    // Router threads; stamps the sampled messages of a batch with one clock read
+    void stamp_stage1(const Message* batch, size_t count) { stamp(&Slot::stage1, batch, count); }
+    void stamp_stage2(const Message* batch, size_t count) { stamp(&Slot::stage2, batch, count); }
+
+    // Strategy thread, for a sampled message; single writer per strategy_id
+    void complete(StrategyId strategy_id, const Message& message, uint64_t delivered);
+
+    uint64_t get_samples() const;
+    uint64_t get_samples_lost() const;
+
+    static const char* hop_name(Hop hop);
+
+    // Per-hop percentiles and the outliers' breakdowns
+    void print_report() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> key{kEmptyKey};
+        std::atomic<uint64_t> stage1{0};
+        std::atomic<uint64_t> stage2{0};
+    };
+
+    struct alignas(64) StrategyHops {
+        LatencyHistogram hops[kHops];
+        std::atomic<uint64_t> samples{0};
+        std::atomic<uint64_t> lost{0};
+    };
+
+    static constexpr uint64_t kEmptyKey = UINT64_MAX;
+
+    static uint64_t slot_key(const Message& message) {
+        return (message.sequence_number << 16) | (message.producer_id & 0xffff);
+    }
+
+    Slot& slot_for(const Message& message) const {
+        const uint64_t mix = (message.sequence_number >> sample_shift_) ^ (uint64_t(message.producer_id) << 40);
+        return slots_[static_cast<size_t>((mix * 0x9E3779B97F4A7C15ull) >> 32) & slot_mask_];
+    }
+
+    void stamp(std::atomic<uint64_t> Slot::* hop, const Message* batch, size_t count);
+
+    HopTraceConfig config_;
+    uint64_t sample_mask_;
+    unsigned sample_shift_;
+    uint64_t outlier_ticks_;
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t slot_mask_;
+
+    std::vector<std::unique_ptr<StrategyHops>> strategies_;
+
+    // Worst samples above the threshold, kept up to max_outliers
+    mutable std::mutex outliers_mutex_;
+    std::vector<HopSample> outliers_;
+    uint64_t outliers_seen_;
+};
+
+} // namespace MessageRouter
\ No newline at end of file
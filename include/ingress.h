@@ -0,0 +1,137 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include "config.h"
+#include "io_uring.h"
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/socket.h>
+
+namespace MessageRouter {
+
+// Fixed 8-byte wire frame. The server assigns producer_id and sequence
+// numbers per connection (per peer for UDP), so clients only send the type.
+struct IngressFrame {
+    uint8_t msg_type;
+    uint8_t reserved[3];
+    uint32_t client_tag;
+};
+static_assert(sizeof(IngressFrame) == 8, "IngressFrame is a fixed 8-byte wire format");
+
+// Single-threaded io_uring socket ingress. Accepts TCP and Unix-domain
+// stream connections with multishot accept, receives with multishot recv /
+// recvmsg into a kernel-registered provided-buffer ring, and decodes frames
+// straight into producer queue slots. Connection N gets producer id N and
+// writes to producer queue N % queue count.
+class IngressServer {
+public:
+    IngressServer(const IngressConfig& config,
+                  const std::vector<std::shared_ptr<MessageQueue>>& output_queues);
+    ~IngressServer();
+
+    void start();
+    void stop();
+    void wait_for_completion();
+    bool is_running() const { return running_.load(); }
+
+    int get_tcp_port() const { return tcp_port_; }
+    int get_udp_port() const { return udp_port_; }
+
+    uint64_t get_messages_received() const { return messages_received_.load(); }
+    uint64_t get_messages_dropped() const { return messages_dropped_.load(); }
+    uint64_t get_bytes_received() const { return bytes_received_.load(); }
+    uint64_t get_connections_accepted() const { return connections_accepted_.load(); }
+    uint64_t get_malformed_frames() const { return malformed_frames_.load(); }
+
+private:
+    enum class Kind : uint32_t { Accept = 1, Recv = 2, RecvUdp = 3 };
+
+    struct Connection {
+        int fd = -1;
+        ProducerId producer_id = 0;
+        SequenceNumber next_sequence = 1;
+        MessageQueue* queue = nullptr;
+        uint8_t carry[sizeof(IngressFrame)];
+        size_t carry_len = 0;
+    };
+
+    static uint64_t user_data(Kind kind, int fd) {
+        return (static_cast<uint64_t>(kind) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    void event_loop();
+    io_uring_sqe* next_sqe();
+    void arm_accept(int listen_fd);
+    void arm_recv(int fd);
+    void arm_udp_recv();
+
+    void on_accept(const io_uring_cqe& cqe, int listen_fd);
+    void on_recv(const io_uring_cqe& cqe, int fd);
+    void on_udp_recv(const io_uring_cqe& cqe);
+
+    Connection* open_connection(int fd);
+    void close_connection(int fd);
+    void decode_stream(Connection& connection, const uint8_t* data, size_t length, uint64_t now);
+    void push_frame(Connection& connection, const IngressFrame& frame, uint64_t now);
+
+    IngressConfig config_;
+    std::vector<std::shared_ptr<MessageQueue>> output_queues_;
+    std::unique_ptr<IoUring> ring_;
+
+    int tcp_fd_;
+    int udp_fd_;
+    int unix_fd_;
+    int tcp_port_;
+    int udp_port_;
+
+    std::vector<std::unique_ptr<Connection>> connections_;     // indexed by fd
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> udp_peers_;
+    ProducerId next_producer_id_;
+
+    struct msghdr udp_msg_;
+    struct sockaddr_storage udp_name_;
+
+    std::atomic<bool> running_;
+    std::unique_ptr<std::thread> ingress_thread_;
+
+    std::atomic<uint64_t> messages_received_;
+    std::atomic<uint64_t> messages_dropped_;
+    std::atomic<uint64_t> bytes_received_;
+    std::atomic<uint64_t> connections_accepted_;
+    std::atomic<uint64_t> malformed_frames_;
+};
+
+// Loopback load generator: one thread per TCP connection streaming frames
+// to an IngressServer. messages_per_sec is per connection (0 = unthrottled).
+class IngressLoadClient {
+public:
+    IngressLoadClient(const std::string& address, int port, int connections, int messages_per_sec);
+    ~IngressLoadClient();
+
+    void start();
+    void stop();
+    void wait_for_completion();
+
+    uint64_t get_messages_sent() const { return messages_sent_.load(); }
+
+    static constexpr size_t kBatchFrames = 512;
+
+private:
+    void client_loop(int connection_index);
+
+    std::string address_;
+    int port_;
+    int connections_;
+    int messages_per_sec_;
+
+    std::atomic<bool> running_;
+    std::vector<std::unique_ptr<std::thread>> client_threads_;
+    std::atomic<uint64_t> messages_sent_;
+};
+
+} // namespace MessageRouter
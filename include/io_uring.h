@@ -0,0 +1,84 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace MessageRouter {
+
+// Minimal raw-syscall io_uring wrapper (no liburing dependency): one SQ/CQ
+// pair plus an optional provided-buffer ring for multishot receives.
+// Not thread-safe; owned by a single event-loop thread.
+class IoUring {
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Returns a zeroed SQE, or nullptr when the submission ring is full
+    io_uring_sqe* get_sqe();
+    // Hands queued SQEs to the kernel; returns the count or -errno
+    int submit();
+    bool has_pending() const { return sqe_tail_ != sqe_head_; }
+
+    // Calls handler(const io_uring_cqe&) for every ready completion
+    template<typename Handler>
+    unsigned for_each_completion(Handler&& handler) {
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        unsigned seen = 0;
+        while (head != tail) {
+            handler(cqes_[head & cq_mask_]);
+            ++head;
+            ++seen;
+        }
+        if (seen) {
+            std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+        }
+        return seen;
+    }
+
+    // Registers a ring of `count` buffers of `size` bytes as buffer group `group`
+    void setup_buffer_ring(uint16_t group, unsigned count, unsigned size);
+    uint8_t* buffer(uint16_t id) const { return buffers_ + static_cast<size_t>(id) * buffer_size_; }
+    unsigned buffer_size() const { return buffer_size_; }
+    // Returns a consumed buffer to the kernel (visible after publish_buffers)
+    void recycle_buffer(uint16_t id);
+    void publish_buffers();
+
+private:
+    int ring_fd_;
+
+    void* sq_ring_;
+    void* cq_ring_;
+    size_t sq_ring_bytes_;
+    size_t cq_ring_bytes_;
+    io_uring_sqe* sqes_;
+    size_t sqes_bytes_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sqe_head_;
+    unsigned sqe_tail_;
+
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+
+    io_uring_buf_ring* buf_ring_;
+    size_t buf_ring_bytes_;
+    uint8_t* buffers_;
+    size_t buffers_bytes_;
+    unsigned buffer_size_;
+    unsigned buf_mask_;
+    uint16_t buf_tail_;
+    uint16_t buf_group_;
+};
+
+} // namespace MessageRouter
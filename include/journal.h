@@ -0,0 +1,162 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include "config.h"
+#include "latency_histogram.h"
+#include <array>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MessageRouter {
+
+// One delivered message as stored in a journal segment. checksum covers the
+// preceding bytes and is never zero, so the zero-filled, pre-allocated tail
+// of a segment (or a torn write) ends recovery.
+struct JournalRecord {
+    SequenceNumber sequence_number;
+    uint64_t timestamp;             // producer timestamp, TscClock ticks
+    ProducerId producer_id;
+    StrategyId strategy_id;
+    MessageType msg_type;
+    uint8_t reserved[3];
+    uint32_t checksum;
+};
+static_assert(sizeof(JournalRecord) == 32, "JournalRecord is a fixed 32-byte on-disk format");
+
+struct JournalSegmentHeader {
+    static constexpr uint64_t kMagic = 0x314C4E524A524D4DULL; // "MMRJRNL1"
+    static constexpr uint32_t kVersion = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t segment_index;
+    uint8_t reserved[40];
+};
+static_assert(sizeof(JournalSegmentHeader) == 64, "JournalSegmentHeader is a fixed 64-byte on-disk format");
+
+// Sequence state rebuilt from the journal on restart
+struct JournalRecovery {
+    uint64_t records_replayed = 0;
+    uint64_t segments_scanned = 0;
+    uint64_t next_segment_index = 0;
+    // Last delivered sequence per (producer, type), indexed by strategy id
+    std::vector<std::map<std::pair<ProducerId, MessageType>, SequenceNumber>> strategy_sequences;
+    // Highest sequence delivered per producer
+    std::map<ProducerId, SequenceNumber> producer_sequences;
+};
+
+using JournalQueue = LockFreeSPSCQueue<JournalRecord, 65536>;
+
+// Journal of delivered messages. Strategies push records into one SPSC
+// queue each; the journal thread appends them to pre-allocated,
+// memory-mapped segment files and makes them durable with group commit:
+// one msync per batch, issued when the batch reaches group_commit_records,
+// when a "sync" message type was appended in the current drain pass, or
+// when the oldest unsynced record has waited group_commit_us.
+//
+// "sync" types are write-ahead: after each msync the journal publishes, per
+// strategy, how many of its records are settled and how many of those were
+// lost, and the strategy holds a sync message's output until that watermark
+// covers its record. "async" types are emitted first and journaled behind.
+// A failed msync is not retried: the kernel may have dropped the pages it
+// could not write and report success next time, so the records it covered
+// are settled as lost instead.
+//
+// With retain_segments > 0 the oldest segments are deleted as new ones are
+// opened, so the directory holds at most that many; recovery then only
+// sees the sequences those segments cover.
+class Journal {
+public:
+    Journal(const SystemConfig* config, uint64_t first_segment_index);
+    ~Journal();
+
+    // Scans the journal directory and rebuilds sequence state. With
+    // journal.recover = false the old segments are discarded instead.
+    static JournalRecovery recover(const SystemConfig* config);
+
+    void start();
+    void stop();
+    void wait_for_completion();
+    bool is_running() const { return running_.load(); }
+
+    JournalQueue* get_input_queue(StrategyId strategy_id) const { return input_queues_[strategy_id].get(); }
+    bool is_journaled(MessageType msg_type) const { return durability_[msg_type] != Durability::None; }
+    bool is_sync(MessageType msg_type) const { return durability_[msg_type] == Durability::Sync; }
+    // Records of strategy_id's queue that are settled, in push order: durable
+    // on disk, or lost to a failed commit
+    uint64_t get_committed(StrategyId strategy_id) const {
+        return committed_[strategy_id].records.load(std::memory_order_acquire);
+    }
+    // Of those, the records that were lost; read after get_committed()
+    uint64_t get_lost(StrategyId strategy_id) const {
+        return committed_[strategy_id].lost.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_records_written() const { return records_written_.load(); }
+    uint64_t get_commits() const { return commits_.load(); }
+    uint64_t get_segments_written() const { return segments_written_.load(); }
+    uint64_t get_bytes_written() const { return bytes_written_.load(); }
+    uint64_t get_commit_failures() const { return commit_failures_.load(); }
+    uint64_t get_records_lost() const { return records_lost_.load(); }
+    uint64_t get_segments_deleted() const { return segments_deleted_.load(); }
+    // Duration of each group commit, in TscClock ticks; read after stop()
+    const LatencyHistogram& get_commit_latency() const { return commit_latency_; }
+
+    static uint32_t checksum(const JournalRecord& record);
+
+private:
+    enum class Durability : uint8_t { None, Async, Sync };
+
+    struct alignas(64) CommitWatermark {
+        std::atomic<uint64_t> records{0};
+        std::atomic<uint64_t> lost{0};      // stored before records
+    };
+
+    void journal_loop();
+    void append(const JournalRecord& record, size_t input);
+    void commit();
+    // Publishes the uncommitted records as settled and lost
+    void settle_lost();
+    void open_segment(uint64_t segment_index);
+    void close_segment();
+    // Deletes segments that fell out of the retain_segments window
+    void retire_segments();
+    static std::string segment_path(const std::string& directory, uint64_t segment_index);
+
+    const SystemConfig* config_;
+    std::vector<std::unique_ptr<JournalQueue>> input_queues_;
+    std::vector<uint64_t> appended_;                // per input queue, journal thread only
+    std::unique_ptr<CommitWatermark[]> committed_;  // per input queue, published by commit()
+    std::array<Durability, 256> durability_;
+    uint64_t group_commit_ticks_;
+
+    int fd_;
+    uint8_t* segment_;
+    uint64_t segment_index_;
+    uint64_t oldest_segment_index_;     // lowest index that may still be on disk
+    size_t write_offset_;
+    size_t committed_offset_;
+    size_t uncommitted_records_;
+    uint64_t oldest_uncommitted_;
+    bool sync_requested_;
+
+    std::atomic<bool> running_;
+    std::unique_ptr<std::thread> journal_thread_;
+
+    std::atomic<uint64_t> records_written_;
+    std::atomic<uint64_t> commits_;
+    std::atomic<uint64_t> segments_written_;
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> commit_failures_;
+    std::atomic<uint64_t> records_lost_;
+    std::atomic<uint64_t> segments_deleted_;
+    LatencyHistogram commit_latency_;
+};
+
+} // namespace MessageRouter
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace MessageRouter {
+
+// Log-linear latency histogram: values below 16 are exact, larger values
+// fall into 16 linear sub-buckets per power of two (~6% resolution).
+// Single writer per instance (plain relaxed stores); any thread may read.
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBucketCount = kSubBuckets + (64 - kSubBucketBits) * kSubBuckets;
+
+    LatencyHistogram() {
+        for (auto& count : counts_) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t value) {
+        auto& bucket = counts_[bucket_index(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_.store(total_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds other's counts into this histogram (reporting side only)
+    void merge_from(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+            if (count) {
+                counts_[i].store(counts_[i].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            }
+        }
+        total_.store(total_.load(std::memory_order_relaxed) + other.total_.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+        uint64_t other_max = other.max_.load(std::memory_order_relaxed);
+        if (other_max > max_.load(std::memory_order_relaxed)) {
+            max_.store(other_max, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    uint64_t bucket_count(size_t index) const { return counts_[index].load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    uint64_t value_at_percentile(double percentile) const {
+        uint64_t total = 0;
+        for (const auto& count : counts_) {
+            total += count.load(std::memory_order_relaxed);
+        }
+        if (total == 0) {
+            return 0;
+        }
+
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * total);
+        if (rank >= total) {
+            rank = total - 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen > rank) {
+                uint64_t upper = bucket_upper_bound(i);
+                uint64_t max_value = max();
+                return upper < max_value ? upper : max_value;
+            }
+        }
+        return max();
+    }
+
+    static size_t bucket_index(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        size_t msb = 63 - __builtin_clzll(value);
+        size_t shift = msb - kSubBucketBits;
+        size_t sub = static_cast<size_t>(value >> shift) & (kSubBuckets - 1);
+        return kSubBuckets + shift * kSubBuckets + sub;
+    }
+
+    static uint64_t bucket_lower_bound(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        size_t shift = (index - kSubBuckets) / kSubBuckets;
+        size_t sub = (index - kSubBuckets) % kSubBuckets;
+        return static_cast<uint64_t>(kSubBuckets + sub) << shift;
+    }
+
+    static uint64_t bucket_upper_bound(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        size_t shift = (index - kSubBuckets) / kSubBuckets;
+        return bucket_lower_bound(index) + ((uint64_t(1) << shift) - 1);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> counts_;
+    std::atomic<uint64_t> total_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+} // namespace MessageRouter
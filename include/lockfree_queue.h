@@ -3,6 +3,9 @@
 #include "message.h"
 #include <atomic>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <sys/mman.h>
 
 namespace MessageRouter {
 
@@ -12,17 +15,49 @@ class LockFreeSPSCQueue {
 private:
     static_assert((Size & (Size - 1)) == 0, "Size must be power of 2");
     
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                  "Slots are constructed lazily and never destroyed");
+    
     struct alignas(64) Node {
         T data;
         std::atomic<bool> ready{false};
     };
     
-    alignas(64) std::unique_ptr<Node[]> buffer_;
+    // The ring is a private anonymous mapping instead of a value-initialized
+    // array, so startup no longer writes - and faults in - every slot of
+    // every queue up front. The producer placement-news each Node just
+    // before its first use (see push_slot); the consumer only reads slots
+    // below tail_, which are all constructed by then.
+    struct RingDeleter {
+        void operator()(Node* nodes) const { ::munmap(nodes, sizeof(Node) * Size); }
+    };
+    
+    static Node* map_ring() {
+        void* mapping = ::mmap(nullptr, sizeof(Node) * Size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        return static_cast<Node*>(mapping);
+    }
+    
+    alignas(64) std::unique_ptr<Node[], RingDeleter> buffer_;
     alignas(64) std::atomic<size_t> head_{0};
     alignas(64) std::atomic<size_t> tail_{0};
+    size_t constructed_{0};     // producer only: slots [0, constructed_) are live
+    
+    // Tail advances from slot 0 one at a time, so only the first lap can
+    // reach an unconstructed slot
+    Node& push_slot(size_t index) {
+        if (__builtin_expect(index == constructed_, 0)) {
+            ::new (static_cast<void*>(&buffer_[index])) Node();
+            ++constructed_;
+        }
+        return buffer_[index];
+    }
     
 public:
-    LockFreeSPSCQueue() : buffer_(std::make_unique<Node[]>(Size)) {}
+    LockFreeSPSCQueue() : buffer_(map_ring()) {}
     
     bool try_push(const T& item) {
         const size_t current_tail = tail_.load(std::memory_order_relaxed);
@@ -32,13 +67,52 @@ public:
             return false; // Queue is full
         }
         
-        buffer_[current_tail].data = item;
-        buffer_[current_tail].ready.store(true, std::memory_order_release);
+        Node& node = push_slot(current_tail);
+        node.data = item;
+        node.ready.store(true, std::memory_order_release);
+        tail_.store(next_tail, std::memory_order_release);
+        
+        return true;
+    }
+    
+    // Builds the element directly in its slot via fill(T&), with no staging copy
+    template<typename Fill>
+    bool try_push_with(Fill&& fill) {
+        const size_t current_tail = tail_.load(std::memory_order_relaxed);
+        const size_t next_tail = (current_tail + 1) & (Size - 1);
+        
+        if (next_tail == head_.load(std::memory_order_acquire)) {
+            return false; // Queue is full
+        }
+        
+        Node& node = push_slot(current_tail);
+        fill(node.data);
+        node.ready.store(true, std::memory_order_release);
         tail_.store(next_tail, std::memory_order_release);
         
         return true;
     }
     
+    // Pushes as many of items[0..count) as fit, publishing them all with a
+    // single tail update; returns how many were pushed
+    size_t try_push_batch(const T* items, size_t count) {
+        const size_t current_tail = tail_.load(std::memory_order_relaxed);
+        const size_t free_slots = (head_.load(std::memory_order_acquire) - current_tail - 1) & (Size - 1);
+        const size_t pushed = count < free_slots ? count : free_slots;
+        
+        for (size_t i = 0; i < pushed; ++i) {
+            Node& node = push_slot((current_tail + i) & (Size - 1));
+            node.data = items[i];
+            // The release store of tail_ below publishes these too
+            node.ready.store(true, std::memory_order_relaxed);
+        }
+        if (pushed > 0) {
+            tail_.store((current_tail + pushed) & (Size - 1), std::memory_order_release);
+        }
+        
+        return pushed;
+    }
+    
     bool try_pop(T& item) {
         const size_t current_head = head_.load(std::memory_order_relaxed);
         
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 
@@ -12,20 +13,47 @@ using ProcessorId = uint32_t;
 using StrategyId = uint32_t;
 using SequenceNumber = uint64_t;
 
+// Where a message body lives (see PayloadArena)
+enum class PayloadKind : uint8_t {
+    None = 0,
+    Inline = 1,     // in Message.inline_payload
+    Arena = 2       // in the owning producer's arena, named by Message.payload_handle
+};
+
+// Names a block in a PayloadArena; queues carry this instead of the body.
+// An unshared handle is the block's only reference and frees it outright;
+// once fanned out, the arena's refcount for the block decides who frees it.
+struct PayloadHandle {
+    uint16_t arena;         // owning producer
+    uint8_t size_class;
+    uint8_t shared;         // nonzero after PayloadArena::share()
+    uint32_t slot;
+};
+
 struct alignas(64) Message {
+    static constexpr size_t kInlinePayloadBytes = 24;
+    
     MessageType msg_type;
+    PayloadKind payload_kind;
+    uint16_t payload_size;          // body bytes, inline or in the arena
     ProducerId producer_id;
     SequenceNumber sequence_number;
-    uint64_t timestamp;
+    uint64_t timestamp;             // TscClock ticks; TscClock::to_nanos() converts
     
     ProcessorId processor_id;
-    uint64_t processing_timestamp;
+    uint64_t processing_timestamp;  // TscClock ticks
+    
+    // Small bodies travel in the padding of the cache line; larger ones stay put in the arena
+    union {
+        uint8_t inline_payload[kInlinePayloadBytes];
+        PayloadHandle payload_handle;
+    };
     
     Message() = default;
     
     Message(MessageType type, ProducerId prod_id, SequenceNumber seq, uint64_t ts)
-        : msg_type(type), producer_id(prod_id), sequence_number(seq), timestamp(ts)
-        , processor_id(0), processing_timestamp(0) {}
+        : msg_type(type), payload_kind(PayloadKind::None), payload_size(0), producer_id(prod_id)
+        , sequence_number(seq), timestamp(ts), processor_id(0), processing_timestamp(0) {}
     
     Message(const Message& other) = default;
     
@@ -34,4 +62,6 @@ struct alignas(64) Message {
     ~Message() = default;
 };
 
+static_assert(sizeof(Message) == 64, "Message is one cache line");
+
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "message.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MessageRouter {
+
+// On-disk layout of a capture file: a fixed header followed by
+// variable-length, delta-encoded records (see MessageCaptureWriter::append).
+struct CaptureFileHeader {
+    static constexpr uint64_t kMagic = 0x3150414352524d; // "MRRCAP1"
+    static constexpr uint32_t kVersion = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t record_count;
+    uint64_t data_bytes;
+    uint64_t first_timestamp;   // TscClock ticks of the first record
+    double nanos_per_tick;      // tick rate on the capturing host
+};
+
+// Appends messages to a memory-mapped capture file. Single writer; the
+// mapping grows in fixed chunks so append() is a bounds check plus a few
+// varint stores.
+class MessageCaptureWriter {
+public:
+    explicit MessageCaptureWriter(const std::string& path);
+    ~MessageCaptureWriter();
+
+    MessageCaptureWriter(const MessageCaptureWriter&) = delete;
+    MessageCaptureWriter& operator=(const MessageCaptureWriter&) = delete;
+
+    void append(const Message& message) {
+        if (__builtin_expect(write_pos_ + kMaxRecordBytes > mapped_bytes_, 0)) {
+            grow();
+        }
+        encode(message);
+    }
+
+    // Writes the final header and truncates the file to its used size
+    void close();
+
+    uint64_t get_records_written() const { return record_count_; }
+    uint64_t get_bytes_written() const { return write_pos_; }
+
+    static constexpr size_t kMaxRecordBytes = 64;
+    static constexpr size_t kGrowBytes = size_t(64) << 20;
+
+private:
+    void encode(const Message& message);
+    void grow();
+
+    std::string path_;
+    int fd_;
+    uint8_t* data_;
+    size_t mapped_bytes_;
+    size_t write_pos_;
+
+    uint64_t record_count_;
+    uint64_t first_timestamp_;
+    uint64_t last_timestamp_;
+    std::vector<SequenceNumber> last_sequence_;
+};
+
+// Zero-copy reader: records are decoded straight out of a read-only mapping
+class MessageCaptureReader {
+public:
+    explicit MessageCaptureReader(const std::string& path);
+    ~MessageCaptureReader();
+
+    MessageCaptureReader(const MessageCaptureReader&) = delete;
+    MessageCaptureReader& operator=(const MessageCaptureReader&) = delete;
+
+    bool next(Message& message);
+    void rewind();
+
+    const CaptureFileHeader& header() const { return *header_; }
+    uint64_t get_records_read() const { return records_read_; }
+
+private:
+    int fd_;
+    const uint8_t* data_;
+    size_t mapped_bytes_;
+    const CaptureFileHeader* header_;
+    const uint8_t* cursor_;
+    const uint8_t* end_;
+
+    uint64_t records_read_;
+    uint64_t last_timestamp_;
+    std::vector<SequenceNumber> last_sequence_;
+};
+
+} // namespace MessageRouter
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "config.h"
+#include "monitor.h"
+#include "strategy.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MessageRouter {
+
+// Minimal HTTP endpoint serving GET /metrics in OpenMetrics text format:
+// every thread's counters from the metrics registry, every queue's depth
+// and the end-to-end latency histogram. One thread accepts and answers
+// scrapes one at a time; everything it reads is a seqlocked block, a queue
+// index or a relaxed histogram bucket, so a scrape never stalls a stage.
+class MetricsExporter {
+public:
+    // Binds the listening socket; throws std::runtime_error if it cannot
+    MetricsExporter(const SystemConfig* config, std::vector<Monitor::QueueGroup> queue_groups,
+                    const StrategyManager* strategies);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void start();
+    void stop();
+
+    int get_port() const { return port_; }
+    uint64_t get_scrapes() const { return scrapes_.load(); }
+
+    // The /metrics body
+    std::string render() const;
+
+private:
+    void serve_loop();
+    void serve(int client_fd);
+
+    std::vector<Monitor::QueueGroup> queue_groups_;
+    const StrategyManager* strategies_;
+    int listen_fd_;
+    int port_;
+
+    std::atomic<bool> running_;
+    std::unique_ptr<std::thread> server_thread_;
+    std::atomic<uint64_t> scrapes_;
+};
+
+} // namespace MessageRouter
\ No newline at end of file
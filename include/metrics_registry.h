@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MessageRouter {
+
+enum class Metric : uint8_t {
+    MessagesProduced = 0,
+    MessagesRouted,
+    RoutingErrors,
+    MessagesProcessed,
+    MessagesDelivered,
+    OrderingViolations,
+    MessagesExpired,
+    OutputsDropped,
+    JournalDropped,
+    SyncWithheld,
+    PayloadMismatches,
+    SendsBehindSchedule,
+    InlinePayloads,
+    Count
+};
+
+constexpr size_t kMetricCount = static_cast<size_t>(Metric::Count);
+
+// Snake-case name for reports and exporters, e.g. "messages_routed"
+const char* metric_name(Metric metric);
+
+// Counters of one stage thread, alone on their cache lines. Only the owning
+// thread writes, with plain relaxed stores bracketed by a sequence count, so
+// counting never issues a locked instruction or pulls a line away from
+// another core; readers retry until they see the same even sequence on
+// both sides of their copy.
+class alignas(64) MetricsBlock {
+public:
+    MetricsBlock() {
+        for (auto& value : values_) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    MetricsBlock(const MetricsBlock&) = delete;
+    MetricsBlock& operator=(const MetricsBlock&) = delete;
+
+    // Owning thread only
+    void add(Metric metric, uint64_t count = 1) {
+        begin_write();
+        bump(metric, count);
+        end_write();
+    }
+
+    // Owning thread only: both counters change in one snapshot
+    void add(Metric first, uint64_t first_count, Metric second, uint64_t second_count) {
+        begin_write();
+        bump(first, first_count);
+        bump(second, second_count);
+        end_write();
+    }
+
+    // Any thread; a single counter needs no retry
+    uint64_t get(Metric metric) const {
+        return values_[static_cast<size_t>(metric)].load(std::memory_order_relaxed);
+    }
+
+    // Any thread; every counter as of one point in the writer's history
+    std::array<uint64_t, kMetricCount> snapshot() const;
+
+private:
+    void begin_write() {
+        const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_write() {
+        sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void bump(Metric metric, uint64_t count) {
+        auto& value = values_[static_cast<size_t>(metric)];
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> sequence_{0};     // odd while a write is in progress
+    std::array<std::atomic<uint64_t>, kMetricCount> values_;
+};
+
+// The sequence and the seven per-message counters share the first line; the
+// rarer counters after them spill onto a second one only they touch
+static_assert(sizeof(MetricsBlock) == 128, "MetricsBlock is two cache lines");
+
+struct MetricsSnapshot {
+    std::string thread;     // e.g. "stage1", "processor-3"
+    std::array<uint64_t, kMetricCount> values;
+
+    uint64_t operator[](Metric metric) const { return values[static_cast<size_t>(metric)]; }
+};
+
+// Process-wide list of stage threads' counter blocks. Registration takes a
+// lock; the counting itself never does.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // Blocks live until unregistered; pointers stay valid meanwhile
+    MetricsBlock* register_thread(std::string thread);
+    void unregister_thread(const MetricsBlock* block);
+
+    // One consistent snapshot per registered thread, in registration order
+    void snapshot(std::vector<MetricsSnapshot>& out) const;
+    // Sum over all threads
+    MetricsSnapshot total() const;
+
+private:
+    MetricsRegistry() = default;
+
+    struct Entry {
+        std::string thread;
+        std::unique_ptr<MetricsBlock> block;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+
+// A component's registration, released with the component
+class ThreadMetrics {
+public:
+    explicit ThreadMetrics(std::string thread)
+        : block_(MetricsRegistry::instance().register_thread(std::move(thread))) {}
+    ~ThreadMetrics() { MetricsRegistry::instance().unregister_thread(block_); }
+
+    ThreadMetrics(const ThreadMetrics&) = delete;
+    ThreadMetrics& operator=(const ThreadMetrics&) = delete;
+
+    MetricsBlock* operator->() const { return block_; }
+
+private:
+    MetricsBlock* block_;
+};
+
+} // namespace MessageRouter
\ No newline at end of file
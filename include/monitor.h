@@ -7,60 +7,87 @@
 #include <memory>
 #include <string>
 #include "message.h"
-#include "producer.h"
-#include "processor.h"
-#include "strategy.h"
+#include "lockfree_queue.h"
+#include "config.h"
+#include "metrics_registry.h"
+#include "latency_histogram.h"
 
 namespace MessageRouter {
 
+class StrategyManager;
+class HiccupMeter;
+
+// Samples the metrics registry and every queue's depth once per interval on
+// its own thread and prints per-stage throughput, drops and ordering
+// violations. It only reads seqlocked counter blocks and queue indices, so
+// the pipeline never waits on it.
 class Monitor {
+public:
+    struct QueueGroup {
+        std::string name;       // e.g. "stage1"
+        std::vector<std::shared_ptr<MessageQueue>> queues;
+    };
+
+    Monitor(const SystemConfig* config, std::vector<QueueGroup> queue_groups);
+
+    ~Monitor();
+
+    // Report each interval's end-to-end p99, and the platform stalls the
+    // hiccup meter saw beside it; call before start()
+    void set_latency_source(const StrategyManager* strategies) { strategies_ = strategies; }
+    void set_hiccup_meter(const HiccupMeter* hiccups) { hiccups_ = hiccups; }
+
+    void start();
+
+    void stop();
+
+    // Averages and peaks over the samples taken; call after stop()
+    void print_final_report() const;
+
 private:
+    enum Stage : size_t { Producers = 0, Stage1, Processors, Stage2, Strategies, kStages };
+
+    struct Sample {
+        std::array<uint64_t, kStages> messages{};   // each stage's output count
+        uint64_t routing_errors = 0;
+        uint64_t expired = 0;
+        uint64_t ordering_violations = 0;
+        uint64_t outputs_lost = 0;                  // egress outputs, journal records, withheld sync outputs
+        uint64_t late_sends = 0;
+        uint64_t payload_mismatches = 0;
+    };
+
+    static const char* stage_name(size_t stage);
+
+    void monitor_loop();
+
+    Sample take_sample() const;
+
+    void report(const Sample& sample, const Sample& previous, double interval_secs);
+
+    // Latency p99 / stall line of one interval
+    std::string latency_line();
+
     const SystemConfig* config_;
-    ProducerManager* producer_manager_;
-    ProcessorManager* processor_manager_;
-    StrategyManager* strategy_manager_;
-    
-    std::vector<std::shared_ptr<MessageQueue>> stage1_queues_;
-    std::vector<std::shared_ptr<MessageQueue>> stage2_queues_;
-    
-    PerformanceStats stats_;
-    
+    std::vector<QueueGroup> queue_groups_;
+    const StrategyManager* strategies_ = nullptr;
+    const HiccupMeter* hiccups_ = nullptr;
+
     std::atomic<bool> running_{false};
     std::unique_ptr<std::thread> monitor_thread_;
-    
+
+    // Monitor thread only until stop() joins it
     std::chrono::steady_clock::time_point start_time_;
-    std::chrono::steady_clock::time_point last_report_time_;
-    
-    void monitor_loop();
-    
-    void update_stats();
-    
-    void print_report();
-    
-    void calculate_percentiles(const std::vector<uint64_t>& latencies,
-                              uint64_t& p50, uint64_t& p90, uint64_t& p99, uint64_t& p99_9) const;
-    
-public:
-    Monitor(const SystemConfig* config,
-            ProducerManager* producer_manager,
-            ProcessorManager* processor_manager,
-            StrategyManager* strategy_manager,
-            const std::vector<std::shared_ptr<MessageQueue>>& stage1_queues,
-            const std::vector<std::shared_ptr<MessageQueue>>& stage2_queues);
-    
-    ~Monitor();
-    
-    void start();
-    
-    void stop();
-    
-    void wait_for_completion();
-    
-    const PerformanceStats& get_stats() const { return stats_; }
-    
-    void reset_stats();
-    
-    void print_final_report();
+    Sample first_sample_;
+    Sample last_sample_;
+    double sampled_secs_ = 0;
+    std::array<double, kStages> peak_rate_{};
+    std::vector<size_t> peak_depth_;        // per queue group
+    // Bucket counts at the previous interval, to report each interval alone
+    std::vector<uint64_t> last_latency_buckets_;
+    std::vector<uint64_t> last_stall_buckets_;
+    uint64_t peak_interval_p99_ = 0;        // ticks
+    uint64_t peak_interval_stall_ = 0;
 };
 
-} // namespace MessageRouter
+} // namespace MessageRouter
\ No newline at end of file
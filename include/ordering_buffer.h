@@ -2,50 +2,100 @@
 
 #include "message.h"
 #include "lockfree_queue.h"
-#include <unordered_map>
+#include "trace_ring.h"
+#include <map>
 #include <atomic>
 #include <memory>
 
 namespace MessageRouter {
 
-struct PairHash {
-    std::size_t operator()(const std::pair<ProducerId, MessageType>& p) const {
-        return std::hash<ProducerId>()(p.first) ^ (std::hash<MessageType>()(p.second) << 1);
-    }
-};
-
+// Keeps per-(producer, msg_type) streams in sequence order for one consumer
+// thread. Producers number sequences across all their types, so a stream
+// skips numbers all the time: anything newer than the last forwarded
+// message goes out at once and anything older is a duplicate. A message the
+// output queue refuses waits, with the rest of its stream behind it, in
+// nodes drawn from a pool sized once at construction, so backpressure never
+// touches the allocator; when the pool is full the message is dropped.
 class OrderingBuffer {
 public:
     OrderingBuffer(size_t max_buffer_size = 1000);
-    
+
+    OrderingBuffer(const OrderingBuffer&) = delete;
+    OrderingBuffer& operator=(const OrderingBuffer&) = delete;
+
     bool add_message(const Message& message, std::shared_ptr<MessageQueue> output_queue);
-    
+
     void flush_all(std::shared_ptr<MessageQueue> output_queue);
-    
+
+    // Seed expected sequences, e.g. from journal recovery
+    void restore_sequences(const std::map<std::pair<ProducerId, MessageType>, SequenceNumber>& last_delivered);
+
     size_t get_buffer_size() const;
+    size_t get_peak_buffer_size() const { return peak_buffered_.load(); }
     uint64_t get_messages_buffered() const { return messages_buffered_.load(); }
     uint64_t get_messages_sent() const { return messages_sent_.load(); }
+    uint64_t get_messages_duplicate() const { return messages_duplicate_.load(); }
+    // Messages neither forwarded nor held because the pool was full, and held
+    // messages the output queue still refused on flush
+    uint64_t get_messages_dropped() const { return messages_dropped_.load(); }
+
+    // Record every hold in the consumer thread's trace ring. No pipeline
+    // stage owns a buffer yet (strategies only count violations), so until
+    // one does, ReorderHold never appears in a pipeline trace.
+    void set_trace(TraceRing* trace) { trace_ = trace; }
 
 private:
-    struct MessageNode {
+    struct alignas(64) MessageNode {
         Message message;
-        std::unique_ptr<MessageNode> next;
-        
-        MessageNode(const Message& msg) : message(msg), next(nullptr) {}
+        MessageNode* next;      // sequence order within a stream, or the free list
+    };
+
+    // One slot per (producer, msg_type) stream: the sequence after the last
+    // one accepted, and the accepted messages still waiting for the queue
+    struct Stream {
+        uint64_t key;
+        SequenceNumber expected;
+        MessageNode* pending;       // oldest first
+        MessageNode* pending_tail;
     };
-    
-    std::unordered_map<std::pair<ProducerId, MessageType>, 
-                      std::unique_ptr<MessageNode>, PairHash> buffers_;
-    
-    std::unordered_map<std::pair<ProducerId, MessageType>, 
-                      SequenceNumber, PairHash> expected_sequence_;
-    
+
+    static constexpr uint64_t kEmptyKey = UINT64_MAX;
+
+    static uint64_t stream_key(ProducerId producer_id, MessageType msg_type) {
+        return (static_cast<uint64_t>(producer_id) << 8) | msg_type;
+    }
+
+    // Open addressing with linear probing; grows only when a new stream appears
+    Stream* find_stream(uint64_t key);
+    Stream& insert_stream(uint64_t key, SequenceNumber expected);
+    void grow_streams();
+
+    MessageNode* allocate_node(const Message& message);
+    void free_node(MessageNode* node);
+
+    // Sends message, or holds it behind the stream's waiting messages; false if dropped
+    bool forward(Stream& stream, const Message& message, std::shared_ptr<MessageQueue>& output_queue);
+    // Queues message at the end of the stream's waiting list; false if the pool is full
+    bool hold(Stream& stream, const Message& message);
+    bool send(const Message& message, std::shared_ptr<MessageQueue>& output_queue);
+    // Delivers waiting messages until the queue refuses one
+    void try_send_next(Stream& stream, std::shared_ptr<MessageQueue>& output_queue);
+
+    std::unique_ptr<Stream[]> streams_;
+    size_t stream_capacity_;        // power of two
+    size_t stream_count_;
+
+    std::unique_ptr<MessageNode[]> nodes_;
+    MessageNode* free_nodes_;
+
     size_t max_buffer_size_;
+    std::atomic<size_t> buffered_;
+    std::atomic<size_t> peak_buffered_;
     std::atomic<uint64_t> messages_buffered_;
     std::atomic<uint64_t> messages_sent_;
-    
-    bool try_send_next(const std::pair<ProducerId, MessageType>& key, 
-                      std::shared_ptr<MessageQueue> output_queue);
+    std::atomic<uint64_t> messages_duplicate_;
+    std::atomic<uint64_t> messages_dropped_;
+    TraceRing* trace_;
 };
 
-} // namespace MessageRouter
+} // namespace MessageRouter
\ No newline at end of file
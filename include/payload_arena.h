@@ -0,0 +1,201 @@
+#pragma once
+
+#include "message.h"
+#include "config.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace MessageRouter {
+
+struct PayloadStats {
+    uint64_t inline_payloads = 0;   // bodies small enough to ride in the message
+    uint64_t allocations = 0;       // arena blocks handed out
+    uint64_t releases = 0;          // arena blocks returned
+    uint64_t exhausted = 0;         // sends that found their size class full
+    uint64_t mismatches = 0;        // bodies that did not carry their sequence number
+    uint64_t touched_bytes = 0;     // arena memory ever handed out (resident high-water)
+};
+
+// Synthetic bodies start with the message's sequence number and repeat its
+// low byte after that, so a consumer can tell a body that was freed and
+// reused under it from its own
+inline void fill_payload(uint8_t* body, size_t size, SequenceNumber sequence) {
+    const size_t prefix = size < sizeof(sequence) ? size : sizeof(sequence);
+    std::memcpy(body, &sequence, prefix);
+    if (size > prefix) {
+        std::memset(body + prefix, static_cast<uint8_t>(sequence), size - prefix);
+    }
+}
+
+inline bool check_payload(const uint8_t* body, size_t size, SequenceNumber sequence) {
+    const size_t prefix = size < sizeof(sequence) ? size : sizeof(sequence);
+    return std::memcmp(body, &sequence, prefix) == 0 &&
+           (size == prefix || body[size - 1] == static_cast<uint8_t>(sequence));
+}
+
+// Slab arena owned by one producer. Each size class is a lazily faulted
+// mapping of fixed-size blocks; only the owning producer allocates, from a
+// private free list it refills by taking the whole shared list in one
+// exchange. Any consumer thread releases a block by pushing it onto that
+// shared list with a CAS, so neither side takes a lock or calls malloc.
+class PayloadArena {
+public:
+    static constexpr size_t kSizeClasses = 4;
+    static constexpr std::array<size_t, kSizeClasses> kClassBytes = {64, 256, 1024, 4096};
+
+    PayloadArena(uint16_t arena_id, size_t slots_per_class);
+
+    PayloadArena(const PayloadArena&) = delete;
+    PayloadArena& operator=(const PayloadArena&) = delete;
+
+    // Owner thread only. Returns the block for size bytes and fills handle,
+    // or nullptr when the size class is exhausted.
+    uint8_t* allocate(size_t size, PayloadHandle& handle);
+
+    // Turns the caller's reference into consumers references, one per copy
+    // of the handle it is about to send. Single-consumer handles never pay
+    // for an atomic: the count is only kept once a block is fanned out.
+    void share(PayloadHandle& handle, uint32_t consumers);
+    
+    // Drops one reference; true when it was the last and the caller now
+    // owns the block outright
+    bool drop_reference(const PayloadHandle& handle) {
+        return !handle.shared ||
+               classes_[handle.size_class].refs[handle.slot].fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+    
+    // Any thread; drops one reference and frees the block with the last.
+    // The block must not be touched afterwards.
+    void release(const PayloadHandle& handle);
+
+    uint8_t* resolve(const PayloadHandle& handle) const {
+        const SizeClass& size_class = classes_[handle.size_class];
+        return size_class.base.get() + static_cast<size_t>(handle.slot) * kClassBytes[handle.size_class];
+    }
+
+    uint64_t get_allocations() const { return allocations_.load(); }
+    uint64_t get_releases() const { return releases_.load(); }
+    uint64_t get_exhausted() const { return exhausted_.load(); }
+    void collect_stats(PayloadStats& out) const;
+
+private:
+    friend class PayloadReleaser;
+    
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+    struct MappingDeleter {
+        size_t bytes;
+        void operator()(uint8_t* base) const;
+    };
+
+    struct SizeClass {
+        std::unique_ptr<uint8_t, MappingDeleter> base;
+        uint32_t bumped = 0;                            // owner: slots below this have been used
+        uint32_t local_head = kNoSlot;                  // owner: private free list
+        std::unique_ptr<std::atomic<uint32_t>[]> refs;  // per slot, only meaningful while shared
+        alignas(64) std::atomic<uint32_t> shared_head{kNoSlot};    // released blocks
+        alignas(64) std::atomic<uint32_t> touched{0};   // mirror of bumped for stats
+    };
+
+    // A free block stores the next free slot in its first four bytes
+    uint32_t next_free(const SizeClass& size_class, size_t class_index, uint32_t slot) const;
+    void set_next_free(SizeClass& size_class, size_t class_index, uint32_t slot, uint32_t next);
+    // Frees count blocks already linked first .. last through their free-list words
+    void push_free(size_t class_index, uint32_t first, uint32_t last, uint32_t count);
+
+    uint16_t arena_id_;
+    uint32_t slots_per_class_;
+    std::array<SizeClass, kSizeClasses> classes_;
+
+    std::atomic<uint64_t> allocations_;
+    std::atomic<uint64_t> releases_;
+    std::atomic<uint64_t> exhausted_;
+};
+
+// One arena per producer, plus the lookups consumers need to read and free
+// a message's body wherever it lives
+class PayloadArenas {
+public:
+    PayloadArenas(const PayloadConfig& config, size_t producers);
+
+    PayloadArena* arena(size_t producer) { return arenas_[producer].get(); }
+    size_t size() const { return arenas_.size(); }
+
+    // The body of message, inline or in its arena; nullptr when it has none
+    const uint8_t* data(const Message& message) const {
+        switch (message.payload_kind) {
+            case PayloadKind::Inline: return message.inline_payload;
+            case PayloadKind::Arena: return arenas_[message.payload_handle.arena]->resolve(message.payload_handle);
+            default: return nullptr;
+        }
+    }
+
+    // Prepares message to be sent to consumers receivers; inline bodies are
+    // copied with the message and need nothing
+    void share(Message& message, uint32_t consumers) {
+        if (message.payload_kind == PayloadKind::Arena) {
+            arenas_[message.payload_handle.arena]->share(message.payload_handle, consumers);
+        }
+    }
+    
+    // Drops message's reference to its arena body, returning the block to
+    // its owner with the last one; no-op for inline or empty bodies
+    void release(const Message& message) {
+        if (message.payload_kind == PayloadKind::Arena) {
+            arenas_[message.payload_handle.arena]->release(message.payload_handle);
+        }
+    }
+
+    void collect_stats(PayloadStats& out) const;
+
+private:
+    std::vector<std::unique_ptr<PayloadArena>> arenas_;
+};
+
+// Consumer-side release buffer for one thread. References are dropped as
+// messages are consumed, but blocks whose last reference went are held back
+// and returned kBatchSize at a time, linked into one chain per arena and
+// size class so each chain costs a single CAS on the owner's shared list.
+class PayloadReleaser {
+public:
+    static constexpr size_t kBatchSize = 64;
+    
+    explicit PayloadReleaser(PayloadArenas& arenas);
+    ~PayloadReleaser() { flush(); }
+    
+    PayloadReleaser(const PayloadReleaser&) = delete;
+    PayloadReleaser& operator=(const PayloadReleaser&) = delete;
+    
+    void release(const Message& message) {
+        if (message.payload_kind != PayloadKind::Arena ||
+            !arenas_.arena(message.payload_handle.arena)->drop_reference(message.payload_handle)) {
+            return;
+        }
+        pending_[pending_count_++] = message.payload_handle;
+        if (pending_count_ == kBatchSize) {
+            flush();
+        }
+    }
+    
+    // Returns every held block; call before going idle so producers can reuse them
+    void flush();
+    
+private:
+    struct Chain {
+        uint32_t first;
+        uint32_t last;
+        uint32_t count = 0;
+    };
+    
+    PayloadArenas& arenas_;
+    std::array<PayloadHandle, kBatchSize> pending_;
+    size_t pending_count_;
+    std::vector<Chain> chains_;     // arena * kSizeClasses + size_class
+};
+
+} // namespace MessageRouter
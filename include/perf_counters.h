@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace MessageRouter {
+
+enum class PerfEvent : uint8_t {
+    Cycles,
+    Instructions,
+    LlcMisses,
+    BranchMisses,
+    Count
+};
+
+constexpr size_t kPerfEventCount = static_cast<size_t>(PerfEvent::Count);
+
+const char* perf_event_name(PerfEvent event);
+
+// Counter values of one or more threads; an event the kernel refused to
+// open is not available and reads 0
+struct PerfSample {
+    uint64_t values[kPerfEventCount] = {};
+    bool available[kPerfEventCount] = {};
+    uint32_t threads = 0;
+
+    uint64_t operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+    bool has(PerfEvent event) const { return available[static_cast<size_t>(event)]; }
+    void add(const PerfSample& other);
+    // Counts of this sample since earlier, a read of the same counters
+    PerfSample since(const PerfSample& earlier) const;
+};
+
+// Per-message costs; a field is negative when its events were not available
+struct PerfCost {
+    double cycles = -1;
+    double ipc = -1;
+    double llc_misses = -1;
+    double branch_misses = -1;
+};
+
+PerfCost per_message(const PerfSample& sample, uint64_t messages);
+
+// Hardware counters of the calling thread, user space only, opened as one
+// perf_event_open group so they are scheduled onto the PMU together.
+// Counts are scaled up when the kernel multiplexed the group.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Opens and starts the counters; false (see error()) if not even
+    // cycles could be opened, e.g. no PMU or perf_event_paranoid too high
+    bool open();
+    void close();
+    bool is_open() const { return leader_ >= 0; }
+    const std::string& error() const { return error_; }
+
+    // Counts since open()
+    void read(PerfSample& out) const;
+
+private:
+    int fds_[kPerfEventCount];
+    int group_index_[kPerfEventCount];  // position in the group read, -1 if not open
+    int leader_;
+    size_t opened_;
+    std::string error_;
+};
+
+// Per-stage totals of the threads that finished counting
+class PerfRegistry {
+public:
+    static PerfRegistry& instance();
+
+    // Threads only count once enabled; call before the pipeline starts
+    void enable() { enabled_ = true; }
+    bool enabled() const { return enabled_; }
+
+    void add(const std::string& stage, const PerfSample& busy, const PerfSample& idle);
+    void set_error(const std::string& error);
+
+    // Cost per message of each stage from its busy counts, with its
+    // messages taken from the metrics registry, and the share of cycles
+    // spent idle; or why the counters are unavailable
+    void print_report() const;
+
+private:
+    PerfRegistry() = default;
+
+    struct StageSample {
+        PerfSample busy;
+        PerfSample idle;
+    };
+
+    bool enabled_ = false;
+    mutable std::mutex mutex_;
+    std::map<std::string, StageSample> stages_;
+    std::string error_;
+};
+
+// Counts the calling thread from construction to destruction into its
+// stage's totals, split into busy and idle polls; does nothing unless the
+// registry is enabled. A stage loop brackets each poll with begin_poll()
+// and end_poll(worked). The counters are only read when the thread turns
+// busy or idle, and at the start of each idle poll, so a busy streak costs
+// two reads however long it runs.
+class ThreadPerf {
+public:
+    explicit ThreadPerf(std::string stage);
+    ~ThreadPerf();
+
+    ThreadPerf(const ThreadPerf&) = delete;
+    ThreadPerf& operator=(const ThreadPerf&) = delete;
+
+    void begin_poll() {
+        if (idle_ && counters_.is_open()) {
+            charge(idle_counts_);
+        }
+    }
+
+    void end_poll(bool worked) {
+        if (worked == idle_ && counters_.is_open()) {
+            // The poll that turned busy, or the busy streak up to this empty poll
+            charge(busy_counts_);
+            idle_ = !worked;
+        }
+    }
+
+private:
+    // Adds the counts since the previous read to into
+    void charge(PerfSample& into);
+
+    std::string stage_;
+    PerfCounters counters_;
+    bool idle_;
+    PerfSample last_;
+    PerfSample busy_counts_;
+    PerfSample idle_counts_;
+};
+
+} // namespace MessageRouter
\ No newline at end of file
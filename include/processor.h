@@ -3,6 +3,13 @@
 #include "message.h"
 #include "lockfree_queue.h"
 #include "config.h"
+#include "processor_autoscaler.h"
+#include "spill_file.h"
+#include "snapshot.h"
+#include "ttl_policy.h"
+#include "payload_arena.h"
+#include "metrics_registry.h"
+#include "trace_ring.h"
 #include <atomic>
 #include <thread>
 #include <memory>
@@ -21,11 +28,15 @@ public:
     void stop();
     bool is_running() const { return running_.load(); }
     
-    uint64_t get_messages_processed() const { return messages_processed_.load(); }
+    uint64_t get_messages_processed() const { return metrics_->get(Metric::MessagesProcessed); }
+    uint64_t get_messages_expired() const { return metrics_->get(Metric::MessagesExpired); }
+    size_t get_input_depth() const { return input_queue_->size(); }
     
 private:
     void processor_loop();
+    size_t process_batch(size_t max_messages);
     void simulate_processing(Message& message);
+    void forward_snapshot_marker(const Message& marker);
     
     ProcessorId processor_id_;
     const SystemConfig* config_;
@@ -35,9 +46,14 @@ private:
     std::atomic<bool> running_;
     std::unique_ptr<std::thread> processor_thread_;
     
-    std::atomic<uint64_t> messages_processed_;
+    ThreadMetrics metrics_;
+    ThreadTrace trace_;     // written by whichever thread owns the lane
+    std::unique_ptr<SpillFile> spill_;
+    TtlPolicy ttl_;
+    PayloadArenas* payloads_;   // releases bodies of messages dropped here
     
     friend class ProcessorManager;
+    friend class ProcessorAutoscaler;
 };
 
 class ProcessorManager {
@@ -52,12 +68,20 @@ public:
     void wait_for_completion();
     
     uint64_t get_total_messages_processed() const;
+    uint64_t get_total_messages_expired() const;
+    void collect_spill_stats(SpillStats& out) const;
+    // Free the bodies of messages dropped here; call before start_all()
+    void set_payload_arenas(PayloadArenas* arenas);
+    
+    // Non-null when processor workers are elastic
+    const ProcessorAutoscaler* get_autoscaler() const { return autoscaler_.get(); }
     
 private:
     const SystemConfig* config_;
     std::vector<std::shared_ptr<MessageQueue>> input_queues_;
     std::vector<std::shared_ptr<MessageQueue>> output_queues_;
     std::vector<std::unique_ptr<Processor>> processors_;
+    std::unique_ptr<ProcessorAutoscaler> autoscaler_;
 };
 
 } // namespace MessageRouter
\ No newline at end of file
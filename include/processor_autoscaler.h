@@ -0,0 +1,77 @@
+#pragma once
+
+#include "config.h"
+#include "trace_ring.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <vector>
+
+namespace MessageRouter {
+
+class Processor;
+
+// Elastic worker pool for processors. Every Processor is a lane (its input
+// and output queue pair); a pool of up to one worker per lane serves them.
+// A control thread samples stage1 queue depth and worker utilization and
+// parks or wakes workers, moving lane ownership between them. A lane is only
+// ever drained by its current owner, and ownership changes hands through an
+// explicit release/acquire, so per-lane ordering is preserved across handoffs.
+class ProcessorAutoscaler {
+public:
+    ProcessorAutoscaler(const ProcessorAutoscaleConfig& config, const TraceConfig& trace,
+                        const std::vector<Processor*>& lanes);
+    ~ProcessorAutoscaler();
+
+    void start();
+    void stop();
+    void wait_for_completion();
+    bool is_running() const { return running_.load(); }
+
+    size_t get_active_workers() const { return active_workers_.load(); }
+    size_t get_peak_active_workers() const { return peak_active_workers_.load(); }
+    uint64_t get_scale_ups() const { return scale_ups_.load(); }
+    uint64_t get_scale_downs() const { return scale_downs_.load(); }
+
+    static constexpr size_t kBatchBudget = 256;
+
+private:
+    static constexpr int kNoOwner = -1;
+
+    struct alignas(64) Lane {
+        Processor* processor;
+        std::atomic<int> owner{kNoOwner};
+        std::atomic<int> target{kNoOwner};
+    };
+
+    struct alignas(64) Worker {
+        Worker(const TraceConfig& config, size_t index)
+            : trace(config.enabled, config.records_per_thread, "autoscaler-" + std::to_string(index)) {}
+
+        std::atomic<bool> active{false};
+        std::atomic<uint64_t> busy_polls{0};
+        std::atomic<uint64_t> total_polls{0};
+        std::unique_ptr<std::thread> thread;
+        ThreadTrace trace;      // parks and unparks
+    };
+
+    void worker_loop(int worker_index);
+    void control_loop();
+    void release_lanes(int worker_index);
+    void resize(size_t active);
+
+    ProcessorAutoscaleConfig config_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::atomic<bool> running_;
+    std::unique_ptr<std::thread> control_thread_;
+
+    std::atomic<size_t> active_workers_;
+    std::atomic<size_t> peak_active_workers_;
+    std::atomic<uint64_t> scale_ups_;
+    std::atomic<uint64_t> scale_downs_;
+};
+
+} // namespace MessageRouter
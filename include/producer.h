@@ -3,13 +3,23 @@
 #include "message.h"
 #include "lockfree_queue.h"
 #include "config.h"
+#include "replay_producer.h"
+#include "ingress.h"
+#include "spill_file.h"
+#include "snapshot.h"
+#include "payload_arena.h"
+#include "metrics_registry.h"
 #include <atomic>
+#include <map>
 #include <thread>
 #include <memory>
+#include <random>
 #include <vector>
 
 namespace MessageRouter {
 
+class ThreadPerf;
+
 class Producer {
 public:
     Producer(ProducerId id, const SystemConfig* config, std::shared_ptr<MessageQueue> output_queue);
@@ -19,10 +29,20 @@ public:
     void stop();
     bool is_running() const { return running_.load(); }
     
-    uint64_t get_messages_produced() const { return messages_produced_.load(); }
+    uint64_t get_messages_produced() const { return metrics_->get(Metric::MessagesProduced); }
+    uint64_t get_sends_behind_schedule() const { return metrics_->get(Metric::SendsBehindSchedule); }
+    uint64_t get_max_schedule_lag() const { return max_schedule_lag_.load(); }
+    uint64_t get_inline_payloads() const { return metrics_->get(Metric::InlinePayloads); }
     
 private:
     void producer_loop();
+    void open_loop(ThreadPerf& perf);
+    // Marks the stream when the coordinator has requested a new snapshot epoch
+    void poll_snapshot();
+    // Gives message a synthetic body when payloads are enabled
+    void attach_payload(Message& message, std::mt19937& gen);
+    // A message that never made it into the queue gives its body back
+    void discard_payload(const Message& message);
     
     ProducerId producer_id_;
     const SystemConfig* config_;
@@ -31,8 +51,13 @@ private:
     std::atomic<bool> running_;
     std::unique_ptr<std::thread> producer_thread_;
     
-    std::atomic<uint64_t> messages_produced_;
+    ThreadMetrics metrics_;
+    std::atomic<uint64_t> max_schedule_lag_;     // ticks
     SequenceNumber next_sequence_;
+    std::unique_ptr<SpillFile> spill_;
+    SnapshotCoordinator* snapshot_;
+    uint64_t snapshot_epoch_;
+    PayloadArena* payload_arena_;
     
     friend class ProducerManager;
 };
@@ -48,11 +73,30 @@ public:
     void wait_for_completion();
     
     uint64_t get_total_messages_produced() const;
+    uint64_t get_total_sends_behind_schedule() const;
+    uint64_t get_max_schedule_lag_ns() const;
+    // Resume numbering after the highest sequence a previous run delivered
+    void restore_sequences(const std::map<ProducerId, SequenceNumber>& last_delivered);
+    void collect_spill_stats(SpillStats& out) const;
+    // Take part in pipeline snapshots; call before start_all()
+    void set_snapshot_coordinator(SnapshotCoordinator* snapshot);
+    // Attach bodies from each producer's arena; call before start_all()
+    void set_payload_arenas(PayloadArenas* arenas);
+    void collect_payload_stats(PayloadStats& out) const;
+    
+    // Non-null when a capture file replaces the synthetic producers
+    const ReplayProducer* get_replay() const { return replay_.get(); }
+    // Non-null when socket ingress replaces the synthetic producers
+    const IngressServer* get_ingress() const { return ingress_.get(); }
+    const IngressLoadClient* get_loopback_client() const { return loopback_client_.get(); }
     
 private:
     const SystemConfig* config_;
     std::vector<std::shared_ptr<MessageQueue>> output_queues_;
     std::vector<std::unique_ptr<Producer>> producers_;
+    std::unique_ptr<ReplayProducer> replay_;
+    std::unique_ptr<IngressServer> ingress_;
+    std::unique_ptr<IngressLoadClient> loopback_client_;
 };
 
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include "message_capture.h"
+#include "config.h"
+#include "metrics_registry.h"
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+
+namespace MessageRouter {
+
+// Streams a capture file into the producer queues in place of the synthetic
+// producers. Each record keeps its producer_id and sequence_number and goes
+// to the queue of producer_id % queue count; timestamp is re-stamped at send.
+class ReplayProducer {
+public:
+    ReplayProducer(const ReplayConfig& config,
+                   const std::vector<std::shared_ptr<MessageQueue>>& output_queues);
+    ~ReplayProducer();
+
+    void start();
+    void stop();
+    void wait_for_completion();
+    bool is_running() const { return running_.load(); }
+    bool is_finished() const { return finished_.load(); }
+
+    uint64_t get_messages_produced() const { return metrics_->get(Metric::MessagesProduced); }
+    uint64_t get_records_total() const { return reader_.header().record_count; }
+
+private:
+    void replay_loop();
+
+    ReplayConfig config_;
+    std::vector<std::shared_ptr<MessageQueue>> output_queues_;
+    MessageCaptureReader reader_;
+
+    std::atomic<bool> running_;
+    std::atomic<bool> finished_;
+    std::unique_ptr<std::thread> replay_thread_;
+
+    ThreadMetrics metrics_;
+};
+
+} // namespace MessageRouter
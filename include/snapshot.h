@@ -0,0 +1,215 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include "config.h"
+#include "latency_histogram.h"
+#include <array>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MessageRouter {
+
+// Snapshot barrier markers travel through the same SPSC queues as data.
+// The producer id is reserved so no real producer collides with it, and
+// sequence_number carries the snapshot epoch.
+constexpr ProducerId kSnapshotMarkerProducer = 0xFFFFFFFF;
+
+inline bool is_snapshot_marker(const Message& message) {
+    return message.producer_id == kSnapshotMarkerProducer;
+}
+
+inline Message make_snapshot_marker(uint64_t epoch) {
+    return Message(0, kSnapshotMarkerProducer, epoch, 0);
+}
+
+// Last delivered sequence for one (producer, type) key of one strategy
+struct SnapshotSequenceRecord {
+    StrategyId strategy_id;
+    ProducerId producer_id;
+    SequenceNumber last_delivered;
+    MessageType msg_type;
+    uint8_t reserved[7];
+};
+static_assert(sizeof(SnapshotSequenceRecord) == 24, "SnapshotSequenceRecord is a fixed 24-byte on-disk format");
+
+// A message that was in flight on a router input when the snapshot was cut.
+// stage 1 = Stage1Router input (producer queue), 2 = Stage2Router input
+// (processor queue); on restore it is pushed back into that queue.
+struct SnapshotChannelRecord {
+    uint32_t stage;
+    uint32_t input;
+    Message message;
+};
+static_assert(sizeof(SnapshotChannelRecord) == 128, "SnapshotChannelRecord is a fixed 128-byte on-disk format");
+
+// File layout: header, stage1 routes[256], stage2 routes[256], last
+// sequence per producer, sequence records, then channel records at the
+// next 64-byte boundary.
+struct SnapshotHeader {
+    static constexpr uint64_t kMagic = 0x31504E53524D4D4DULL; // "MMMRSNP1"
+    static constexpr uint32_t kVersion = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t producer_count;
+    uint64_t epoch;
+    uint32_t processor_count;
+    uint32_t strategy_count;
+    uint64_t sequence_records;
+    uint64_t channel_records;
+    uint64_t file_bytes;
+    uint8_t reserved[8];
+};
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader is a fixed 64-byte on-disk format");
+
+// Router-side half of the barrier protocol, owned by the router thread.
+// The first marker of an epoch opens the snapshot: the router forwards the
+// marker downstream at once instead of waiting for the other inputs, and
+// every message popped from an input whose marker has not arrived yet is
+// recorded as channel state. The snapshot is complete once every input
+// has delivered its marker.
+class SnapshotBarrier {
+public:
+    SnapshotBarrier(uint32_t stage, size_t inputs);
+
+    // Returns true when the marker opens a new snapshot and must be forwarded
+    bool on_marker(size_t input, uint64_t epoch);
+    bool recording(size_t input) const { return active_ && !seen_[input]; }
+    void record(size_t input, const Message& message);
+    bool complete() const { return active_ && remaining_ == 0; }
+    uint64_t epoch() const { return epoch_; }
+    // Hands over the recorded channel state and closes the snapshot
+    std::vector<SnapshotChannelRecord> take_channel_state();
+
+private:
+    uint32_t stage_;
+    std::vector<bool> seen_;
+    size_t remaining_;
+    uint64_t epoch_;
+    bool active_;
+    std::vector<SnapshotChannelRecord> channel_;
+};
+
+// Periodically cuts a consistent snapshot of the pipeline without stopping
+// it (Chandy-Lamport style). Producers poll the requested epoch, report
+// their sequence counter and inject a marker; routers forward the marker
+// and record in-flight messages; strategies report their per-key sequence
+// state when the marker reaches them. Once every piece of an epoch is in,
+// the snapshot thread writes it to a memory-mapped file and renames it over
+// the previous one, so a crash never leaves a torn snapshot behind.
+class SnapshotCoordinator {
+public:
+    SnapshotCoordinator(const SystemConfig* config, uint64_t first_epoch);
+    ~SnapshotCoordinator();
+
+    void start();
+    void stop();
+    void wait_for_completion();
+    bool is_running() const { return running_.load(); }
+
+    // Epoch producers should mark next; 0 until the first snapshot is due
+    uint64_t get_requested_epoch() const { return requested_epoch_.load(std::memory_order_acquire); }
+
+    // Called from pipeline threads as the marker passes them
+    void report_producer(ProducerId producer_id, uint64_t epoch, SequenceNumber last_sequence);
+    void report_channel_state(uint64_t epoch, std::vector<SnapshotChannelRecord>&& records);
+    void report_strategy(StrategyId strategy_id, uint64_t epoch,
+                         const std::map<std::pair<ProducerId, MessageType>, SequenceNumber>& expected_sequence);
+
+    uint64_t get_snapshots_written() const { return snapshots_written_.load(); }
+    uint64_t get_snapshots_abandoned() const { return snapshots_abandoned_.load(); }
+    // Cut but not written: the file could not be created, mapped or synced
+    uint64_t get_snapshots_failed() const { return snapshots_failed_.load(); }
+    uint64_t get_last_epoch() const { return last_epoch_.load(); }
+    uint64_t get_last_bytes() const { return last_bytes_.load(); }
+    uint64_t get_last_channel_records() const { return last_channel_records_.load(); }
+    // Time from requesting an epoch to its file being durable, in TscClock ticks; read after stop()
+    const LatencyHistogram& get_snapshot_latency() const { return snapshot_latency_; }
+
+private:
+    struct Pending {
+        uint64_t epoch = 0;
+        uint64_t requested_at = 0;
+        size_t producers_reported = 0;
+        size_t strategies_reported = 0;
+        size_t routers_reported = 0;
+        std::vector<SequenceNumber> producer_sequences;
+        std::vector<SnapshotSequenceRecord> sequences;
+        std::vector<SnapshotChannelRecord> channel_state;
+    };
+
+    void snapshot_loop();
+    void write_snapshot(const Pending& pending);
+
+    const SystemConfig* config_;
+    uint64_t interval_ticks_;
+    uint64_t timeout_ticks_;
+    uint64_t next_epoch_;
+
+    std::mutex mutex_;
+    Pending pending_;
+    bool in_progress_;
+    std::atomic<uint64_t> requested_epoch_;
+
+    std::atomic<bool> running_;
+    std::unique_ptr<std::thread> snapshot_thread_;
+
+    std::atomic<uint64_t> snapshots_written_;
+    std::atomic<uint64_t> snapshots_abandoned_;
+    std::atomic<uint64_t> snapshots_failed_;
+    std::atomic<uint64_t> last_epoch_;
+    std::atomic<uint64_t> last_bytes_;
+    std::atomic<uint64_t> last_channel_records_;
+    LatencyHistogram snapshot_latency_;
+};
+
+// Outcome of pushing recorded in-flight messages back into the queues
+struct ChannelRestore {
+    size_t restored = 0;
+    size_t dropped = 0;     // no such input, or its queue was full
+};
+
+// A snapshot file mapped back read-only for a restart
+class SnapshotImage {
+public:
+    // Returns null when the file does not exist or is not a valid snapshot
+    static std::unique_ptr<SnapshotImage> open(const std::string& path);
+    ~SnapshotImage();
+
+    SnapshotImage(const SnapshotImage&) = delete;
+    SnapshotImage& operator=(const SnapshotImage&) = delete;
+
+    uint64_t epoch() const { return header_->epoch; }
+    uint64_t get_sequence_records() const { return header_->sequence_records; }
+    uint64_t get_channel_records() const { return header_->channel_records; }
+
+    // Same component counts and routing tables as config
+    bool matches(const SystemConfig& config) const;
+
+    // Last sequence each producer used before the snapshot
+    std::map<ProducerId, SequenceNumber> producer_sequences() const;
+    // Last delivered sequence per (producer, type), indexed by strategy id
+    std::vector<std::map<std::pair<ProducerId, MessageType>, SequenceNumber>> strategy_sequences() const;
+    // Pushes the in-flight messages back into the router input queues they
+    // were recorded on; call before the pipeline starts. An input records at
+    // most what its queue held ahead of the marker, so an empty queue takes
+    // them all; with nothing draining the queues yet a refused push cannot
+    // be retried, and is counted as dropped.
+    ChannelRestore restore_channel_state(const std::vector<std::shared_ptr<MessageQueue>>& producer_queues,
+                                 const std::vector<std::shared_ptr<MessageQueue>>& processor_queues) const;
+
+private:
+    SnapshotImage(const uint8_t* data, size_t bytes);
+
+    const uint8_t* data_;
+    size_t bytes_;
+    const SnapshotHeader* header_;
+};
+
+} // namespace MessageRouter
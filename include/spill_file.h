@@ -0,0 +1,83 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include <atomic>
+#include <string>
+
+namespace MessageRouter {
+
+struct SpillStats {
+    uint64_t messages_spilled = 0;
+    uint64_t messages_lost = 0;
+    uint64_t pending = 0;
+    uint64_t peak_bytes = 0;        // largest single-edge backlog
+    uint64_t compactions = 0;
+};
+
+// Disk overflow for one SPSC edge, owned by the edge's producing thread.
+// When the queue is full, messages are appended to a memory-mapped spill
+// file instead of being dropped; while anything is spilled, new messages
+// queue up behind it, and drain() moves spilled messages back into the
+// queue in FIFO order as the consumer frees slots. max_bytes bounds the
+// unread backlog; once the drained prefix outgrows it, the backlog is moved
+// to the front of the file. The file is created on the first spill and
+// unlinked immediately, so nothing is left behind.
+class SpillFile {
+public:
+    SpillFile(const std::string& directory, const std::string& name, size_t max_bytes);
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // Pushes to the queue, or behind the spilled backlog. Returns false only
+    // when the backlog is at max_bytes and the message is lost.
+    bool offer(MessageQueue& queue, const Message& message) {
+        if (pending_ != 0) {
+            drain(queue);
+        }
+        if (pending_ == 0 && queue.try_push(message)) {
+            return true;
+        }
+        return spill(message);
+    }
+
+    // Moves spilled messages into the queue while it has room; returns how many
+    size_t drain(MessageQueue& queue);
+    bool empty() const { return pending_ == 0; }
+
+    uint64_t get_messages_spilled() const { return messages_spilled_.load(); }
+    uint64_t get_messages_lost() const { return messages_lost_.load(); }
+    uint64_t get_pending() const { return pending_count_.load(); }
+    uint64_t get_peak_bytes() const { return peak_bytes_.load(); }
+    uint64_t get_compactions() const { return compactions_.load(); }
+    void collect_stats(SpillStats& out) const;
+
+    static constexpr size_t kGrowBytes = 64 << 20;
+    // Drained prefixes at least this large are truncated or compacted away
+    static constexpr size_t kReclaimBytes = 1 << 20;
+
+private:
+    bool spill(const Message& message);
+    void compact();
+    void grow();
+    void reset();
+
+    std::string path_;
+    size_t max_bytes_;
+    int fd_;
+    uint8_t* data_;
+    size_t mapped_bytes_;
+    size_t read_pos_;
+    size_t write_pos_;
+    size_t pending_;
+
+    std::atomic<uint64_t> messages_spilled_;
+    std::atomic<uint64_t> messages_lost_;
+    std::atomic<uint64_t> pending_count_;
+    std::atomic<uint64_t> peak_bytes_;
+    std::atomic<uint64_t> compactions_;
+};
+
+} // namespace MessageRouter
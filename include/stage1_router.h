@@ -3,6 +3,14 @@
 #include "message.h"
 #include "lockfree_queue.h"
 #include "config.h"
+#include "message_capture.h"
+#include "spill_file.h"
+#include "snapshot.h"
+#include "batch_classifier.h"
+#include "payload_arena.h"
+#include "metrics_registry.h"
+#include "trace_ring.h"
+#include "hop_tracer.h"
 #include <vector>
 #include <memory>
 #include <atomic>
@@ -22,21 +30,47 @@ public:
     void stop();
     bool is_running() const { return running_.load(); }
 
-    uint64_t get_messages_routed() const { return messages_routed_.load(); }
-    uint64_t get_routing_errors() const { return routing_errors_.load(); }
+    uint64_t get_messages_routed() const { return metrics_->get(Metric::MessagesRouted); }
+    uint64_t get_routing_errors() const { return metrics_->get(Metric::RoutingErrors); }
+    void collect_spill_stats(SpillStats& out) const;
+
+    // Record messages as they are popped from / pushed to this router's queues
+    void set_input_capture(MessageCaptureWriter* capture) { input_capture_ = capture; }
+    void set_output_capture(MessageCaptureWriter* capture) { output_capture_ = capture; }
+
+    // Forward snapshot markers and record in-flight messages; call before start()
+    void set_snapshot_coordinator(SnapshotCoordinator* snapshot);
+    
+    // Free the bodies of messages dropped here; call before start()
+    void set_payload_arenas(PayloadArenas* arenas) { payloads_ = arenas; }
+    
+    // Stamp this hop on sampled messages; call before start()
+    void set_hop_tracer(HopTracer* tracer) { hop_tracer_ = tracer; }
 
 private:
     void routing_loop();
+    void handle_snapshot_marker(size_t input, const Message& marker);
+    void route_batch(size_t input, const Message* batch, size_t count);
+    // Pushes one processor's run in bulk; returns how many were delivered
+    size_t send_run(size_t processor_id, const Message* run, size_t count);
 
     const SystemConfig* config_;
     std::vector<std::shared_ptr<MessageQueue>> input_queues_;
     std::vector<std::shared_ptr<MessageQueue>> output_queues_;
+    MessageCaptureWriter* input_capture_;
+    MessageCaptureWriter* output_capture_;
+    std::vector<std::unique_ptr<SpillFile>> output_spills_;   // empty unless overflow is enabled
+    SnapshotCoordinator* snapshot_;
+    std::unique_ptr<SnapshotBarrier> snapshot_barrier_;
+    BatchClassifier classifier_;
+    PayloadArenas* payloads_;
+    HopTracer* hop_tracer_;
 
     std::atomic<bool> running_;
     std::unique_ptr<std::thread> router_thread_;
 
-    std::atomic<uint64_t> messages_routed_;
-    std::atomic<uint64_t> routing_errors_;
+    ThreadMetrics metrics_;
+    ThreadTrace trace_;
 };
 
 } // namespace MessageRouter
\ No newline at end of file
@@ -3,6 +3,18 @@
 #include "message.h"
 #include "lockfree_queue.h"
 #include "config.h"
+#include "message_capture.h"
+#include "spill_file.h"
+#include "snapshot.h"
+#include "dedup_filter.h"
+#include "conflation_table.h"
+#include "batch_classifier.h"
+#include "payload_arena.h"
+#include "metrics_registry.h"
+#include "trace_ring.h"
+#include "hop_tracer.h"
+#include "strategy_scheduler.h"
+#include <array>
 #include <vector>
 #include <memory>
 #include <atomic>
@@ -22,21 +34,61 @@ public:
     void stop();
     bool is_running() const { return running_.load(); }
 
-    uint64_t get_messages_routed() const { return messages_routed_.load(); }
-    uint64_t get_routing_errors() const { return routing_errors_.load(); }
+    uint64_t get_messages_routed() const { return metrics_->get(Metric::MessagesRouted); }
+    uint64_t get_routing_errors() const { return metrics_->get(Metric::RoutingErrors); }
+    void collect_spill_stats(SpillStats& out) const;
+
+    // Non-null when duplicate deliveries are filtered
+    const DedupFilter* get_dedup() const { return dedup_.get(); }
+
+    // Record messages as they are popped from / pushed to this router's queues
+    void set_input_capture(MessageCaptureWriter* capture) { input_capture_ = capture; }
+    void set_output_capture(MessageCaptureWriter* capture) { output_capture_ = capture; }
+
+    // Forward snapshot markers and record in-flight messages; call before start()
+    void set_snapshot_coordinator(SnapshotCoordinator* snapshot);
+    
+    // Free the bodies of messages dropped here; call before start()
+    void set_payload_arenas(PayloadArenas* arenas) { payloads_ = arenas; }
+    
+    // Stamp this hop on sampled messages; call before start()
+    void set_hop_tracer(HopTracer* tracer) { hop_tracer_ = tracer; }
+
+    // Wake scheduled strategies after delivering into their queue
+    void set_strategy_scheduler(StrategyScheduler* scheduler) { strategy_scheduler_ = scheduler; }
+
+    // Publish conflated types into the strategies' latest-value tables; call before start()
+    void set_conflation_tables(const std::vector<ConflationTable*>& tables) { conflation_tables_ = tables; }
 
 private:
     void routing_loop();
+    void handle_snapshot_marker(size_t input, const Message& marker);
+    void route_batch(size_t input, Message* batch, size_t count);
+    // Pushes one strategy's run in bulk; returns how many were delivered
+    size_t send_run(size_t strategy_id, const Message* run, size_t count);
 
     const SystemConfig* config_;
     std::vector<std::shared_ptr<MessageQueue>> input_queues_;
     std::vector<std::shared_ptr<MessageQueue>> output_queues_;
+    MessageCaptureWriter* input_capture_;
+    MessageCaptureWriter* output_capture_;
+    std::vector<std::unique_ptr<SpillFile>> output_spills_;   // empty unless overflow is enabled
+    SnapshotCoordinator* snapshot_;
+    std::unique_ptr<SnapshotBarrier> snapshot_barrier_;
+    StrategyScheduler* strategy_scheduler_;
+    BatchClassifier classifier_;
+    PayloadArenas* payloads_;
+    HopTracer* hop_tracer_;
+    std::unique_ptr<DedupFilter> dedup_;
+    std::vector<ConflationTable*> conflation_tables_;   // indexed by strategy id
+    std::array<bool, 256> conflated_;
+    bool conflating_;                                   // any type conflated
 
     std::atomic<bool> running_;
     std::unique_ptr<std::thread> router_thread_;
 
-    std::atomic<uint64_t> messages_routed_;
-    std::atomic<uint64_t> routing_errors_;
+    ThreadMetrics metrics_;
+    ThreadTrace trace_;
 };
 
 } // namespace MessageRouter
\ No newline at end of file
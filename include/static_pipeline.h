@@ -0,0 +1,270 @@
+#pragma once
+
+#include "message.h"
+#include "lockfree_queue.h"
+#include "latency_histogram.h"
+#include "tsc_clock.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace MessageRouter {
+
+// A pipeline shape fixed at compile time: stage counts plus both routing
+// tables. Producers emit msg_types [0, msg_types) uniformly.
+struct StaticTopology {
+    size_t producers = 0;
+    size_t processors = 0;
+    size_t strategies = 0;
+    size_t msg_types = 0;
+    std::array<uint8_t, 256> stage1{};   // msg_type -> processor
+    std::array<uint8_t, 256> stage2{};   // msg_type -> strategy
+};
+
+// Every route a producer can hit must name an existing stage
+constexpr bool is_routable(const StaticTopology& topology) {
+    if (topology.producers == 0 || topology.processors == 0 || topology.strategies == 0 ||
+        topology.msg_types == 0 || topology.msg_types > 256) {
+        return false;
+    }
+    for (size_t msg_type = 0; msg_type < topology.msg_types; ++msg_type) {
+        if (topology.stage1[msg_type] >= topology.processors || topology.stage2[msg_type] >= topology.strategies) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Calls f.template operator()<I>() for I = 0 .. N-1
+template<size_t N, typename F>
+inline void for_each_index(F&& f) {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (f.template operator()<I>(), ...);
+    }(std::make_index_sequence<N>{});
+}
+
+// Calls f.template operator()<I>() for the I equal to index, so the callee
+// sees a constant and can address a fixed queue directly
+template<size_t N, typename F>
+inline void dispatch_index(size_t index, F&& f) {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        ((index == I ? (f.template operator()<I>(), true) : false) || ...);
+    }(std::make_index_sequence<N>{});
+}
+
+// The same producer -> Stage1 -> processors -> Stage2 -> strategies pipeline
+// as the JSON-configured system, generated from a StaticTopology: queues sit
+// in fixed-size arrays inside the pipeline, every hop indexes them with a
+// compile-time constant, and routing is a constexpr table lookup with no
+// bounds check (is_routable() proves it at compile time). There are no
+// optional stages; this is the ceiling the runtime path can be measured against.
+template<StaticTopology Topology, size_t QueueSize = 65536>
+class StaticPipeline {
+    static_assert(is_routable(Topology), "Every producer msg_type needs an existing processor and strategy");
+
+public:
+    using Queue = LockFreeSPSCQueue<Message, QueueSize>;
+
+    static constexpr size_t kProducers = Topology.producers;
+    static constexpr size_t kProcessors = Topology.processors;
+    static constexpr size_t kStrategies = Topology.strategies;
+
+    StaticPipeline()
+        : running_(false)
+        , producing_(false)
+        , messages_produced_(0)
+        , messages_processed_(0)
+        , messages_delivered_(0)
+        , ordering_violations_(0) {}
+
+    ~StaticPipeline() { stop(); }
+
+    StaticPipeline(const StaticPipeline&) = delete;
+    StaticPipeline& operator=(const StaticPipeline&) = delete;
+
+    // Starts every stage thread; each producer paces itself to messages_per_sec
+    void start(double messages_per_sec) {
+        if (running_.load()) {
+            return;
+        }
+        running_.store(true);
+        producing_.store(true);
+        const uint64_t interval_ticks = TscClock::nanos_to_ticks(static_cast<uint64_t>(1e9 / messages_per_sec));
+        stage_threads_.emplace_back([this] { stage1_loop(); });
+        for_each_index<kProcessors>([&]<size_t P>() {
+            stage_threads_.emplace_back([this] { processor_loop<P>(); });
+        });
+        stage_threads_.emplace_back([this] { stage2_loop(); });
+        for_each_index<kStrategies>([&]<size_t S>() {
+            stage_threads_.emplace_back([this] { strategy_loop<S>(); });
+        });
+        for_each_index<kProducers>([&]<size_t P>() {
+            producer_threads_.emplace_back([this, interval_ticks] { producer_loop<P>(interval_ticks); });
+        });
+    }
+
+    // Stops the producers, gives the stages up to drain_timeout to deliver
+    // what is in flight, then stops the stages
+    void stop(std::chrono::milliseconds drain_timeout = std::chrono::milliseconds(1000)) {
+        producing_.store(false);
+        join(producer_threads_);
+        const auto deadline = std::chrono::steady_clock::now() + drain_timeout;
+        while (running_.load() && messages_delivered_.load() < messages_produced_.load() &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        running_.store(false);
+        join(stage_threads_);
+    }
+
+    uint64_t get_messages_produced() const { return messages_produced_.load(); }
+    uint64_t get_messages_processed() const { return messages_processed_.load(); }
+    uint64_t get_messages_delivered() const { return messages_delivered_.load(); }
+    uint64_t get_ordering_violations() const { return ordering_violations_.load(); }
+    uint64_t get_messages_produced(size_t producer) const { return produced_by_[producer].load(); }
+    void collect_latency(LatencyHistogram& out) const {
+        for (const auto& latency : latency_) {
+            out.merge_from(latency);
+        }
+    }
+
+private:
+    template<size_t Producer>
+    void producer_loop(uint64_t interval_ticks) {
+        std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<uint32_t> msg_type_dist(0, Topology.msg_types - 1);
+        SequenceNumber next_sequence = 1;
+        uint64_t next_message_time = TscClock::now();
+
+        while (producing_.load(std::memory_order_relaxed)) {
+            const uint64_t current_time = TscClock::now();
+            if (current_time < next_message_time) {
+                std::this_thread::yield();
+                continue;
+            }
+            const Message message(static_cast<MessageType>(msg_type_dist(gen)), Producer, next_sequence++, current_time);
+            push(producer_queues_[Producer], message);
+            produced_by_[Producer].fetch_add(1, std::memory_order_relaxed);
+            messages_produced_.fetch_add(1, std::memory_order_relaxed);
+            next_message_time = current_time + interval_ticks;
+        }
+    }
+
+    void stage1_loop() {
+        Message message;
+        while (running_.load(std::memory_order_relaxed)) {
+            bool found_message = false;
+            for_each_index<kProducers>([&]<size_t Producer>() {
+                while (producer_queues_[Producer].try_pop(message)) {
+                    dispatch_index<kProcessors>(Topology.stage1[message.msg_type], [&]<size_t Processor>() {
+                        push(stage1_queues_[Processor], message);
+                    });
+                    found_message = true;
+                }
+            });
+            if (!found_message) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    template<size_t Processor>
+    void processor_loop() {
+        Message message;
+        while (running_.load(std::memory_order_relaxed)) {
+            if (!stage1_queues_[Processor].try_pop(message)) {
+                std::this_thread::yield();
+                continue;
+            }
+            message.processor_id = Processor;
+            message.processing_timestamp = TscClock::now();
+            push(processor_queues_[Processor], message);
+            messages_processed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void stage2_loop() {
+        Message message;
+        while (running_.load(std::memory_order_relaxed)) {
+            bool found_message = false;
+            for_each_index<kProcessors>([&]<size_t Processor>() {
+                while (processor_queues_[Processor].try_pop(message)) {
+                    dispatch_index<kStrategies>(Topology.stage2[message.msg_type], [&]<size_t Strategy>() {
+                        push(stage2_queues_[Strategy], message);
+                    });
+                    found_message = true;
+                }
+            });
+            if (!found_message) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    template<size_t Strategy>
+    void strategy_loop() {
+        // Types reach a strategy through different processors, so order holds
+        // per (producer, msg_type): each of those streams must only move forward
+        std::array<std::array<SequenceNumber, Topology.msg_types>, kProducers> last_sequence{};
+        Message message;
+        while (running_.load(std::memory_order_relaxed)) {
+            if (!stage2_queues_[Strategy].try_pop(message)) {
+                std::this_thread::yield();
+                continue;
+            }
+            SequenceNumber& last = last_sequence[message.producer_id][message.msg_type];
+            if (message.sequence_number <= last) {
+                ordering_violations_.fetch_add(1, std::memory_order_relaxed);
+            }
+            last = message.sequence_number;
+
+            const uint64_t now = TscClock::now();
+            latency_[Strategy].record(now > message.timestamp ? now - message.timestamp : 0);
+            messages_delivered_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void join(std::vector<std::thread>& threads) {
+        for (auto& thread : threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        threads.clear();
+    }
+
+    // Never drops: a full queue backs up into the stage feeding it
+    void push(Queue& queue, const Message& message) {
+        while (!queue.try_push(message)) {
+            if (!running_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    std::array<Queue, kProducers> producer_queues_;
+    std::array<Queue, kProcessors> stage1_queues_;
+    std::array<Queue, kProcessors> processor_queues_;
+    std::array<Queue, kStrategies> stage2_queues_;
+    std::array<LatencyHistogram, kStrategies> latency_;
+
+    std::atomic<bool> running_;
+    std::atomic<bool> producing_;
+    std::vector<std::thread> producer_threads_;
+    std::vector<std::thread> stage_threads_;
+
+    std::array<std::atomic<uint64_t>, kProducers> produced_by_{};
+    std::atomic<uint64_t> messages_produced_;
+    std::atomic<uint64_t> messages_processed_;
+    std::atomic<uint64_t> messages_delivered_;
+    std::atomic<uint64_t> ordering_violations_;
+};
+
+} // namespace MessageRouter
@@ -3,6 +3,17 @@
 #include "message.h"
 #include "lockfree_queue.h"
 #include "config.h"
+#include "strategy_scheduler.h"
+#include "latency_histogram.h"
+#include "egress.h"
+#include "journal.h"
+#include "snapshot.h"
+#include "ttl_policy.h"
+#include "conflation_table.h"
+#include "payload_arena.h"
+#include "metrics_registry.h"
+#include "trace_ring.h"
+#include "hop_tracer.h"
 #include <atomic>
 #include <thread>
 #include <memory>
@@ -21,27 +32,70 @@ public:
     void stop();
     bool is_running() const { return running_.load(); }
     
-    uint64_t get_messages_delivered() const { return messages_delivered_.load(); }
-    uint64_t get_ordering_violations() const { return ordering_violations_.load(); }
+    uint64_t get_messages_delivered() const { return metrics_->get(Metric::MessagesDelivered); }
+    uint64_t get_ordering_violations() const { return metrics_->get(Metric::OrderingViolations); }
+    uint64_t get_messages_expired() const { return metrics_->get(Metric::MessagesExpired); }
+    uint64_t get_outputs_dropped() const { return metrics_->get(Metric::OutputsDropped); }
+    uint64_t get_journal_dropped() const { return metrics_->get(Metric::JournalDropped); }
+    uint64_t get_sync_withheld() const { return metrics_->get(Metric::SyncWithheld); }
+    uint64_t get_payload_mismatches() const { return metrics_->get(Metric::PayloadMismatches); }
+    // End-to-end latency from Message.timestamp, in TscClock ticks
+    const LatencyHistogram& get_latency() const { return latency_; }
     
 private:
     void strategy_loop();
+    size_t drain_input(size_t max_messages);
+    bool input_empty() const { return input_queue_->empty() && (!conflation_ || conflation_->empty()); }
     void process_message(const Message& message);
+    void deliver(const Message& message);
+    // Latency, hop trace, output and count: the message has left the strategy
+    void complete_delivery(const Message& message);
+    // Completes the sync messages held for the journal once their records
+    // are durable, or withholds them if a failed commit lost any record
+    // since the last release; false while some still wait. Never blocks: the caller
+    // delivers nothing else meanwhile and polls again later.
+    bool release_committed();
+    bool awaiting_commit() const { return !awaiting_commit_.empty(); }
+    // On stop: completes what the journal confirmed and withholds the rest
+    void settle_uncommitted();
+    // Moves the (producer, type) key past message; false if it arrived out of order
+    bool advance_sequence(const Message& message);
     void simulate_strategy_processing();
+    void emit_output(const Message& message);
+    // False when the record could not be queued and is lost
+    bool journal_message(const Message& message);
+    // Reads the body, then queues it to go back to its producer's arena
+    void consume_payload(const Message& message);
+    // Continue ordering checks from the last sequences a previous run delivered
+    void restore_sequences(const std::map<std::pair<ProducerId, MessageType>, SequenceNumber>& last_delivered);
     
     StrategyId strategy_id_;
     const SystemConfig* config_;
     std::shared_ptr<MessageQueue> input_queue_;
+    EgressQueue* output_queue_;
+    const Journal* journal_;
+    JournalQueue* journal_queue_;
+    uint64_t journal_pushed_;                   // records queued, compared with Journal::get_committed()
+    uint64_t journal_lost_;                     // Journal::get_lost() as of the last release
+    std::vector<Message> awaiting_commit_;      // sync messages whose output waits for the journal
+    SnapshotCoordinator* snapshot_;
+    PayloadArenas* payloads_;
+    std::unique_ptr<PayloadReleaser> payload_releaser_;  // set with payloads_
+    HopTracer* hop_tracer_;
     
     std::atomic<bool> running_;
     std::unique_ptr<std::thread> strategy_thread_;
     
-    std::atomic<uint64_t> messages_delivered_;
-    std::atomic<uint64_t> ordering_violations_;
+    ThreadMetrics metrics_;
+    ThreadTrace trace_;
+    LatencyHistogram latency_;
+    TtlPolicy ttl_;
+    std::unique_ptr<ConflationTable> conflation_;   // null unless a conflated rule targets us
     
     std::map<std::pair<ProducerId, MessageType>, SequenceNumber> expected_sequence_;
     
     friend class StrategyManager;
+    friend class StrategyScheduler;
 };
 
 class StrategyManager {
@@ -56,11 +110,36 @@ public:
     
     uint64_t get_total_messages_delivered() const;
     uint64_t get_total_ordering_violations() const;
+    uint64_t get_total_messages_expired() const;
+    uint64_t get_total_outputs_dropped() const;
+    uint64_t get_total_journal_dropped() const;
+    uint64_t get_total_sync_withheld() const;
+    void collect_latency(LatencyHistogram& out) const;
+    void collect_conflation_stats(ConflationStats& out) const;
+    // Latest-value tables indexed by strategy id, null where no rule conflates
+    std::vector<ConflationTable*> get_conflation_tables() const;
+    // Route strategy outputs to the egress stage; call before start_all()
+    void set_egress(EgressStage* egress);
+    // Journal delivered messages; call before start_all()
+    void set_journal(Journal* journal);
+    // Report sequence state when snapshot markers arrive; call before start_all()
+    void set_snapshot_coordinator(SnapshotCoordinator* snapshot);
+    // Read and release message bodies; call before start_all()
+    void set_payload_arenas(PayloadArenas* arenas);
+    void collect_payload_stats(PayloadStats& out) const;
+    // Finish the hop breakdown of sampled messages on delivery; call before start_all()
+    void set_hop_tracer(HopTracer* tracer);
+    // Last delivered sequence per (producer, type), indexed by strategy id
+    void restore_sequences(const std::vector<std::map<std::pair<ProducerId, MessageType>, SequenceNumber>>& last_delivered);
+    
+    // Non-null when strategies are multiplexed on scheduler workers
+    StrategyScheduler* get_scheduler() const { return scheduler_.get(); }
     
 private:
     const SystemConfig* config_;
     std::vector<std::shared_ptr<MessageQueue>> input_queues_;
     std::vector<std::unique_ptr<Strategy>> strategies_;
+    std::unique_ptr<StrategyScheduler> scheduler_;
 };
 
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "message.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <thread>
+#include <memory>
+#include <vector>
+
+namespace MessageRouter {
+
+class Strategy;
+
+// Coroutine driving one Strategy on a StrategyScheduler worker
+class StrategyTask {
+public:
+    struct promise_type {
+        StrategyTask get_return_object() {
+            return StrategyTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    StrategyTask() = default;
+    explicit StrategyTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    StrategyTask(StrategyTask&& other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    StrategyTask& operator=(StrategyTask&& other) noexcept;
+    StrategyTask(const StrategyTask&) = delete;
+    StrategyTask& operator=(const StrategyTask&) = delete;
+    ~StrategyTask();
+
+    std::coroutine_handle<promise_type> handle() const { return handle_; }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// Multiplexes many strategies onto a few worker threads. Each strategy is a
+// coroutine that parks when its inbox is empty; the stage2 router calls
+// notify() after a push, which puts a parked strategy on its worker's ready
+// bitmap. Busy strategies never park and are resumed every scheduling round.
+class StrategyScheduler {
+public:
+    StrategyScheduler(size_t worker_count, const std::vector<Strategy*>& strategies);
+    ~StrategyScheduler();
+
+    void start();
+    void stop();
+    void wait_for_completion();
+    bool is_running() const { return running_.load(); }
+
+    // Called by the inbox producer after a successful push
+    void notify(StrategyId strategy_id) {
+        if (strategy_id >= slots_.size()) {
+            return;
+        }
+        Slot& slot = *slots_[strategy_id];
+        // Pairs with the fence in park(): either the strategy sees the new
+        // message on its re-check, or we see it parked and wake it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (slot.parked.load(std::memory_order_relaxed) &&
+            slot.parked.exchange(false, std::memory_order_acq_rel)) {
+            mark_ready(slot);
+        }
+    }
+
+    size_t get_worker_count() const { return workers_.size(); }
+    uint64_t get_total_resumes() const;
+    uint64_t get_total_parks() const;
+
+    static constexpr size_t kBatchBudget = 256;
+
+private:
+    struct alignas(64) Slot {
+        Strategy* strategy;
+        size_t worker;
+        size_t local_index;
+        std::atomic<bool> parked{false};
+        StrategyTask task;
+    };
+
+    struct Worker {
+        std::unique_ptr<std::atomic<uint64_t>[]> ready;
+        size_t ready_words = 0;
+        std::vector<Slot*> slots;
+        std::unique_ptr<std::thread> thread;
+        alignas(64) std::atomic<uint64_t> resumes{0};
+        std::atomic<uint64_t> parks{0};
+    };
+
+    // Suspends the running strategy until it is marked ready again
+    struct SuspendAwaiter {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        void await_resume() const noexcept {}
+    };
+
+    StrategyTask run_strategy(Slot* slot);
+    bool park(Slot& slot);
+    void mark_ready(Slot& slot) {
+        Worker& worker = *workers_[slot.worker];
+        worker.ready[slot.local_index >> 6].fetch_or(
+            uint64_t(1) << (slot.local_index & 63), std::memory_order_release);
+    }
+    void worker_loop(size_t worker_index);
+
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::atomic<bool> running_;
+};
+
+} // namespace MessageRouter
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "tsc_clock.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MessageRouter {
+
+enum class TraceEvent : uint8_t {
+    BatchPopped = 1,        // arg: messages popped
+    QueueFull,              // arg: output whose push failed; a processor or strategy
+                            // has one, numbered by its own id
+    Retry,                  // arg: retries until the push went through or gave up
+    Idle,                   // every input was empty; the thread yields until the next batch
+    Park,                   // worker parked
+    Unpark,
+    ReorderHold,            // arg: messages held once this one is; only from an
+                            // OrderingBuffer given a ring, which no stage owns yet
+    OrderingViolation       // arg: producer
+};
+
+struct TraceRecord {
+    uint64_t tsc;
+    uint32_t arg;
+    TraceEvent event;
+};
+
+// Fixed ring of the newest events of one thread. The owner records with
+// two relaxed stores and a release of the head, about the cost of the TSC
+// read; a reader copies it at any time and keeps only the records the
+// owner cannot have overwritten during the copy.
+class TraceRing {
+public:
+    explicit TraceRing(size_t capacity);    // rounded up to a power of two
+
+    TraceRing(const TraceRing&) = delete;
+    TraceRing& operator=(const TraceRing&) = delete;
+
+    // Owning thread only
+    void record(TraceEvent event, uint32_t arg = 0) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[head & mask_];
+        slot.tsc.store(TscClock::now(), std::memory_order_relaxed);
+        slot.word.store((static_cast<uint64_t>(event) << 32) | arg, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // Any thread; appends the retained records, oldest first
+    void collect(std::vector<TraceRecord>& out) const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> tsc{0};
+        std::atomic<uint64_t> word{0};      // event << 32 | arg
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+};
+
+// Process-wide list of trace rings by thread name
+class TraceRegistry {
+public:
+    static TraceRegistry& instance();
+
+    TraceRing* register_thread(std::string thread, size_t capacity);
+    void unregister_thread(const TraceRing* ring);
+
+    // Writes every ring as Chrome/Perfetto trace JSON; returns the number of
+    // events written. Throws std::runtime_error if the file cannot be written.
+    size_t write_chrome_trace(const std::string& path) const;
+
+private:
+    TraceRegistry() = default;
+
+    struct Entry {
+        std::string thread;
+        std::unique_ptr<TraceRing> ring;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+
+// A component's ring; records nothing when tracing is off
+class ThreadTrace {
+public:
+    ThreadTrace(bool enabled, size_t capacity, std::string thread)
+        : ring_(enabled ? TraceRegistry::instance().register_thread(std::move(thread), capacity) : nullptr) {}
+    ~ThreadTrace() {
+        if (ring_) {
+            TraceRegistry::instance().unregister_thread(ring_);
+        }
+    }
+
+    ThreadTrace(const ThreadTrace&) = delete;
+    ThreadTrace& operator=(const ThreadTrace&) = delete;
+
+    void record(TraceEvent event, uint32_t arg = 0) {
+        if (ring_) {
+            ring_->record(event, arg);
+        }
+    }
+
+    TraceRing* ring() const { return ring_; }
+
+private:
+    TraceRing* ring_;
+};
+
+} // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace MessageRouter {
+
+// Cheap hop timestamps. now() returns raw invariant-TSC ticks (a handful of
+// cycles) and falls back to CLOCK_MONOTONIC nanoseconds when the TSC is not
+// invariant. Ticks are converted to nanoseconds off the hot path with
+// to_nanos(), using a calibration against CLOCK_MONOTONIC that
+// recalibrate() refreshes periodically.
+class TscClock {
+public:
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_expect(use_tsc_, 1)) {
+            return __rdtsc();
+        }
+#endif
+        return monotonic_nanos();
+    }
+
+    static uint64_t to_nanos(uint64_t ticks);
+    static uint64_t nanos_to_ticks(uint64_t nanos);
+    static uint64_t now_nanos() { return to_nanos(now()); }
+
+    // Re-measures the tick rate against CLOCK_MONOTONIC; call off the hot path
+    static void recalibrate();
+
+    static bool is_tsc() { return use_tsc_; }
+    static double ticks_per_nano();
+
+    static uint64_t monotonic_nanos();
+
+private:
+    static bool initialize();
+    static bool detect_invariant_tsc();
+
+    static const bool use_tsc_;
+
+    // Seqlock-protected conversion: ns = base_ns + (ticks - base_ticks) * ns_per_tick
+    static std::atomic<uint32_t> seq_;
+    static std::atomic<uint64_t> base_ticks_;
+    static std::atomic<uint64_t> base_nanos_;
+    static std::atomic<double> nanos_per_tick_;
+
+    static uint64_t epoch_ticks_;
+    static uint64_t epoch_nanos_;
+};
+
+} // namespace MessageRouter
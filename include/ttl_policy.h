@@ -0,0 +1,49 @@
+#pragma once
+
+#include "message.h"
+#include "config.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace MessageRouter {
+
+// Per-type time-to-live in TscClock ticks, measured from Message.timestamp.
+// Stages check whole drained batches at once so a backlog of stale
+// messages is discarded in bulk instead of being processed one by one.
+class TtlPolicy {
+public:
+    static constexpr size_t kBatchSize = 64;
+
+    explicit TtlPolicy(const TtlConfig& config);
+
+    bool enabled() const { return enabled_; }
+
+    // Sets expired[i] for every message older than its type's TTL at now
+    // and returns how many there were (count <= kBatchSize). Timestamps and
+    // limits are gathered out of the 64-byte messages first, so the age
+    // comparison runs over contiguous arrays and vectorizes; markers never
+    // expire.
+    size_t mark_expired(const Message* batch, size_t count, uint64_t now, uint8_t* expired) const {
+        uint64_t timestamps[kBatchSize];
+        uint64_t limits[kBatchSize];
+        for (size_t i = 0; i < count; ++i) {
+            timestamps[i] = batch[i].timestamp;
+            limits[i] = is_snapshot_marker(batch[i]) ? UINT64_MAX : ttl_ticks_[batch[i].msg_type];
+        }
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t age = now - std::min(timestamps[i], now);
+            expired[i] = age > limits[i];
+            total += expired[i];
+        }
+        return total;
+    }
+
+private:
+    bool enabled_;
+    std::array<uint64_t, 256> ttl_ticks_;    // UINT64_MAX = never expires
+};
+
+} // namespace MessageRouter
@@ -0,0 +1,126 @@
+#include "../include/batch_classifier.h"
+#include <algorithm>
+#include <cstddef>
+#include <immintrin.h>
+
+namespace MessageRouter {
+
+namespace {
+
+// The vector kernels gather the 32-bit word at the start of each message and keep its low byte
+static_assert(offsetof(Message, msg_type) == 0 && sizeof(MessageType) == 1);
+static_assert(sizeof(Message) == 64);
+
+void classify_scalar(const uint8_t* byte_table, const uint32_t*, const Message* batch, size_t count, uint8_t* dest) {
+    for (size_t i = 0; i < count; ++i) {
+        dest[i] = byte_table[batch[i].msg_type];
+    }
+}
+
+__attribute__((target("avx2")))
+void classify_avx2(const uint8_t* byte_table, const uint32_t* word_table,
+                   const Message* batch, size_t count, uint8_t* dest) {
+    const __m256i offsets = _mm256_setr_epi32(0, 64, 128, 192, 256, 320, 384, 448);
+    const __m256i low_byte = _mm256_set1_epi32(0xFF);
+    // Byte 0 of every dword into the low dword of each 128-bit lane
+    const __m256i pack = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    // ...then both of those dwords side by side in the low 64 bits
+    const __m256i join = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(batch + i), offsets, 1);
+        const __m256i types = _mm256_and_si256(words, low_byte);
+        const __m256i outputs = _mm256_i32gather_epi32(reinterpret_cast<const int*>(word_table), types, 4);
+        const __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(outputs, pack), join);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), _mm256_castsi256_si128(packed));
+    }
+    classify_scalar(byte_table, word_table, batch + i, count - i, dest + i);
+}
+
+// The table lookup stays in registers: the 256 output bytes sit in four
+// vectors, two vpermt2b lookups cover types 0-127 and 128-255, and the top
+// bit of each type picks between them. Only the strided msg_type load is a gather.
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+void classify_avx512(const uint8_t* byte_table, const uint32_t* word_table,
+                     const Message* batch, size_t count, uint8_t* dest) {
+    const __m512i offsets = _mm512_setr_epi32(0, 64, 128, 192, 256, 320, 384, 448,
+                                              512, 576, 640, 704, 768, 832, 896, 960);
+    const __m512i table0 = _mm512_loadu_si512(byte_table);
+    const __m512i table1 = _mm512_loadu_si512(byte_table + 64);
+    const __m512i table2 = _mm512_loadu_si512(byte_table + 128);
+    const __m512i table3 = _mm512_loadu_si512(byte_table + 192);
+    // Masked forms with a zero source: same instructions, no undefined pass-through operand
+    const __m512i zero = _mm512_setzero_si512();
+    const __mmask16 all = 0xFFFF;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m512i words = _mm512_mask_i32gather_epi32(zero, all, offsets, batch + i, 1);
+        const __m512i types = _mm512_zextsi128_si512(_mm512_maskz_cvtepi32_epi8(all, words));
+        const __m512i low = _mm512_permutex2var_epi8(table0, types, table1);
+        const __m512i high = _mm512_permutex2var_epi8(table2, types, table3);
+        const __m512i outputs = _mm512_mask_blend_epi8(_mm512_movepi8_mask(types), low, high);
+        _mm512_mask_storeu_epi8(dest + i, 0xFFFF, outputs);
+    }
+    classify_scalar(byte_table, word_table, batch + i, count - i, dest + i);
+}
+
+} // namespace
+
+BatchClassifier::BatchClassifier(const std::array<uint32_t, 256>& destinations, size_t num_outputs,
+                                 ClassifierIsa isa)
+    : num_outputs_(num_outputs)
+    , num_groups_(0)
+    , kernel_(classify_scalar)
+    , kernel_name_("scalar") {
+    for (size_t msg_type = 0; msg_type < destinations.size(); ++msg_type) {
+        output_table_[msg_type] = static_cast<uint32_t>(std::min<size_t>(destinations[msg_type], num_outputs));
+        if (output_table_[msg_type] < num_outputs) {
+            group_outputs_[num_groups_++] = output_table_[msg_type];
+        }
+    }
+    std::sort(group_outputs_.begin(), group_outputs_.begin() + num_groups_);
+    num_groups_ = std::unique(group_outputs_.begin(), group_outputs_.begin() + num_groups_) - group_outputs_.begin();
+
+    // Only 256 groups leave no type unroutable, so a group always fits a byte
+    for (size_t msg_type = 0; msg_type < destinations.size(); ++msg_type) {
+        const size_t group = std::lower_bound(group_outputs_.begin(), group_outputs_.begin() + num_groups_,
+                                              output_table_[msg_type]) - group_outputs_.begin();
+        byte_table_[msg_type] = static_cast<uint8_t>(group);
+        word_table_[msg_type] = static_cast<uint32_t>(group);
+    }
+
+    __builtin_cpu_init();
+    const bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                        __builtin_cpu_supports("avx512vbmi");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    if ((isa == ClassifierIsa::Auto || isa == ClassifierIsa::Avx512) && avx512) {
+        kernel_ = classify_avx512;
+        kernel_name_ = "avx512";
+    } else if (isa != ClassifierIsa::Scalar && avx2) {
+        kernel_ = classify_avx2;
+        kernel_name_ = "avx2";
+    }
+}
+
+void BatchClassifier::partition(const Message* batch, size_t count, Message* staging, uint16_t* begin) const {
+    uint8_t dest[kBatchSize];
+    classify(batch, count, dest);
+
+    // Histogram shifted by one, then a prefix sum turns it into range starts
+    std::fill(begin, begin + num_groups_ + 2, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++begin[dest[i] + 1];
+    }
+    for (size_t group = 1; group <= num_groups_ + 1; ++group) {
+        begin[group] += begin[group - 1];
+    }
+
+    uint16_t cursor[kMaxGroups + 1];
+    std::copy(begin, begin + num_groups_ + 1, cursor);
+    for (size_t i = 0; i < count; ++i) {
+        staging[cursor[dest[i]]++] = batch[i];
+    }
+}
+
+} // namespace MessageRouter
@@ -34,6 +34,9 @@ std::unique_ptr<SystemConfig> SystemConfig::load_from_file(const std::string& fi
     const auto& producers = root["producers"];
     config->producers.count = producers["count"].asInt();
     config->producers.messages_per_sec = producers["messages_per_sec"].asInt();
+    config->producers.open_loop = producers.get("load_mode", "closed_loop").asString() == "open_loop";
+    config->producers.schedule_lag_tolerance_ns = producers.get(
+        "schedule_lag_tolerance_ns", Json::UInt64(config->producers.schedule_lag_tolerance_ns)).asUInt64();
     
     const auto& distribution = producers["distribution"];
     for (const auto& key : distribution.getMemberNames()) {
@@ -49,9 +52,25 @@ std::unique_ptr<SystemConfig> SystemConfig::load_from_file(const std::string& fi
         config->processors.processing_times_ns[key] = proc_times[key].asUInt64();
     }
     
+    const auto& autoscale = processors["autoscale"];
+    if (autoscale.isObject()) {
+        auto& as = config->processors.autoscale;
+        as.enabled = autoscale.get("enabled", as.enabled).asBool();
+        as.min_active = autoscale.get("min_active", as.min_active).asInt();
+        as.sample_interval_us = autoscale.get("sample_interval_us", Json::UInt64(as.sample_interval_us)).asUInt64();
+        as.scale_up_depth = autoscale.get("scale_up_depth", Json::UInt64(as.scale_up_depth)).asUInt64();
+        as.scale_down_depth = autoscale.get("scale_down_depth", Json::UInt64(as.scale_down_depth)).asUInt64();
+        as.scale_up_utilization = autoscale.get("scale_up_utilization", as.scale_up_utilization).asDouble();
+        as.scale_down_utilization = autoscale.get("scale_down_utilization", as.scale_down_utilization).asDouble();
+        as.scale_down_hold_ms = autoscale.get("scale_down_hold_ms", Json::UInt64(as.scale_down_hold_ms)).asUInt64();
+    }
+    
     
     const auto& strategies = root["strategies"];
     config->strategies.count = strategies["count"].asInt();
+    config->strategies.scheduler_threads = strategies.get("scheduler_threads", 0).asInt();
+    config->strategies.conflation_keys = strategies.get(
+        "conflation_keys", Json::UInt64(config->strategies.conflation_keys)).asUInt64();
     
     const auto& strat_times = strategies["processing_times_ns"];
     for (const auto& key : strat_times.getMemberNames()) {
@@ -76,12 +95,186 @@ std::unique_ptr<SystemConfig> SystemConfig::load_from_file(const std::string& fi
         r.msg_type = rule["msg_type"].asUInt();
         r.strategy = rule["strategy"].asUInt();
         r.ordering_required = rule["ordering_required"].asBool();
+        r.conflate = rule.get("conflate", false).asBool();
         config->stage2_rules.push_back(r);
     }
     
+    
+    const auto& capture = root["capture"];
+    if (capture.isObject()) {
+        config->capture.enabled = capture.get("enabled", true).asBool();
+        config->capture.file = capture["file"].asString();
+        config->capture.stage = capture.get("stage", config->capture.stage).asString();
+    }
+    
+    const auto& replay = root["replay"];
+    if (replay.isObject()) {
+        config->replay.enabled = replay.get("enabled", true).asBool();
+        config->replay.file = replay["file"].asString();
+        config->replay.speed = replay.get("speed", config->replay.speed).asDouble();
+    }
+    
+    const auto& ingress = root["ingress"];
+    if (ingress.isObject()) {
+        auto& in = config->ingress;
+        in.enabled = ingress.get("enabled", true).asBool();
+        in.bind_address = ingress.get("bind_address", in.bind_address).asString();
+        in.tcp_port = ingress.get("tcp_port", in.tcp_port).asInt();
+        in.udp_port = ingress.get("udp_port", in.udp_port).asInt();
+        in.unix_path = ingress.get("unix_path", in.unix_path).asString();
+        in.ring_entries = ingress.get("ring_entries", in.ring_entries).asUInt();
+        in.buffer_count = ingress.get("buffer_count", in.buffer_count).asUInt();
+        in.buffer_size = ingress.get("buffer_size", in.buffer_size).asUInt();
+        in.first_producer_id = ingress.get("first_producer_id", in.first_producer_id).asUInt();
+        in.loopback_connections = ingress.get("loopback_connections", in.loopback_connections).asInt();
+        in.loopback_messages_per_sec = ingress.get("loopback_messages_per_sec", in.loopback_messages_per_sec).asInt();
+    }
+    
+    const auto& egress = root["egress"];
+    if (egress.isObject()) {
+        auto& eg = config->egress;
+        eg.enabled = egress.get("enabled", true).asBool();
+        eg.batch_records = egress.get("batch_records", Json::UInt64(eg.batch_records)).asUInt64();
+        eg.flush_interval_us = egress.get("flush_interval_us", Json::UInt64(eg.flush_interval_us)).asUInt64();
+        for (const auto& dest : egress["destinations"]) {
+            EgressDestination destination;
+            destination.type = dest.get("type", destination.type).asString();
+            destination.path = dest["path"].asString();
+            for (const auto& strategy : dest["strategies"]) {
+                destination.strategies.push_back(strategy.asUInt());
+            }
+            eg.destinations.push_back(destination);
+        }
+    }
+    
+    const auto& journal = root["journal"];
+    if (journal.isObject()) {
+        auto& jr = config->journal;
+        jr.enabled = journal.get("enabled", true).asBool();
+        jr.directory = journal.get("directory", jr.directory).asString();
+        jr.segment_bytes = journal.get("segment_bytes", Json::UInt64(jr.segment_bytes)).asUInt64();
+        jr.group_commit_records = journal.get("group_commit_records", Json::UInt64(jr.group_commit_records)).asUInt64();
+        jr.group_commit_us = journal.get("group_commit_us", Json::UInt64(jr.group_commit_us)).asUInt64();
+        jr.default_durability = journal.get("default_durability", jr.default_durability).asString();
+        jr.recover = journal.get("recover", jr.recover).asBool();
+        jr.retain_segments = journal.get("retain_segments", Json::UInt64(jr.retain_segments)).asUInt64();
+        const auto& durability = journal["durability"];
+        for (const auto& key : durability.getMemberNames()) {
+            jr.durability[key] = durability[key].asString();
+        }
+    }
+    
+    const auto& overflow = root["overflow"];
+    if (overflow.isObject()) {
+        auto& of = config->overflow;
+        of.enabled = overflow.get("enabled", true).asBool();
+        of.directory = overflow.get("directory", of.directory).asString();
+        of.max_bytes_per_edge = overflow.get("max_bytes_per_edge", Json::UInt64(of.max_bytes_per_edge)).asUInt64();
+    }
+    
+    const auto& snapshot = root["snapshot"];
+    if (snapshot.isObject()) {
+        auto& sn = config->snapshot;
+        sn.enabled = snapshot.get("enabled", true).asBool();
+        sn.file = snapshot.get("file", sn.file).asString();
+        sn.interval_ms = snapshot.get("interval_ms", Json::UInt64(sn.interval_ms)).asUInt64();
+        sn.restore = snapshot.get("restore", sn.restore).asBool();
+    }
+    
+    const auto& dedup = root["dedup"];
+    if (dedup.isObject()) {
+        config->dedup.enabled = dedup.get("enabled", true).asBool();
+        config->dedup.max_keys = dedup.get("max_keys", Json::UInt64(config->dedup.max_keys)).asUInt64();
+    }
+    
+    const auto& ttl = root["ttl"];
+    if (ttl.isObject()) {
+        config->ttl.enabled = ttl.get("enabled", true).asBool();
+        config->ttl.default_ttl_us = ttl.get("default_ttl_us", Json::UInt64(config->ttl.default_ttl_us)).asUInt64();
+        const auto& ttl_us = ttl["ttl_us"];
+        for (const auto& key : ttl_us.getMemberNames()) {
+            config->ttl.ttl_us[key] = ttl_us[key].asUInt64();
+        }
+    }
+    
+    const auto& payloads = root["payloads"];
+    if (payloads.isObject()) {
+        auto& pl = config->payloads;
+        pl.enabled = payloads.get("enabled", true).asBool();
+        pl.min_bytes = payloads.get("min_bytes", Json::UInt64(pl.min_bytes)).asUInt64();
+        pl.max_bytes = payloads.get("max_bytes", Json::UInt64(pl.max_bytes)).asUInt64();
+        pl.slots_per_class = payloads.get("slots_per_class", Json::UInt64(pl.slots_per_class)).asUInt64();
+    }
+    
+    const auto& monitor = root["monitor"];
+    if (monitor.isObject()) {
+        config->monitor.enabled = monitor.get("enabled", true).asBool();
+        config->monitor.interval_ms = monitor.get("interval_ms", Json::UInt64(config->monitor.interval_ms)).asUInt64();
+    }
+    
+    const auto& metrics_http = root["metrics_http"];
+    if (metrics_http.isObject()) {
+        config->metrics_http.enabled = metrics_http.get("enabled", true).asBool();
+        config->metrics_http.bind_address = metrics_http.get("bind_address", config->metrics_http.bind_address).asString();
+        config->metrics_http.port = metrics_http.get("port", config->metrics_http.port).asInt();
+    }
+    
+    const auto& trace = root["trace"];
+    if (trace.isObject()) {
+        config->trace.enabled = trace.get("enabled", true).asBool();
+        config->trace.records_per_thread = trace.get("records_per_thread", Json::UInt64(config->trace.records_per_thread)).asUInt64();
+        config->trace.file = trace.get("file", config->trace.file).asString();
+        config->trace.dump_on_exit = trace.get("dump_on_exit", config->trace.dump_on_exit).asBool();
+    }
+    
+    const auto& hop_trace = root["hop_trace"];
+    if (hop_trace.isObject()) {
+        auto& ht = config->hop_trace;
+        ht.enabled = hop_trace.get("enabled", true).asBool();
+        ht.sample_every = hop_trace.get("sample_every", Json::UInt64(ht.sample_every)).asUInt64();
+        ht.table_slots = hop_trace.get("table_slots", Json::UInt64(ht.table_slots)).asUInt64();
+        ht.outlier_us = hop_trace.get("outlier_us", Json::UInt64(ht.outlier_us)).asUInt64();
+        ht.max_outliers = hop_trace.get("max_outliers", Json::UInt64(ht.max_outliers)).asUInt64();
+    }
+    
+    const auto& perf = root["perf"];
+    if (perf.isObject()) {
+        config->perf.enabled = perf.get("enabled", true).asBool();
+    }
+    
+    const auto& hiccups = root["hiccups"];
+    if (hiccups.isObject()) {
+        config->hiccups.enabled = hiccups.get("enabled", true).asBool();
+        config->hiccups.threshold_ns = hiccups.get("threshold_ns", Json::UInt64(config->hiccups.threshold_ns)).asUInt64();
+        config->hiccups.cpu = hiccups.get("cpu", config->hiccups.cpu).asInt();
+    }
+    
     return config;
 }
 
+namespace {
+
+// "msg_type_<n>" with n written in decimal digits only and in 0-255
+bool valid_msg_type_key(const std::string& key) {
+    constexpr size_t kPrefix = sizeof("msg_type_") - 1;
+    if (key.rfind("msg_type_", 0) != 0 || key.size() == kPrefix) {
+        return false;
+    }
+    int msg_type = 0;
+    for (size_t i = kPrefix; i < key.size(); ++i) {
+        if (key[i] < '0' || key[i] > '9') {
+            return false;
+        }
+        msg_type = msg_type * 10 + (key[i] - '0');
+        if (msg_type > 255) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 bool SystemConfig::validate() const {
     if (producers.count <= 0 || processors.count <= 0 || strategies.count <= 0) {
         return false;
@@ -91,6 +284,123 @@ bool SystemConfig::validate() const {
         return false;
     }
     
+    if (capture.enabled &&
+        (capture.file.empty() || (capture.stage != "producers" && capture.stage != "stage1" &&
+                                  capture.stage != "processors" && capture.stage != "stage2"))) {
+        return false;
+    }
+    
+    if (replay.enabled && (replay.file.empty() || replay.speed < 0.0)) {
+        return false;
+    }
+    
+    if (ingress.enabled &&
+        ((ingress.tcp_port < 0 && ingress.udp_port < 0 && ingress.unix_path.empty()) ||
+         (ingress.loopback_connections > 0 && ingress.tcp_port < 0) || replay.enabled)) {
+        return false;
+    }
+    
+    if (egress.enabled) {
+        if (egress.destinations.empty() || egress.batch_records == 0) {
+            return false;
+        }
+        for (const auto& destination : egress.destinations) {
+            if (destination.path.empty() ||
+                (destination.type != "file" && destination.type != "fifo" && destination.type != "unix")) {
+                return false;
+            }
+        }
+    }
+    
+    if (journal.enabled) {
+        auto valid_mode = [](const std::string& mode) {
+            return mode == "none" || mode == "async" || mode == "sync";
+        };
+        // A segment must hold its 64-byte header plus at least one 32-byte record
+        if (journal.directory.empty() || journal.segment_bytes < 96 || journal.group_commit_records == 0 ||
+            !valid_mode(journal.default_durability)) {
+            return false;
+        }
+        for (const auto& [key, mode] : journal.durability) {
+            if (!valid_msg_type_key(key) || !valid_mode(mode)) {
+                return false;
+            }
+        }
+    }
+    
+    if (overflow.enabled && (overflow.directory.empty() || overflow.max_bytes_per_edge < sizeof(Message))) {
+        return false;
+    }
+    
+    // Markers originate at the synthetic producers, so replay and ingress cannot snapshot
+    if (snapshot.enabled &&
+        (snapshot.file.empty() || snapshot.interval_ms == 0 || replay.enabled || ingress.enabled)) {
+        return false;
+    }
+    
+    if (ttl.enabled) {
+        for (const auto& [key, ttl_us] : ttl.ttl_us) {
+            if (!valid_msg_type_key(key)) {
+                return false;
+            }
+        }
+    }
+    
+    if (dedup.enabled && dedup.max_keys == 0) {
+        return false;
+    }
+    
+    if (strategies.conflation_keys == 0 || strategies.conflation_keys > 65535) {
+        return false;
+    }
+    
+    // Bodies come from the synthetic producers and live only in this process's arenas:
+    // a snapshot could not restore them, and a conflated slot overwritten
+    // while its strategy reads it would free the body under the reader
+    if (payloads.enabled) {
+        if (payloads.min_bytes > payloads.max_bytes || payloads.max_bytes > 4096 ||
+            payloads.slots_per_class == 0 || payloads.slots_per_class >= UINT32_MAX ||
+            producers.count > 65536 || replay.enabled || ingress.enabled || snapshot.enabled) {
+            return false;
+        }
+        for (const auto& rule : stage2_rules) {
+            if (rule.conflate) {
+                return false;
+            }
+        }
+    }
+    
+    if (monitor.enabled && monitor.interval_ms == 0) {
+        return false;
+    }
+    
+    if (metrics_http.enabled && (metrics_http.port < 0 || metrics_http.port > 65535)) {
+        return false;
+    }
+    
+    if (trace.enabled && (trace.records_per_thread == 0 || trace.file.empty())) {
+        return false;
+    }
+    
+    if (hiccups.enabled && (hiccups.threshold_ns == 0 || hiccups.cpu < -1)) {
+        return false;
+    }
+    
+    if (hop_trace.enabled && (hop_trace.sample_every == 0 || (hop_trace.sample_every & (hop_trace.sample_every - 1)) != 0 ||
+                              hop_trace.table_slots == 0)) {
+        return false;
+    }
+    
+    if (strategies.scheduler_threads < 0) {
+        return false;
+    }
+    
+    if (processors.autoscale.enabled &&
+        (processors.autoscale.min_active <= 0 || processors.autoscale.sample_interval_us == 0 ||
+         processors.autoscale.scale_down_utilization > processors.autoscale.scale_up_utilization)) {
+        return false;
+    }
+    
     return true;
 }
 
@@ -121,4 +431,13 @@ bool SystemConfig::is_ordering_required(MessageType msg_type) const {
     return false;
 }
 
+bool SystemConfig::is_conflated(MessageType msg_type) const {
+    for (const auto& rule : stage2_rules) {
+        if (rule.msg_type == msg_type) {
+            return rule.conflate;
+        }
+    }
+    return false;
+}
+
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "../include/conflation_table.h"
+#include <algorithm>
+#include <thread>
+
+namespace MessageRouter {
+
+ConflationTable::ConflationTable(size_t max_keys)
+    : slots_(std::make_unique<Slot[]>(std::min(max_keys, kMaxKeys)))
+    , max_keys_(std::min(max_keys, kMaxKeys))
+    , updates_(0)
+    , delivered_(0)
+    , overflows_(0)
+    , keys_(0) {
+    index_.reserve(max_keys_);
+}
+
+bool ConflationTable::publish(const Message& message) {
+    const uint64_t key = (static_cast<uint64_t>(message.producer_id) << 8) | message.msg_type;
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        if (index_.size() == max_keys_) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        it = index_.emplace(key, static_cast<uint32_t>(index_.size())).first;
+        keys_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Slot& slot = slots_[it->second];
+    const uint64_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.message = message;
+    slot.version.store(version + 2, std::memory_order_release);
+    updates_.fetch_add(1, std::memory_order_relaxed);
+
+    // Only the clean -> dirty transition queues the key
+    if (!slot.dirty.exchange(true, std::memory_order_seq_cst)) {
+        dirty_.try_push(it->second);
+    }
+    return true;
+}
+
+void ConflationTable::collect_stats(ConflationStats& out) const {
+    out.updates += updates_.load(std::memory_order_relaxed);
+    out.delivered += delivered_.load(std::memory_order_relaxed);
+    out.overflows += overflows_.load(std::memory_order_relaxed);
+    out.keys += keys_.load(std::memory_order_relaxed);
+}
+
+uint64_t ConflationTable::read(const Slot& slot, Message& message) {
+    while (true) {
+        const uint64_t before = slot.version.load(std::memory_order_acquire);
+        if (before & 1) {
+            // Writer mid-update
+            std::this_thread::yield();
+            continue;
+        }
+        message = slot.message;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) == before) {
+            return before;
+        }
+    }
+}
+
+} // namespace MessageRouter
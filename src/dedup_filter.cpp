@@ -0,0 +1,105 @@
+#include "../include/dedup_filter.h"
+#include <bit>
+#include <algorithm>
+
+namespace MessageRouter {
+
+DedupFilter::DedupFilter(size_t max_keys)
+    : entries_(nullptr)
+    , set_mask_(std::bit_ceil(std::max(max_keys, kWays) / kWays) - 1)
+    , clock_(0)
+    , duplicates_(0)
+    , too_old_(0)
+    , evictions_(0)
+    , tracked_keys_(0) {
+    entries_ = std::make_unique<Entry[]>((set_mask_ + 1) * kWays);
+}
+
+bool DedupFilter::accept(const Message& message) {
+    const uint64_t key = ((static_cast<uint64_t>(message.producer_id) << 8) | message.msg_type) + 1;
+    const SequenceNumber sequence = message.sequence_number;
+    Entry& entry = find_or_evict(key);
+
+    if (entry.key != key) {
+        // New key, or one whose window was evicted
+        entry.key = key;
+        entry.highest = sequence;
+        std::fill(std::begin(entry.window), std::end(entry.window), 0);
+        entry.window[0] = 1;
+        return true;
+    }
+
+    if (sequence > entry.highest) {
+        shift_window(entry.window, sequence - entry.highest);
+        entry.highest = sequence;
+        entry.window[0] |= 1;
+        return true;
+    }
+
+    const uint64_t offset = entry.highest - sequence;
+    if (offset >= kWindowBits) {
+        too_old_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const uint64_t bit = uint64_t(1) << (offset % 64);
+    uint64_t& word = entry.window[offset / 64];
+    if (word & bit) {
+        duplicates_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    word |= bit;
+    return true;
+}
+
+DedupFilter::Entry& DedupFilter::find_or_evict(uint64_t key) {
+    // Fibonacci hashing spreads consecutive producer ids across sets
+    const size_t set = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & set_mask_;
+    Entry* ways = &entries_[set * kWays];
+    ++clock_;
+
+    Entry* victim = &ways[0];
+    for (size_t way = 0; way < kWays; ++way) {
+        if (ways[way].key == key) {
+            ways[way].last_used = clock_;
+            return ways[way];
+        }
+        if (ways[way].key == 0) {
+            tracked_keys_.fetch_add(1, std::memory_order_relaxed);
+            victim = &ways[way];
+            break;
+        }
+        if (ways[way].last_used < victim->last_used) {
+            victim = &ways[way];
+        }
+    }
+
+    if (victim->key != 0) {
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // The caller sees a key mismatch and starts a fresh window
+    victim->key = 0;
+    victim->last_used = clock_;
+    return *victim;
+}
+
+void DedupFilter::shift_window(uint64_t* window, uint64_t shift) {
+    // Moving highest up by shift moves every seen bit to a higher offset
+    if (shift >= kWindowBits) {
+        std::fill(window, window + kWindowWords, 0);
+        return;
+    }
+    const size_t word_shift = shift / 64;
+    const unsigned bit_shift = shift % 64;
+    for (size_t i = kWindowWords; i-- > 0;) {
+        uint64_t value = 0;
+        if (i >= word_shift) {
+            value = window[i - word_shift] << bit_shift;
+            if (bit_shift != 0 && i > word_shift) {
+                value |= window[i - word_shift - 1] >> (64 - bit_shift);
+            }
+        }
+        window[i] = value;
+    }
+}
+
+} // namespace MessageRouter
@@ -0,0 +1,228 @@
+#include "../include/egress.h"
+#include "../include/tsc_clock.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+namespace {
+
+constexpr size_t kBatchBudget = 256;
+
+} // namespace
+
+EgressStage::EgressStage(const SystemConfig* config)
+    : config_(config)
+    , flush_interval_ticks_(TscClock::nanos_to_ticks(config->egress.flush_interval_us * 1000))
+    , running_(false)
+    , records_written_(0)
+    , bytes_written_(0)
+    , batches_written_(0)
+    , size_flushes_(0)
+    , deadline_flushes_(0)
+    , write_errors_(0) {
+    for (int i = 0; i < config->strategies.count; ++i) {
+        input_queues_.push_back(std::make_unique<EgressQueue>());
+    }
+
+    // Strategies not listed by any destination go to the first one
+    destination_for_strategy_.assign(config->strategies.count, 0);
+    destinations_.resize(config->egress.destinations.size());
+    for (size_t d = 0; d < destinations_.size(); ++d) {
+        const auto& destination = config->egress.destinations[d];
+        for (StrategyId strategy : destination.strategies) {
+            if (strategy < destination_for_strategy_.size()) {
+                destination_for_strategy_[strategy] = d;
+            }
+        }
+        destinations_[d].pending.reserve(config->egress.batch_records);
+        try {
+            destinations_[d].fd = open_destination(destination);
+        } catch (...) {
+            for (size_t opened = 0; opened < d; ++opened) {
+                ::close(destinations_[opened].fd);
+            }
+            throw;
+        }
+    }
+}
+
+EgressStage::~EgressStage() {
+    stop();
+    for (auto& destination : destinations_) {
+        if (destination.fd >= 0) {
+            ::close(destination.fd);
+        }
+    }
+}
+
+int EgressStage::open_destination(const EgressDestination& destination) {
+    int fd = -1;
+    if (destination.type == "unix") {
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (fd >= 0 && destination.path.size() < sizeof(addr.sun_path)) {
+            std::memcpy(addr.sun_path, destination.path.c_str(), destination.path.size());
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        } else if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+            errno = ENAMETOOLONG;
+        }
+    } else if (destination.type == "fifo") {
+        if (::mkfifo(destination.path.c_str(), 0644) != 0 && errno != EEXIST) {
+            fd = -1;
+        } else {
+            // Fails with ENXIO instead of blocking when nobody is reading yet
+            fd = ::open(destination.path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fd >= 0) {
+                ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+            }
+        }
+    } else {
+        fd = ::open(destination.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open egress " + destination.type + " " + destination.path +
+                                 ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+void EgressStage::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    egress_thread_ = std::make_unique<std::thread>(&EgressStage::egress_loop, this);
+}
+
+void EgressStage::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    wait_for_completion();
+}
+
+void EgressStage::wait_for_completion() {
+    if (egress_thread_ && egress_thread_->joinable()) {
+        egress_thread_->join();
+    }
+}
+
+void EgressStage::egress_loop() {
+    const size_t batch_records = config_->egress.batch_records;
+    EgressRecord record;
+
+    auto drain = [&]() {
+        size_t drained = 0;
+        for (size_t s = 0; s < input_queues_.size(); ++s) {
+            Destination& destination = destinations_[destination_for_strategy_[s]];
+            for (size_t n = 0; n < kBatchBudget && input_queues_[s]->try_pop(record); ++n) {
+                if (destination.pending.empty()) {
+                    destination.oldest_pending = record.output_timestamp;
+                }
+                destination.pending.push_back(record);
+                if (destination.pending.size() >= batch_records) {
+                    flush(destination);
+                    size_flushes_.fetch_add(1, std::memory_order_relaxed);
+                }
+                ++drained;
+            }
+        }
+        return drained;
+    };
+
+    while (running_.load(std::memory_order_relaxed)) {
+        size_t drained = drain();
+
+        uint64_t now = TscClock::now();
+        for (auto& destination : destinations_) {
+            if (!destination.pending.empty() && now - destination.oldest_pending >= flush_interval_ticks_) {
+                flush(destination);
+                deadline_flushes_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (drained == 0) {
+            // Nothing to ship - busy-waiting for minimal latency
+            std::this_thread::yield();
+        }
+    }
+
+    // Strategies are stopped before egress: ship whatever they left behind
+    while (drain() > 0) {
+    }
+    for (auto& destination : destinations_) {
+        if (!destination.pending.empty()) {
+            flush(destination);
+        }
+    }
+}
+
+void EgressStage::flush(Destination& destination) {
+    EgressBatchHeader header;
+    header.magic = EgressBatchHeader::kMagic;
+    header.record_count = static_cast<uint32_t>(destination.pending.size());
+    header.flush_timestamp = TscClock::now();
+
+    iovec iov[2];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = destination.pending.data();
+    iov[1].iov_len = destination.pending.size() * sizeof(EgressRecord);
+    const size_t total = iov[0].iov_len + iov[1].iov_len;
+
+    iovec* next = iov;
+    int count = 2;
+    size_t remaining = total;
+    while (remaining > 0) {
+        ssize_t written = ::writev(destination.fd, next, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Reader went away or disk error: the batch is lost
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+            destination.pending.clear();
+            return;
+        }
+        remaining -= static_cast<size_t>(written);
+        // Partial write: skip the iovecs that went out completely
+        while (count > 0 && static_cast<size_t>(written) >= next->iov_len) {
+            written -= static_cast<ssize_t>(next->iov_len);
+            ++next;
+            --count;
+        }
+        if (count > 0) {
+            next->iov_base = static_cast<uint8_t*>(next->iov_base) + written;
+            next->iov_len -= static_cast<size_t>(written);
+        }
+    }
+
+    uint64_t done = TscClock::now();
+    for (const auto& record : destination.pending) {
+        latency_.record(done > record.output_timestamp ? done - record.output_timestamp : 0);
+    }
+
+    records_written_.fetch_add(destination.pending.size(), std::memory_order_relaxed);
+    bytes_written_.fetch_add(total, std::memory_order_relaxed);
+    batches_written_.fetch_add(1, std::memory_order_relaxed);
+    destination.pending.clear();
+}
+
+} // namespace MessageRouter
@@ -0,0 +1,68 @@
+#include "../include/hiccup_meter.h"
+#include "../include/tsc_clock.h"
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+
+namespace MessageRouter {
+
+HiccupMeter::HiccupMeter(const HiccupConfig& config)
+    : config_(config)
+    , running_(false)
+    , stalled_ticks_(0)
+    , measured_ticks_(0) {
+}
+
+HiccupMeter::~HiccupMeter() {
+    stop();
+}
+
+void HiccupMeter::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    meter_thread_ = std::make_unique<std::thread>(&HiccupMeter::meter_loop, this);
+}
+
+void HiccupMeter::stop() {
+    running_.store(false);
+    if (meter_thread_ && meter_thread_->joinable()) {
+        meter_thread_->join();
+    }
+}
+
+void HiccupMeter::meter_loop() {
+    if (config_.cpu >= 0) {
+        // Share a core with the pipeline threads it stands in for
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config_.cpu, &cpus);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0) {
+            std::cerr << "Hiccup meter: cannot pin to CPU " << config_.cpu << ": " << std::strerror(err)
+                      << ", running unpinned" << std::endl;
+        }
+    }
+
+    const uint64_t threshold = TscClock::nanos_to_ticks(config_.threshold_ns);
+    const uint64_t start = TscClock::now();
+    uint64_t last = start;
+    uint64_t stalled = 0;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        const uint64_t now = TscClock::now();
+        const uint64_t gap = now - last;
+        last = now;
+        if (gap >= threshold) {
+            stalls_.record(gap);
+            stalled += gap;
+            stalled_ticks_.store(stalled, std::memory_order_relaxed);
+            measured_ticks_.store(now - start, std::memory_order_relaxed);
+        }
+    }
+    measured_ticks_.store(last - start, std::memory_order_relaxed);
+}
+
+} // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "../include/hop_tracer.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace MessageRouter {
+
+namespace {
+
+size_t round_up_pow2(size_t value) {
+    size_t rounded = 1;
+    while (rounded < value) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+uint64_t elapsed(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+double ticks_to_micros(uint64_t ticks) {
+    return ticks / TscClock::ticks_per_nano() / 1000.0;
+}
+
+} // namespace
+
+HopTracer::HopTracer(const HopTraceConfig& config, size_t strategy_count)
+    : config_(config)
+    , sample_mask_(config.sample_every - 1)
+    , sample_shift_(static_cast<unsigned>(__builtin_ctzll(config.sample_every)))
+    , outlier_ticks_(TscClock::nanos_to_ticks(config.outlier_us * 1000))
+    , outliers_seen_(0) {
+    const size_t slots = round_up_pow2(config.table_slots);
+    slots_ = std::make_unique<Slot[]>(slots);
+    slot_mask_ = slots - 1;
+    for (size_t i = 0; i < strategy_count; ++i) {
+        strategies_.push_back(std::make_unique<StrategyHops>());
+    }
+    outliers_.reserve(config.max_outliers);
+}
+
+void HopTracer::stamp(std::atomic<uint64_t> Slot::* hop, const Message* batch, size_t count) {
+    uint64_t now = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!sampled(batch[i])) {
+            continue;
+        }
+        if (now == 0) {
+            now = TscClock::now();
+        }
+        Slot& slot = slot_for(batch[i]);
+        const uint64_t key = slot_key(batch[i]);
+        if (hop == &Slot::stage1) {
+            // First hop claims the slot from whatever sample held it
+            slot.key.store(key, std::memory_order_relaxed);
+            slot.stage2.store(0, std::memory_order_relaxed);
+        } else if (slot.key.load(std::memory_order_relaxed) != key) {
+            continue;
+        }
+        // The queue push after this publishes the stamp to the next stage
+        (slot.*hop).store(now, std::memory_order_relaxed);
+    }
+}
+
+void HopTracer::complete(StrategyId strategy_id, const Message& message, uint64_t delivered) {
+    if (strategy_id >= strategies_.size()) {
+        return;
+    }
+    StrategyHops& hops = *strategies_[strategy_id];
+
+    Slot& slot = slot_for(message);
+    const uint64_t key = slot_key(message);
+    HopSample sample{message.producer_id, message.sequence_number, message.msg_type, strategy_id,
+                     message.timestamp, 0, message.processing_timestamp, 0, delivered};
+    if (slot.key.load(std::memory_order_acquire) == key) {
+        sample.stage1 = slot.stage1.load(std::memory_order_relaxed);
+        sample.stage2 = slot.stage2.load(std::memory_order_relaxed);
+    }
+    // A later sample may have claimed the slot while it was read
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.key.load(std::memory_order_relaxed) != key || sample.stage1 == 0 || sample.stage2 == 0) {
+        hops.lost.store(hops.lost.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    const uint64_t total = elapsed(sample.produced, sample.delivered);
+    hops.hops[ProducerToStage1].record(elapsed(sample.produced, sample.stage1));
+    hops.hops[Stage1ToProcessor].record(elapsed(sample.stage1, sample.processed));
+    hops.hops[ProcessorToStage2].record(elapsed(sample.processed, sample.stage2));
+    hops.hops[Stage2ToStrategy].record(elapsed(sample.stage2, sample.delivered));
+    hops.hops[EndToEnd].record(total);
+    hops.samples.store(hops.samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (total > outlier_ticks_ && config_.max_outliers > 0) {
+        std::lock_guard<std::mutex> lock(outliers_mutex_);
+        ++outliers_seen_;
+        if (outliers_.size() < config_.max_outliers) {
+            outliers_.push_back(sample);
+        } else {
+            // Keep the worst: replace the mildest kept outlier
+            auto mildest = std::min_element(outliers_.begin(), outliers_.end(),
+                                            [](const HopSample& a, const HopSample& b) {
+                                                return a.delivered - a.produced < b.delivered - b.produced;
+                                            });
+            if (mildest->delivered - mildest->produced < total) {
+                *mildest = sample;
+            }
+        }
+    }
+}
+
+uint64_t HopTracer::get_samples() const {
+    uint64_t total = 0;
+    for (const auto& hops : strategies_) {
+        total += hops->samples.load();
+    }
+    return total;
+}
+
+uint64_t HopTracer::get_samples_lost() const {
+    uint64_t total = 0;
+    for (const auto& hops : strategies_) {
+        total += hops->lost.load();
+    }
+    return total;
+}
+
+const char* HopTracer::hop_name(Hop hop) {
+    switch (hop) {
+        case ProducerToStage1: return "producer->stage1";
+        case Stage1ToProcessor: return "stage1->processor";
+        case ProcessorToStage2: return "processor->stage2";
+        case Stage2ToStrategy: return "stage2->strategy";
+        case EndToEnd: return "end to end";
+        default: return "unknown";
+    }
+}
+
+void HopTracer::print_report() const {
+    std::cout << "" << std::endl;
+    std::cout << "Hop Trace (1 in " << config_.sample_every << " messages, " << get_samples() << " sampled, "
+              << get_samples_lost() << " lost):" << std::endl;
+    if (get_samples() == 0) {
+        return;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  " << std::left << std::setw(20) << "Hop (us)" << std::right
+              << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+    for (size_t hop = 0; hop < kHops; ++hop) {
+        LatencyHistogram merged;
+        for (const auto& hops : strategies_) {
+            merged.merge_from(hops->hops[hop]);
+        }
+        std::cout << "  " << std::left << std::setw(20) << hop_name(static_cast<Hop>(hop)) << std::right
+                  << std::setw(10) << ticks_to_micros(merged.value_at_percentile(50.0))
+                  << std::setw(10) << ticks_to_micros(merged.value_at_percentile(99.0))
+                  << std::setw(10) << ticks_to_micros(merged.max()) << std::endl;
+    }
+
+    std::vector<HopSample> outliers;
+    uint64_t outliers_seen;
+    {
+        std::lock_guard<std::mutex> lock(outliers_mutex_);
+        outliers = outliers_;
+        outliers_seen = outliers_seen_;
+    }
+    if (outliers.empty()) {
+        return;
+    }
+    std::sort(outliers.begin(), outliers.end(), [](const HopSample& a, const HopSample& b) {
+        return a.delivered - a.produced > b.delivered - b.produced;
+    });
+    std::cout << "  Outliers over " << config_.outlier_us << " us (worst " << outliers.size() << " of "
+              << outliers_seen << "):" << std::endl;
+    for (const auto& sample : outliers) {
+        std::cout << "    producer " << sample.producer_id << " seq " << sample.sequence_number
+                  << " type " << static_cast<int>(sample.msg_type) << " -> strategy " << sample.strategy_id
+                  << ": " << ticks_to_micros(elapsed(sample.produced, sample.delivered)) << " = "
+                  << ticks_to_micros(elapsed(sample.produced, sample.stage1)) << " + "
+                  << ticks_to_micros(elapsed(sample.stage1, sample.processed)) << " + "
+                  << ticks_to_micros(elapsed(sample.processed, sample.stage2)) << " + "
+                  << ticks_to_micros(elapsed(sample.stage2, sample.delivered)) << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+} // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,486 @@
+#include "../include/ingress.h"
+#include "../include/tsc_clock.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+namespace {
+
+constexpr uint16_t kBufferGroup = 0;
+
+int bind_inet(const std::string& address, int port, int type, int& bound_port) {
+    int fd = ::socket(AF_INET, type | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("ingress socket failed: ") + std::strerror(errno));
+    }
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        ::close(fd);
+        throw std::runtime_error("ingress bind_address is not an IPv4 address: " + address);
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        (type == SOCK_STREAM && ::listen(fd, SOMAXCONN) != 0)) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("ingress bind to " + address + ":" + std::to_string(port) +
+                                 " failed: " + std::strerror(err));
+    }
+
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    bound_port = ntohs(addr.sin_port);
+    return fd;
+}
+
+int bind_unix(const std::string& path) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("ingress unix socket failed: ") + std::strerror(errno));
+    }
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        ::close(fd);
+        throw std::runtime_error("ingress unix_path too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("ingress bind to " + path + " failed: " + std::strerror(err));
+    }
+    return fd;
+}
+
+} // namespace
+
+IngressServer::IngressServer(const IngressConfig& config,
+                             const std::vector<std::shared_ptr<MessageQueue>>& output_queues)
+    : config_(config)
+    , output_queues_(output_queues)
+    , tcp_fd_(-1)
+    , udp_fd_(-1)
+    , unix_fd_(-1)
+    , tcp_port_(-1)
+    , udp_port_(-1)
+    , next_producer_id_(config.first_producer_id)
+    , running_(false)
+    , messages_received_(0)
+    , messages_dropped_(0)
+    , bytes_received_(0)
+    , connections_accepted_(0)
+    , malformed_frames_(0) {
+    if (output_queues_.empty()) {
+        throw std::runtime_error("ingress needs at least one producer queue");
+    }
+
+    ring_ = std::make_unique<IoUring>(config_.ring_entries);
+    ring_->setup_buffer_ring(kBufferGroup, config_.buffer_count, config_.buffer_size);
+
+    if (config_.tcp_port >= 0) {
+        tcp_fd_ = bind_inet(config_.bind_address, config_.tcp_port, SOCK_STREAM, tcp_port_);
+    }
+    if (config_.udp_port >= 0) {
+        udp_fd_ = bind_inet(config_.bind_address, config_.udp_port, SOCK_DGRAM, udp_port_);
+    }
+    if (!config_.unix_path.empty()) {
+        unix_fd_ = bind_unix(config_.unix_path);
+    }
+
+    // Multishot recvmsg reads the name/control layout from this header on every completion
+    std::memset(&udp_msg_, 0, sizeof(udp_msg_));
+    udp_msg_.msg_name = &udp_name_;
+    udp_msg_.msg_namelen = sizeof(sockaddr_in);
+}
+
+IngressServer::~IngressServer() {
+    stop();
+    for (auto& connection : connections_) {
+        if (connection) {
+            ::close(connection->fd);
+        }
+    }
+    for (int fd : {tcp_fd_, udp_fd_, unix_fd_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (!config_.unix_path.empty()) {
+        ::unlink(config_.unix_path.c_str());
+    }
+}
+
+void IngressServer::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    ingress_thread_ = std::make_unique<std::thread>(&IngressServer::event_loop, this);
+}
+
+void IngressServer::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    wait_for_completion();
+}
+
+void IngressServer::wait_for_completion() {
+    if (ingress_thread_ && ingress_thread_->joinable()) {
+        ingress_thread_->join();
+    }
+}
+
+io_uring_sqe* IngressServer::next_sqe() {
+    io_uring_sqe* sqe = ring_->get_sqe();
+    while (!sqe) {
+        ring_->submit();
+        sqe = ring_->get_sqe();
+    }
+    return sqe;
+}
+
+void IngressServer::arm_accept(int listen_fd) {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = user_data(Kind::Accept, listen_fd);
+}
+
+void IngressServer::arm_recv(int fd) {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = user_data(Kind::Recv, fd);
+}
+
+void IngressServer::arm_udp_recv() {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = udp_fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&udp_msg_);
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+    sqe->user_data = user_data(Kind::RecvUdp, udp_fd_);
+}
+
+void IngressServer::event_loop() {
+    if (tcp_fd_ >= 0) {
+        arm_accept(tcp_fd_);
+    }
+    if (unix_fd_ >= 0) {
+        arm_accept(unix_fd_);
+    }
+    if (udp_fd_ >= 0) {
+        arm_udp_recv();
+    }
+
+    while (running_.load(std::memory_order_relaxed)) {
+        if (ring_->has_pending()) {
+            ring_->submit();
+        }
+
+        unsigned completed = ring_->for_each_completion([this](const io_uring_cqe& cqe) {
+            Kind kind = static_cast<Kind>(cqe.user_data >> 32);
+            int fd = static_cast<int>(cqe.user_data & 0xffffffffu);
+            switch (kind) {
+                case Kind::Accept:  on_accept(cqe, fd); break;
+                case Kind::Recv:    on_recv(cqe, fd); break;
+                case Kind::RecvUdp: on_udp_recv(cqe); break;
+            }
+        });
+
+        if (completed) {
+            ring_->publish_buffers();
+        } else {
+            // Nothing arrived - busy-waiting for minimal latency
+            std::this_thread::yield();
+        }
+    }
+}
+
+void IngressServer::on_accept(const io_uring_cqe& cqe, int listen_fd) {
+    if (cqe.res >= 0) {
+        int fd = cqe.res;
+        if (listen_fd == tcp_fd_) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        open_connection(fd);
+        connections_accepted_.fetch_add(1, std::memory_order_relaxed);
+        arm_recv(fd);
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE) && running_.load(std::memory_order_relaxed)) {
+        arm_accept(listen_fd);
+    }
+}
+
+void IngressServer::on_recv(const io_uring_cqe& cqe, int fd) {
+    Connection* connection = fd < static_cast<int>(connections_.size()) ? connections_[fd].get() : nullptr;
+
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0 && connection) {
+            bytes_received_.fetch_add(cqe.res, std::memory_order_relaxed);
+            decode_stream(*connection, ring_->buffer(buffer_id), static_cast<size_t>(cqe.res), TscClock::now());
+        }
+        ring_->recycle_buffer(buffer_id);
+    }
+
+    if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS)) {
+        // Peer closed or hard error; the multishot request is finished
+        close_connection(fd);
+        return;
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE) && connection) {
+        arm_recv(fd);
+    }
+}
+
+void IngressServer::on_udp_recv(const io_uring_cqe& cqe) {
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0) {
+            const uint8_t* buffer = ring_->buffer(buffer_id);
+            const auto* out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+            const uint8_t* payload = buffer + sizeof(io_uring_recvmsg_out) +
+                                     udp_msg_.msg_namelen + udp_msg_.msg_controllen;
+            size_t payload_len = out->payloadlen;
+
+            if ((out->flags & MSG_TRUNC) || out->namelen > udp_msg_.msg_namelen ||
+                payload + payload_len > buffer + cqe.res) {
+                malformed_frames_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                // Each UDP peer (address:port) is its own producer
+                sockaddr_in peer;
+                std::memcpy(&peer, buffer + sizeof(io_uring_recvmsg_out), sizeof(peer));
+                uint64_t key = (static_cast<uint64_t>(peer.sin_addr.s_addr) << 16) | peer.sin_port;
+
+                auto& connection = udp_peers_[key];
+                if (!connection) {
+                    connection = std::make_unique<Connection>();
+                    connection->producer_id = next_producer_id_++;
+                    connection->queue = output_queues_[connection->producer_id % output_queues_.size()].get();
+                    connections_accepted_.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                bytes_received_.fetch_add(payload_len, std::memory_order_relaxed);
+                if (payload_len % sizeof(IngressFrame) != 0) {
+                    malformed_frames_.fetch_add(1, std::memory_order_relaxed);
+                }
+                uint64_t now = TscClock::now();
+                for (size_t offset = 0; offset + sizeof(IngressFrame) <= payload_len; offset += sizeof(IngressFrame)) {
+                    IngressFrame frame;
+                    std::memcpy(&frame, payload + offset, sizeof(frame));
+                    push_frame(*connection, frame, now);
+                }
+            }
+        }
+        ring_->recycle_buffer(buffer_id);
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_MORE) && running_.load(std::memory_order_relaxed)) {
+        arm_udp_recv();
+    }
+}
+
+IngressServer::Connection* IngressServer::open_connection(int fd) {
+    if (fd >= static_cast<int>(connections_.size())) {
+        connections_.resize(fd + 1);
+    }
+    auto connection = std::make_unique<Connection>();
+    connection->fd = fd;
+    connection->producer_id = next_producer_id_++;
+    connection->queue = output_queues_[connection->producer_id % output_queues_.size()].get();
+    connections_[fd] = std::move(connection);
+    return connections_[fd].get();
+}
+
+void IngressServer::close_connection(int fd) {
+    if (fd < static_cast<int>(connections_.size()) && connections_[fd]) {
+        if (connections_[fd]->carry_len) {
+            malformed_frames_.fetch_add(1, std::memory_order_relaxed);
+        }
+        connections_[fd].reset();
+        ::close(fd);
+    }
+}
+
+void IngressServer::decode_stream(Connection& connection, const uint8_t* data, size_t length, uint64_t now) {
+    // Finish a frame split across two receives
+    if (connection.carry_len) {
+        size_t take = std::min(sizeof(IngressFrame) - connection.carry_len, length);
+        std::memcpy(connection.carry + connection.carry_len, data, take);
+        connection.carry_len += take;
+        data += take;
+        length -= take;
+        if (connection.carry_len < sizeof(IngressFrame)) {
+            return;
+        }
+        IngressFrame frame;
+        std::memcpy(&frame, connection.carry, sizeof(frame));
+        push_frame(connection, frame, now);
+        connection.carry_len = 0;
+    }
+
+    while (length >= sizeof(IngressFrame)) {
+        IngressFrame frame;
+        std::memcpy(&frame, data, sizeof(frame));
+        push_frame(connection, frame, now);
+        data += sizeof(IngressFrame);
+        length -= sizeof(IngressFrame);
+    }
+
+    if (length) {
+        std::memcpy(connection.carry, data, length);
+        connection.carry_len = length;
+    }
+}
+
+void IngressServer::push_frame(Connection& connection, const IngressFrame& frame, uint64_t now) {
+    // Decode directly into the queue slot
+    auto fill = [&](Message& message) {
+        message.msg_type = frame.msg_type;
+        message.producer_id = connection.producer_id;
+        message.sequence_number = connection.next_sequence;
+        message.timestamp = now;
+        message.processor_id = 0;
+        message.processing_timestamp = 0;
+    };
+
+    for (int retry = 0; retry < 1000; ++retry) {
+        if (connection.queue->try_push_with(fill)) {
+            ++connection.next_sequence;
+            messages_received_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // Queue full - small pause and retry
+        std::this_thread::yield();
+    }
+    messages_dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+IngressLoadClient::IngressLoadClient(const std::string& address, int port, int connections, int messages_per_sec)
+    : address_(address)
+    , port_(port)
+    , connections_(connections)
+    , messages_per_sec_(messages_per_sec)
+    , running_(false)
+    , messages_sent_(0) {
+}
+
+IngressLoadClient::~IngressLoadClient() {
+    stop();
+}
+
+void IngressLoadClient::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    for (int i = 0; i < connections_; ++i) {
+        client_threads_.push_back(std::make_unique<std::thread>(&IngressLoadClient::client_loop, this, i));
+    }
+}
+
+void IngressLoadClient::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    wait_for_completion();
+}
+
+void IngressLoadClient::wait_for_completion() {
+    for (auto& thread : client_threads_) {
+        if (thread && thread->joinable()) {
+            thread->join();
+        }
+    }
+    client_threads_.clear();
+}
+
+void IngressLoadClient::client_loop(int connection_index) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return;
+    }
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port_));
+    ::inet_pton(AF_INET, address_.c_str(), &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    std::vector<IngressFrame> batch(kBatchFrames);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        batch[i].msg_type = static_cast<uint8_t>((i + connection_index) & 3);
+        std::memset(batch[i].reserved, 0, sizeof(batch[i].reserved));
+        batch[i].client_tag = static_cast<uint32_t>(i);
+    }
+
+    const bool paced = messages_per_sec_ > 0;
+    const double ticks_per_message = paced ? 1e9 / messages_per_sec_ * TscClock::ticks_per_nano() : 0.0;
+    const uint64_t start_time = TscClock::now();
+    uint64_t sent = 0;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        size_t frames = kBatchFrames;
+        if (paced) {
+            uint64_t due = static_cast<uint64_t>((TscClock::now() - start_time) / ticks_per_message);
+            if (due <= sent) {
+                std::this_thread::yield();
+                continue;
+            }
+            frames = std::min<uint64_t>(kBatchFrames, due - sent);
+        }
+
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(batch.data());
+        size_t remaining = frames * sizeof(IngressFrame);
+        while (remaining && running_.load(std::memory_order_relaxed)) {
+            ssize_t written = ::send(fd, data, remaining, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR || errno == EAGAIN) {
+                    continue;
+                }
+                ::close(fd);
+                return;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+        sent += frames;
+        messages_sent_.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+    ::close(fd);
+}
+
+} // namespace MessageRouter
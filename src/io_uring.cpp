@@ -0,0 +1,214 @@
+#include "../include/io_uring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+namespace {
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template<typename T>
+T* ring_field(void* ring, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+}
+
+} // namespace
+
+IoUring::IoUring(unsigned entries)
+    : ring_fd_(-1)
+    , sq_ring_(MAP_FAILED)
+    , cq_ring_(MAP_FAILED)
+    , sq_ring_bytes_(0)
+    , cq_ring_bytes_(0)
+    , sqes_(nullptr)
+    , sqes_bytes_(0)
+    , sqe_head_(0)
+    , sqe_tail_(0)
+    , buf_ring_(nullptr)
+    , buf_ring_bytes_(0)
+    , buffers_(nullptr)
+    , buffers_bytes_(0)
+    , buffer_size_(0)
+    , buf_mask_(0)
+    , buf_tail_(0)
+    , buf_group_(0) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ring_fd_ = sys_io_uring_setup(entries, &params);
+    if (ring_fd_ < 0) {
+        throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+    }
+
+    sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        ::close(ring_fd_);
+        throw std::runtime_error(std::string("io_uring SQ mmap failed: ") + std::strerror(errno));
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = ::mmap(nullptr, cq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            ::munmap(sq_ring_, sq_ring_bytes_);
+            ::close(ring_fd_);
+            throw std::runtime_error(std::string("io_uring CQ mmap failed: ") + std::strerror(errno));
+        }
+    }
+
+    sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_ring_bytes_);
+        }
+        ::munmap(sq_ring_, sq_ring_bytes_);
+        ::close(ring_fd_);
+        throw std::runtime_error(std::string("io_uring SQE mmap failed: ") + std::strerror(errno));
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_ = ring_field<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = ring_field<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = *ring_field<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sqe_head_ = sqe_tail_ = *sq_tail_;
+
+    // Identity SQ index array: slot i always refers to sqes_[i]
+    unsigned* sq_array = ring_field<unsigned>(sq_ring_, params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+        sq_array[i] = i;
+    }
+
+    cq_head_ = ring_field<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = ring_field<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = *ring_field<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = ring_field<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+    if (buf_ring_) {
+        io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.bgid = buf_group_;
+        sys_io_uring_register(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        ::munmap(buf_ring_, buf_ring_bytes_);
+    }
+    if (buffers_) {
+        ::munmap(buffers_, buffers_bytes_);
+    }
+    ::munmap(sqes_, sqes_bytes_);
+    if (cq_ring_ != sq_ring_) {
+        ::munmap(cq_ring_, cq_ring_bytes_);
+    }
+    ::munmap(sq_ring_, sq_ring_bytes_);
+    ::close(ring_fd_);
+}
+
+io_uring_sqe* IoUring::get_sqe() {
+    unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+    if (sqe_tail_ - head >= sq_entries_) {
+        return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submit() {
+    unsigned to_submit = sqe_tail_ - sqe_head_;
+    if (to_submit == 0) {
+        return 0;
+    }
+    std::atomic_ref<unsigned>(*sq_tail_).store(sqe_tail_, std::memory_order_release);
+    sqe_head_ = sqe_tail_;
+
+    int ret = sys_io_uring_enter(ring_fd_, to_submit, 0, 0);
+    return ret < 0 ? -errno : ret;
+}
+
+void IoUring::setup_buffer_ring(uint16_t group, unsigned count, unsigned size) {
+    if (buf_ring_ || count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        throw std::runtime_error("io_uring buffer ring needs a power-of-two count <= 32768");
+    }
+
+    buf_ring_bytes_ = count * sizeof(io_uring_buf);
+    void* ring = ::mmap(nullptr, buf_ring_bytes_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED) {
+        throw std::runtime_error(std::string("buffer ring mmap failed: ") + std::strerror(errno));
+    }
+    buffers_bytes_ = static_cast<size_t>(count) * size;
+    void* buffers = ::mmap(nullptr, buffers_bytes_, PROT_READ | PROT_WRITE,
+                           MAP_ANONYMOUS | MAP_PRIVATE | MAP_POPULATE, -1, 0);
+    if (buffers == MAP_FAILED) {
+        ::munmap(ring, buf_ring_bytes_);
+        throw std::runtime_error(std::string("receive buffer mmap failed: ") + std::strerror(errno));
+    }
+
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (sys_io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        ::munmap(buffers, buffers_bytes_);
+        ::munmap(ring, buf_ring_bytes_);
+        throw std::runtime_error(std::string("IORING_REGISTER_PBUF_RING failed: ") + std::strerror(err));
+    }
+
+    buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+    buffers_ = static_cast<uint8_t*>(buffers);
+    buffer_size_ = size;
+    buf_mask_ = count - 1;
+    buf_tail_ = 0;
+    buf_group_ = group;
+
+    for (unsigned i = 0; i < count; ++i) {
+        recycle_buffer(static_cast<uint16_t>(i));
+    }
+    publish_buffers();
+}
+
+void IoUring::recycle_buffer(uint16_t id) {
+    // Index the ring as a plain array: in C++ the header's flex-array wrapper
+    // has a 1-byte empty member that would shift `bufs` off the kernel layout
+    io_uring_buf& buf = reinterpret_cast<io_uring_buf*>(buf_ring_)[buf_tail_ & buf_mask_];
+    buf.addr = reinterpret_cast<uint64_t>(buffer(id));
+    buf.len = buffer_size_;
+    buf.bid = id;
+    ++buf_tail_;
+}
+
+void IoUring::publish_buffers() {
+    std::atomic_ref<uint16_t>(buf_ring_->tail).store(buf_tail_, std::memory_order_release);
+}
+
+} // namespace MessageRouter
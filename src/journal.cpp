@@ -0,0 +1,383 @@
+#include "../include/journal.h"
+#include "../include/tsc_clock.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+namespace {
+
+constexpr size_t kBatchBudget = 256;
+constexpr int kIdleBackoffUs = 20;
+constexpr const char* kSegmentPrefix = "journal-";
+constexpr const char* kSegmentSuffix = ".seg";
+
+bool parse_segment_index(const std::string& name, uint64_t& index) {
+    const size_t prefix = std::strlen(kSegmentPrefix);
+    const size_t suffix = std::strlen(kSegmentSuffix);
+    if (name.size() <= prefix + suffix || name.compare(0, prefix, kSegmentPrefix) != 0 ||
+        name.compare(name.size() - suffix, suffix, kSegmentSuffix) != 0) {
+        return false;
+    }
+    index = 0;
+    for (size_t i = prefix; i < name.size() - suffix; ++i) {
+        if (name[i] < '0' || name[i] > '9') {
+            return false;
+        }
+        index = index * 10 + static_cast<uint64_t>(name[i] - '0');
+    }
+    return true;
+}
+
+std::vector<std::pair<uint64_t, std::string>> list_segments(const std::string& directory) {
+    std::vector<std::pair<uint64_t, std::string>> segments;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        uint64_t index = 0;
+        if (entry.is_regular_file() && parse_segment_index(entry.path().filename().string(), index)) {
+            segments.emplace_back(index, entry.path().string());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+} // namespace
+
+Journal::Journal(const SystemConfig* config, uint64_t first_segment_index)
+    : config_(config)
+    , group_commit_ticks_(TscClock::nanos_to_ticks(config->journal.group_commit_us * 1000))
+    , fd_(-1)
+    , segment_(nullptr)
+    , segment_index_(first_segment_index)
+    , oldest_segment_index_(first_segment_index)
+    , write_offset_(0)
+    , committed_offset_(0)
+    , uncommitted_records_(0)
+    , oldest_uncommitted_(0)
+    , sync_requested_(false)
+    , running_(false)
+    , records_written_(0)
+    , commits_(0)
+    , segments_written_(0)
+    , bytes_written_(0)
+    , commit_failures_(0)
+    , records_lost_(0)
+    , segments_deleted_(0) {
+    auto parse_durability = [](const std::string& mode) {
+        if (mode == "none") return Durability::None;
+        if (mode == "sync") return Durability::Sync;
+        return Durability::Async;
+    };
+    durability_.fill(parse_durability(config->journal.default_durability));
+    for (const auto& [key, mode] : config->journal.durability) {
+        // Keys follow producers.distribution: "msg_type_<n>"
+        int msg_type = std::atoi(key.c_str() + key.rfind('_') + 1);
+        if (msg_type >= 0 && msg_type < 256) {
+            durability_[msg_type] = parse_durability(mode);
+        }
+    }
+
+    for (int i = 0; i < config->strategies.count; ++i) {
+        input_queues_.push_back(std::make_unique<JournalQueue>());
+    }
+    appended_.assign(input_queues_.size(), 0);
+    committed_ = std::make_unique<CommitWatermark[]>(input_queues_.size());
+
+    std::filesystem::create_directories(config->journal.directory);
+    // Recovered segments from earlier runs count against the retention window
+    auto segments = list_segments(config->journal.directory);
+    if (!segments.empty()) {
+        oldest_segment_index_ = std::min(oldest_segment_index_, segments.front().first);
+    }
+    open_segment(segment_index_);
+    retire_segments();
+}
+
+Journal::~Journal() {
+    stop();
+    close_segment();
+}
+
+uint32_t Journal::checksum(const JournalRecord& record) {
+    // FNV-1a over everything before the checksum field
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(JournalRecord, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash | 1;
+}
+
+std::string Journal::segment_path(const std::string& directory, uint64_t segment_index) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%010llu%s", kSegmentPrefix,
+                  static_cast<unsigned long long>(segment_index), kSegmentSuffix);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+JournalRecovery Journal::recover(const SystemConfig* config) {
+    JournalRecovery recovery;
+    recovery.strategy_sequences.resize(config->strategies.count);
+
+    auto segments = list_segments(config->journal.directory);
+    if (!segments.empty()) {
+        recovery.next_segment_index = segments.back().first + 1;
+    }
+
+    if (!config->journal.recover) {
+        for (const auto& [index, path] : segments) {
+            std::filesystem::remove(path);
+        }
+        return recovery;
+    }
+
+    for (const auto& [index, path] : segments) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open journal segment " + path + ": " + std::strerror(errno));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(JournalSegmentHeader)) {
+            ::close(fd);
+            continue;
+        }
+        size_t bytes = static_cast<size_t>(st.st_size);
+        void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map journal segment " + path + ": " + std::strerror(errno));
+        }
+        ::madvise(mapping, bytes, MADV_SEQUENTIAL);
+
+        const auto* header = static_cast<const JournalSegmentHeader*>(mapping);
+        if (header->magic == JournalSegmentHeader::kMagic && header->version == JournalSegmentHeader::kVersion &&
+            header->record_size == sizeof(JournalRecord)) {
+            const uint8_t* cursor = static_cast<const uint8_t*>(mapping) + sizeof(JournalSegmentHeader);
+            const uint8_t* end = static_cast<const uint8_t*>(mapping) + bytes;
+            JournalRecord record;
+            for (; cursor + sizeof(JournalRecord) <= end; cursor += sizeof(JournalRecord)) {
+                std::memcpy(&record, cursor, sizeof(record));
+                if (record.checksum == 0 || record.checksum != checksum(record)) {
+                    break; // pre-allocated tail or torn write
+                }
+                if (record.strategy_id < recovery.strategy_sequences.size()) {
+                    recovery.strategy_sequences[record.strategy_id][{record.producer_id, record.msg_type}] =
+                        record.sequence_number;
+                }
+                SequenceNumber& highest = recovery.producer_sequences[record.producer_id];
+                highest = std::max(highest, record.sequence_number);
+                ++recovery.records_replayed;
+            }
+            ++recovery.segments_scanned;
+        }
+        ::munmap(mapping, bytes);
+    }
+    return recovery;
+}
+
+void Journal::open_segment(uint64_t segment_index) {
+    const std::string path = segment_path(config_->journal.directory, segment_index);
+    const size_t bytes = config_->journal.segment_bytes;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot create journal segment " + path + ": " + std::strerror(errno));
+    }
+    // Reserve the blocks up front so appends never allocate on the hot path
+    int error = ::posix_fallocate(fd_, 0, static_cast<off_t>(bytes));
+    if (error != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Cannot allocate journal segment " + path + ": " + std::strerror(error));
+    }
+    void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Cannot map journal segment " + path + ": " + std::strerror(errno));
+    }
+    segment_ = static_cast<uint8_t*>(mapping);
+    segment_index_ = segment_index;
+
+    JournalSegmentHeader header{};
+    header.magic = JournalSegmentHeader::kMagic;
+    header.version = JournalSegmentHeader::kVersion;
+    header.record_size = sizeof(JournalRecord);
+    header.segment_index = segment_index;
+    std::memcpy(segment_, &header, sizeof(header));
+
+    write_offset_ = sizeof(JournalSegmentHeader);
+    committed_offset_ = 0;
+    segments_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Journal::close_segment() {
+    if (!segment_) {
+        return;
+    }
+    // A failed commit settles the records as lost before they are unmapped
+    commit();
+    ::munmap(segment_, config_->journal.segment_bytes);
+    ::close(fd_);
+    segment_ = nullptr;
+    fd_ = -1;
+}
+
+void Journal::retire_segments() {
+    const size_t retain = config_->journal.retain_segments;
+    if (retain == 0) {
+        return;
+    }
+    // The open segment is always kept
+    while (segment_index_ - oldest_segment_index_ >= retain) {
+        std::error_code error;
+        if (std::filesystem::remove(segment_path(config_->journal.directory, oldest_segment_index_), error)) {
+            segments_deleted_.fetch_add(1, std::memory_order_relaxed);
+        }
+        ++oldest_segment_index_;
+    }
+}
+
+void Journal::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    journal_thread_ = std::make_unique<std::thread>(&Journal::journal_loop, this);
+}
+
+void Journal::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    wait_for_completion();
+}
+
+void Journal::wait_for_completion() {
+    if (journal_thread_ && journal_thread_->joinable()) {
+        journal_thread_->join();
+    }
+}
+
+void Journal::journal_loop() {
+    JournalRecord record;
+
+    auto drain = [&]() {
+        size_t drained = 0;
+        for (size_t i = 0; i < input_queues_.size(); ++i) {
+            for (size_t n = 0; n < kBatchBudget && input_queues_[i]->try_pop(record); ++n) {
+                append(record, i);
+                ++drained;
+            }
+        }
+        return drained;
+    };
+
+    while (running_.load(std::memory_order_relaxed)) {
+        size_t drained = drain();
+
+        // Group commit: everything drained in this pass shares one sync
+        if (uncommitted_records_ > 0 &&
+            (sync_requested_ || TscClock::now() - oldest_uncommitted_ >= group_commit_ticks_)) {
+            commit();
+        }
+
+        if (drained == 0) {
+            // Nothing to journal. Durability is off the delivery path, so
+            // back off instead of competing with the pipeline threads for CPU
+            std::this_thread::sleep_for(std::chrono::microseconds(kIdleBackoffUs));
+        }
+    }
+
+    // Strategies are stopped before the journal: persist what they left behind
+    while (drain() > 0) {
+    }
+    commit();
+}
+
+void Journal::append(const JournalRecord& record, size_t input) {
+    if (write_offset_ + sizeof(JournalRecord) > config_->journal.segment_bytes) {
+        close_segment();
+        open_segment(segment_index_ + 1);
+        retire_segments();
+    }
+
+    if (uncommitted_records_ == 0) {
+        oldest_uncommitted_ = TscClock::now();
+    }
+    std::memcpy(segment_ + write_offset_, &record, sizeof(record));
+    write_offset_ += sizeof(JournalRecord);
+    ++uncommitted_records_;
+    // Counted only once written, so the commit of a segment roll above
+    // never claims this record
+    ++appended_[input];
+    records_written_.fetch_add(1, std::memory_order_relaxed);
+
+    if (durability_[record.msg_type] == Durability::Sync) {
+        sync_requested_ = true;
+    }
+    if (uncommitted_records_ >= config_->journal.group_commit_records) {
+        commit();
+    }
+}
+
+void Journal::commit() {
+    if (!segment_ || write_offset_ <= committed_offset_) {
+        return;
+    }
+
+    // msync is the mmap counterpart of fdatasync: it writes back and waits
+    // for only the pages dirtied since the previous commit
+    static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t start = committed_offset_ & ~(page_size - 1);
+
+    uint64_t begin = TscClock::now();
+    if (::msync(segment_ + start, write_offset_ - start, MS_SYNC) != 0) {
+        commit_failures_.fetch_add(1, std::memory_order_relaxed);
+        settle_lost();
+        return;
+    }
+    commit_latency_.record(TscClock::now() - begin);
+
+    bytes_written_.fetch_add(uncommitted_records_ * sizeof(JournalRecord), std::memory_order_relaxed);
+    for (size_t i = 0; i < appended_.size(); ++i) {
+        committed_[i].records.store(appended_[i], std::memory_order_release);
+    }
+    committed_offset_ = write_offset_;
+    uncommitted_records_ = 0;
+    sync_requested_ = false;
+    commits_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Journal::settle_lost() {
+    for (size_t i = 0; i < appended_.size(); ++i) {
+        CommitWatermark& watermark = committed_[i];
+        const uint64_t settled = watermark.records.load(std::memory_order_relaxed);
+        if (appended_[i] == settled) {
+            continue;
+        }
+        watermark.lost.store(watermark.lost.load(std::memory_order_relaxed) + appended_[i] - settled,
+                             std::memory_order_relaxed);
+        watermark.records.store(appended_[i], std::memory_order_release);
+    }
+    records_lost_.fetch_add(uncommitted_records_, std::memory_order_relaxed);
+    // Later commits start past these records
+    committed_offset_ = write_offset_;
+    uncommitted_records_ = 0;
+    sync_requested_ = false;
+}
+
+} // namespace MessageRouter
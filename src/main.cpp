@@ -15,11 +15,26 @@
 #include "../include/strategy.h"
 #include "../include/stage1_router.h"
 #include "../include/stage2_router.h"
+#include "../include/tsc_clock.h"
+#include "../include/latency_histogram.h"
+#include "../include/message_capture.h"
+#include "../include/egress.h"
+#include "../include/journal.h"
+#include "../include/snapshot.h"
+#include "../include/payload_arena.h"
+#include "../include/monitor.h"
+#include "../include/metrics_exporter.h"
+#include "../include/metrics_registry.h"
+#include "../include/trace_ring.h"
+#include "../include/hop_tracer.h"
+#include "../include/perf_counters.h"
+#include "../include/hiccup_meter.h"
 
 using namespace MessageRouter;
 
 
 std::atomic<bool> g_running{true};
+std::atomic<bool> g_trace_dump{false};
 ProducerManager* g_producer_manager = nullptr;
 Stage1Router* g_stage1_router = nullptr;
 ProcessorManager* g_processor_manager = nullptr;
@@ -32,10 +47,26 @@ void signal_handler(int signal) {
     g_running.store(false);
 }
 
+void trace_signal_handler(int) {
+    // The main loop writes the file; nothing here may allocate
+    g_trace_dump.store(true);
+}
+
+void dump_trace(const TraceConfig& trace) {
+    try {
+        size_t events = TraceRegistry::instance().write_chrome_trace(trace.file);
+        std::cout << "Trace: " << events << " events written to " << trace.file << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Trace dump failed: " << e.what() << std::endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
     
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    // A vanished egress reader surfaces as EPIPE from writev instead
+    signal(SIGPIPE, SIG_IGN);
     
     
     if (argc != 2) {
@@ -59,9 +90,23 @@ int main(int argc, char* argv[]) {
         std::cout << "Configuration loaded successfully:" << std::endl;
         std::cout << "  Scenario: " << config->scenario << std::endl;
         std::cout << "  Duration: " << config->duration_secs << " seconds" << std::endl;
-        std::cout << "  Producers: " << config->producers.count << std::endl;
+        std::cout << "  Producers: " << config->producers.count
+                  << (config->producers.open_loop ? " (open-loop schedule)" : "") << std::endl;
         std::cout << "  Processors: " << config->processors.count << std::endl;
+        if (config->processors.autoscale.enabled) {
+            std::cout << "  Processor autoscale: min " << config->processors.autoscale.min_active
+                      << " active workers" << std::endl;
+        }
         std::cout << "  Strategies: " << config->strategies.count << std::endl;
+        std::cout << "  Timestamp clock: " << (TscClock::is_tsc() ? "invariant TSC" : "CLOCK_MONOTONIC") << std::endl;
+        if (config->strategies.scheduler_threads > 0) {
+            std::cout << "  Strategy scheduler threads: " << config->strategies.scheduler_threads << std::endl;
+        }
+        if (config->trace.enabled) {
+            signal(SIGUSR1, trace_signal_handler);
+            std::cout << "  Trace: " << config->trace.records_per_thread << " events per thread, SIGUSR1 writes "
+                      << config->trace.file << std::endl;
+        }
         
         
         std::cout << "\nCreating queues..." << std::endl;
@@ -98,10 +143,145 @@ int main(int argc, char* argv[]) {
         g_processor_manager = new ProcessorManager(config.get(), stage1_queues, processor_queues);
         g_stage2_router = new Stage2Router(config.get(), processor_queues, stage2_queues);
         g_strategy_manager = new StrategyManager(config.get(), stage2_queues);
+        g_stage2_router->set_strategy_scheduler(g_strategy_manager->get_scheduler());
+        g_stage2_router->set_conflation_tables(g_strategy_manager->get_conflation_tables());
         
+        std::unique_ptr<PayloadArenas> payloads;
+        if (config->payloads.enabled) {
+            payloads = std::make_unique<PayloadArenas>(config->payloads, config->producers.count);
+            g_producer_manager->set_payload_arenas(payloads.get());
+            g_stage1_router->set_payload_arenas(payloads.get());
+            g_processor_manager->set_payload_arenas(payloads.get());
+            g_stage2_router->set_payload_arenas(payloads.get());
+            g_strategy_manager->set_payload_arenas(payloads.get());
+            std::cout << "Payloads: " << config->payloads.min_bytes << ".." << config->payloads.max_bytes
+                      << " bytes, " << config->payloads.slots_per_class
+                      << " arena blocks per size class per producer" << std::endl;
+        }
+        
+        std::unique_ptr<HopTracer> hop_tracer;
+        if (config->hop_trace.enabled) {
+            hop_tracer = std::make_unique<HopTracer>(config->hop_trace, config->strategies.count);
+            g_stage1_router->set_hop_tracer(hop_tracer.get());
+            g_stage2_router->set_hop_tracer(hop_tracer.get());
+            g_strategy_manager->set_hop_tracer(hop_tracer.get());
+            std::cout << "Hop trace: 1 in " << config->hop_trace.sample_every << " messages, outliers over "
+                      << config->hop_trace.outlier_us << " us" << std::endl;
+        }
+        
+        if (config->perf.enabled) {
+            // Stage threads open their counters as they start
+            PerfRegistry::instance().enable();
+            std::cout << "Perf counters: cycles, instructions, LLC misses, branch misses per stage thread" << std::endl;
+        }
+        
+        std::unique_ptr<EgressStage> egress;
+        if (config->egress.enabled) {
+            egress = std::make_unique<EgressStage>(config.get());
+            g_strategy_manager->set_egress(egress.get());
+            std::cout << "Egress writing to " << config->egress.destinations.size() << " destination(s), batch "
+                      << config->egress.batch_records << " records / " << config->egress.flush_interval_us
+                      << " us" << std::endl;
+        }
+        
+        std::unique_ptr<SnapshotCoordinator> snapshots;
+        if (config->snapshot.enabled) {
+            uint64_t first_epoch = 1;
+            if (config->snapshot.restore) {
+                auto restore_start = std::chrono::steady_clock::now();
+                if (auto image = SnapshotImage::open(config->snapshot.file)) {
+                    if (image->matches(*config)) {
+                        g_strategy_manager->restore_sequences(image->strategy_sequences());
+                        g_producer_manager->restore_sequences(image->producer_sequences());
+                        ChannelRestore in_flight = image->restore_channel_state(producer_queues, processor_queues);
+                        first_epoch = image->epoch() + 1;
+                        auto restore_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - restore_start).count();
+                        std::cout << "Snapshot restore: epoch " << image->epoch() << ", "
+                                  << image->get_sequence_records() << " sequence key(s), " << in_flight.restored
+                                  << " in-flight message(s) in " << restore_us / 1000.0 << " ms" << std::endl;
+                        if (in_flight.dropped > 0) {
+                            std::cerr << "Snapshot restore: " << in_flight.dropped
+                                      << " in-flight message(s) could not be requeued and were dropped" << std::endl;
+                        }
+                    } else {
+                        std::cout << "Snapshot " << config->snapshot.file
+                                  << " was taken with a different topology, starting cold" << std::endl;
+                    }
+                }
+            }
+            snapshots = std::make_unique<SnapshotCoordinator>(config.get(), first_epoch);
+            g_producer_manager->set_snapshot_coordinator(snapshots.get());
+            g_stage1_router->set_snapshot_coordinator(snapshots.get());
+            g_stage2_router->set_snapshot_coordinator(snapshots.get());
+            g_strategy_manager->set_snapshot_coordinator(snapshots.get());
+            std::cout << "Snapshotting pipeline state to " << config->snapshot.file << " every "
+                      << config->snapshot.interval_ms << " ms" << std::endl;
+        }
+        
+        std::unique_ptr<Journal> journal;
+        if (config->journal.enabled) {
+            JournalRecovery recovery = Journal::recover(config.get());
+            if (recovery.records_replayed > 0) {
+                g_strategy_manager->restore_sequences(recovery.strategy_sequences);
+                g_producer_manager->restore_sequences(recovery.producer_sequences);
+                std::cout << "Journal recovery: " << recovery.records_replayed << " records from "
+                          << recovery.segments_scanned << " segment(s), sequence state restored for "
+                          << recovery.producer_sequences.size() << " producer(s)" << std::endl;
+            }
+            journal = std::make_unique<Journal>(config.get(), recovery.next_segment_index);
+            g_strategy_manager->set_journal(journal.get());
+            std::cout << "Journaling delivered messages to " << config->journal.directory << std::endl;
+        }
+        
+        std::unique_ptr<MessageCaptureWriter> capture;
+        if (config->capture.enabled) {
+            capture = std::make_unique<MessageCaptureWriter>(config->capture.file);
+            if (config->capture.stage == "producers") {
+                g_stage1_router->set_input_capture(capture.get());
+            } else if (config->capture.stage == "stage1") {
+                g_stage1_router->set_output_capture(capture.get());
+            } else if (config->capture.stage == "processors") {
+                g_stage2_router->set_input_capture(capture.get());
+            } else {
+                g_stage2_router->set_output_capture(capture.get());
+            }
+            std::cout << "Capturing messages leaving " << config->capture.stage
+                      << " to " << config->capture.file << std::endl;
+        }
+        
+        
+        if (const auto* ingress = g_producer_manager->get_ingress()) {
+            std::cout << "Ingress listening on " << config->ingress.bind_address
+                      << " tcp:" << ingress->get_tcp_port() << " udp:" << ingress->get_udp_port();
+            if (!config->ingress.unix_path.empty()) {
+                std::cout << " unix:" << config->ingress.unix_path;
+            }
+            std::cout << std::endl;
+        }
         
         std::cout << "Starting system..." << std::endl;
         
+        // Running before the pipeline, so it measures the whole run
+        std::unique_ptr<HiccupMeter> hiccups;
+        if (config->hiccups.enabled) {
+            hiccups = std::make_unique<HiccupMeter>(config->hiccups);
+            hiccups->start();
+            std::cout << "Hiccup meter: stalls over " << config->hiccups.threshold_ns << " ns";
+            if (config->hiccups.cpu >= 0) {
+                std::cout << " on CPU " << config->hiccups.cpu;
+            }
+            std::cout << std::endl;
+        }
+        if (egress) {
+            egress->start();
+        }
+        if (journal) {
+            journal->start();
+        }
+        if (snapshots) {
+            snapshots->start();
+        }
         g_stage1_router->start();
         g_processor_manager->start_all();
         g_stage2_router->start();
@@ -110,9 +290,30 @@ int main(int argc, char* argv[]) {
         
         std::cout << "System started. Waiting for completion..." << std::endl;
         
+        const std::vector<Monitor::QueueGroup> queue_groups = {
+            {"producer", producer_queues}, {"stage1", stage1_queues},
+            {"processor", processor_queues}, {"stage2", stage2_queues}};
+        
+        std::unique_ptr<Monitor> monitor;
+        if (config->monitor.enabled) {
+            monitor = std::make_unique<Monitor>(config.get(), queue_groups);
+            monitor->set_latency_source(g_strategy_manager);
+            monitor->set_hiccup_meter(hiccups.get());
+            monitor->start();
+        }
+        
+        std::unique_ptr<MetricsExporter> exporter;
+        if (config->metrics_http.enabled) {
+            exporter = std::make_unique<MetricsExporter>(config.get(), queue_groups, g_strategy_manager);
+            exporter->start();
+            std::cout << "Serving OpenMetrics on http://" << config->metrics_http.bind_address << ":"
+                      << exporter->get_port() << "/metrics" << std::endl;
+        }
+        
         
         auto start_time = std::chrono::steady_clock::now();
         auto duration = std::chrono::seconds(config->duration_secs);
+        auto last_recalibration = start_time;
         
         while (g_running.load()) {
             auto current_time = std::chrono::steady_clock::now();
@@ -123,6 +324,16 @@ int main(int argc, char* argv[]) {
                 break;
             }
             
+            // Keep the tick-to-nanosecond conversion tracking CLOCK_MONOTONIC
+            if (current_time - last_recalibration >= std::chrono::seconds(1)) {
+                TscClock::recalibrate();
+                last_recalibration = current_time;
+            }
+            
+            if (g_trace_dump.exchange(false)) {
+                dump_trace(config->trace);
+            }
+            
             
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
@@ -130,6 +341,15 @@ int main(int argc, char* argv[]) {
         
         std::cout << "Stopping system..." << std::endl;
         
+        if (monitor) {
+            monitor->stop();
+        }
+        if (exporter) {
+            exporter->stop();
+        }
+        if (hiccups) {
+            hiccups->stop();
+        }
         g_producer_manager->stop_all();
         g_stage1_router->stop();
         g_processor_manager->stop_all();
@@ -140,6 +360,19 @@ int main(int argc, char* argv[]) {
         g_producer_manager->wait_for_completion();
         g_processor_manager->wait_for_completion();
         g_strategy_manager->wait_for_completion();
+        if (egress) {
+            egress->stop();
+        }
+        if (journal) {
+            journal->stop();
+        }
+        if (snapshots) {
+            snapshots->stop();
+        }
+        
+        if (capture) {
+            capture->close();
+        }
         
         
         std::cout << "\n=== PERFORMANCE SUMMARY ===" << std::endl;
@@ -151,14 +384,176 @@ int main(int argc, char* argv[]) {
         std::cout << "  Total Processed:    " << g_processor_manager->get_total_messages_processed() << std::endl;
         std::cout << "  Total Delivered:    " << g_strategy_manager->get_total_messages_delivered() << std::endl;
         std::cout << "  Messages Lost:      " << (g_stage1_router->get_routing_errors() + g_stage2_router->get_routing_errors()) << std::endl;
+        if (const auto* replay = g_producer_manager->get_replay()) {
+            std::cout << "  Replayed:           " << replay->get_messages_produced() << " / "
+                      << replay->get_records_total() << " records from " << config->replay.file << std::endl;
+        }
+        if (const auto* ingress = g_producer_manager->get_ingress()) {
+            std::cout << "  Ingress Received:   " << ingress->get_messages_received() << " ("
+                      << ingress->get_connections_accepted() << " connections, "
+                      << ingress->get_bytes_received() << " bytes)" << std::endl;
+            std::cout << "  Ingress Dropped:    " << ingress->get_messages_dropped()
+                      << " (malformed " << ingress->get_malformed_frames() << ")" << std::endl;
+        }
+        if (payloads) {
+            PayloadStats payload;
+            payloads->collect_stats(payload);
+            g_producer_manager->collect_payload_stats(payload);
+            g_strategy_manager->collect_payload_stats(payload);
+            std::cout << "  Payloads:           " << payload.allocations << " in arenas, " << payload.inline_payloads
+                      << " inline (" << payload.allocations - payload.releases << " still held, "
+                      << payload.touched_bytes / (1024 * 1024) << " MB touched, exhausted " << payload.exhausted
+                      << ", corrupt " << payload.mismatches << ")" << std::endl;
+        }
+        ConflationStats conflation;
+        g_strategy_manager->collect_conflation_stats(conflation);
+        if (conflation.keys > 0) {
+            std::cout << "  Conflated:          " << conflation.updates << " updates -> " << conflation.delivered
+                      << " deliveries over " << conflation.keys << " keys (table full "
+                      << conflation.overflows << ")" << std::endl;
+        }
+        if (config->ttl.enabled) {
+            std::cout << "  Expired (TTL):      " << g_processor_manager->get_total_messages_expired()
+                      << " at processors, " << g_strategy_manager->get_total_messages_expired()
+                      << " at strategies" << std::endl;
+        }
+        if (const auto* dedup = g_stage2_router->get_dedup()) {
+            std::cout << "  Duplicates Dropped: " << dedup->get_duplicates() << " (too old "
+                      << dedup->get_too_old() << ", " << dedup->get_tracked_keys() << " / "
+                      << dedup->get_capacity() << " keys tracked, " << dedup->get_evictions()
+                      << " evicted)" << std::endl;
+        }
+        if (config->overflow.enabled) {
+            SpillStats spill;
+            g_producer_manager->collect_spill_stats(spill);
+            g_stage1_router->collect_spill_stats(spill);
+            g_processor_manager->collect_spill_stats(spill);
+            g_stage2_router->collect_spill_stats(spill);
+            std::cout << "  Spilled to Disk:    " << spill.messages_spilled << " (still spilled "
+                      << spill.pending << ", lost " << spill.messages_lost << ", peak edge backlog "
+                      << spill.peak_bytes / sizeof(Message) << " messages, " << spill.compactions
+                      << " compactions)" << std::endl;
+        }
+        if (capture) {
+            std::cout << "  Captured:           " << capture->get_records_written() << " records ("
+                      << capture->get_bytes_written() << " bytes)" << std::endl;
+        }
+        if (exporter) {
+            std::cout << "  Metrics Scrapes:    " << exporter->get_scrapes() << std::endl;
+        }
+        if (egress) {
+            const double nanos_per_tick = 1.0 / TscClock::ticks_per_nano();
+            const LatencyHistogram& egress_latency = egress->get_latency();
+            std::cout << "" << std::endl;
+            std::cout << "Egress:" << std::endl;
+            std::cout << "  Records Written:    " << egress->get_records_written() << " ("
+                      << egress->get_records_written() / config->duration_secs << " records/sec, "
+                      << egress->get_bytes_written() << " bytes)" << std::endl;
+            std::cout << "  Batches:            " << egress->get_batches_written() << " ("
+                      << egress->get_size_flushes() << " full, " << egress->get_deadline_flushes()
+                      << " on deadline)" << std::endl;
+            std::cout << "  Dropped:            " << g_strategy_manager->get_total_outputs_dropped()
+                      << " (write errors " << egress->get_write_errors() << ")" << std::endl;
+            std::cout << "  Latency (us):       p50: " << egress_latency.value_at_percentile(50.0) * nanos_per_tick / 1000.0
+                      << "  p99: " << egress_latency.value_at_percentile(99.0) * nanos_per_tick / 1000.0
+                      << "  max: " << egress_latency.max() * nanos_per_tick / 1000.0 << std::endl;
+        }
+        if (journal) {
+            const double nanos_per_tick = 1.0 / TscClock::ticks_per_nano();
+            const LatencyHistogram& commit_latency = journal->get_commit_latency();
+            std::cout << "" << std::endl;
+            std::cout << "Journal:" << std::endl;
+            std::cout << "  Records Journaled:  " << journal->get_records_written() << " ("
+                      << journal->get_segments_written() << " segment(s), " << journal->get_segments_deleted()
+                      << " deleted, " << journal->get_bytes_written() << " bytes)" << std::endl;
+            std::cout << "  Group Commits:      " << journal->get_commits() << " (failed "
+                      << journal->get_commit_failures() << ", " << journal->get_records_lost()
+                      << " records lost, dropped "
+                      << g_strategy_manager->get_total_journal_dropped() << ", sync withheld "
+                      << g_strategy_manager->get_total_sync_withheld() << ")" << std::endl;
+            std::cout << "  Commit Time (us):   p50: " << commit_latency.value_at_percentile(50.0) * nanos_per_tick / 1000.0
+                      << "  p99: " << commit_latency.value_at_percentile(99.0) * nanos_per_tick / 1000.0
+                      << "  max: " << commit_latency.max() * nanos_per_tick / 1000.0 << std::endl;
+        }
+        if (snapshots) {
+            const double nanos_per_tick = 1.0 / TscClock::ticks_per_nano();
+            const LatencyHistogram& snapshot_latency = snapshots->get_snapshot_latency();
+            std::cout << "" << std::endl;
+            std::cout << "Snapshots:" << std::endl;
+            std::cout << "  Written:            " << snapshots->get_snapshots_written() << " (abandoned "
+                      << snapshots->get_snapshots_abandoned() << ", failed " << snapshots->get_snapshots_failed()
+                      << ")" << std::endl;
+            std::cout << "  Last Snapshot:      epoch " << snapshots->get_last_epoch() << ", "
+                      << snapshots->get_last_bytes() << " bytes, " << snapshots->get_last_channel_records()
+                      << " in-flight message(s)" << std::endl;
+            std::cout << "  Cut Time (ms):      p50: " << snapshot_latency.value_at_percentile(50.0) * nanos_per_tick / 1e6
+                      << "  max: " << snapshot_latency.max() * nanos_per_tick / 1e6 << std::endl;
+        }
+        if (const auto* autoscaler = g_processor_manager->get_autoscaler()) {
+            std::cout << "" << std::endl;
+            std::cout << "Processor Autoscaling:" << std::endl;
+            std::cout << "  Peak Active Workers: " << autoscaler->get_peak_active_workers()
+                      << " / " << config->processors.count << std::endl;
+            std::cout << "  Scale Ups:          " << autoscaler->get_scale_ups() << std::endl;
+            std::cout << "  Scale Downs:        " << autoscaler->get_scale_downs() << std::endl;
+        }
+        
+        LatencyHistogram latency;
+        g_strategy_manager->collect_latency(latency);
+        const double nanos_per_tick = 1.0 / TscClock::ticks_per_nano();
+        std::cout << "" << std::endl;
+        std::cout << "End-to-end Latency (microseconds"
+                  << (config->producers.open_loop ? ", from intended send time" : "") << "):" << std::endl;
+        std::cout << "  p50: " << latency.value_at_percentile(50.0) * nanos_per_tick / 1000.0
+                  << "  p99: " << latency.value_at_percentile(99.0) * nanos_per_tick / 1000.0
+                  << "  p99.9: " << latency.value_at_percentile(99.9) * nanos_per_tick / 1000.0
+                  << "  max: " << latency.max() * nanos_per_tick / 1000.0 << std::endl;
+        if (hiccups) {
+            const LatencyHistogram& stalls = hiccups->get_stalls();
+            const uint64_t measured = hiccups->get_measured_ticks();
+            std::cout << "Platform Hiccups (microseconds, " << stalls.count() << " stalls over "
+                      << config->hiccups.threshold_ns << " ns, "
+                      << (measured > 0 ? 100.0 * hiccups->get_stalled_ticks() / measured : 0.0) << "% of the run):" << std::endl;
+            std::cout << "  p50: " << stalls.value_at_percentile(50.0) * nanos_per_tick / 1000.0
+                      << "  p99: " << stalls.value_at_percentile(99.0) * nanos_per_tick / 1000.0
+                      << "  p99.9: " << stalls.value_at_percentile(99.9) * nanos_per_tick / 1000.0
+                      << "  max: " << stalls.max() * nanos_per_tick / 1000.0 << std::endl;
+        }
+        if (config->producers.open_loop) {
+            std::cout << "  Sends Behind Schedule: " << g_producer_manager->get_total_sends_behind_schedule()
+                      << " (max lag " << g_producer_manager->get_max_schedule_lag_ns() / 1000.0 << " us)" << std::endl;
+        }
+        if (monitor) {
+            monitor->print_final_report();
+        }
+        if (hop_tracer) {
+            hop_tracer->print_report();
+        }
+        if (config->perf.enabled) {
+            PerfRegistry::instance().print_report();
+        }
+        
+        std::vector<MetricsSnapshot> threads;
+        MetricsRegistry::instance().snapshot(threads);
+        const uint64_t ordering_violations = g_strategy_manager->get_total_ordering_violations();
         std::cout << "" << std::endl;
         std::cout << "Ordering Validation:" << std::endl;
-        std::cout << "  Producer 0: " << (g_producer_manager->get_total_messages_produced() / 4) << " messages - IN ORDER ✓" << std::endl;
-        std::cout << "  Producer 1: " << (g_producer_manager->get_total_messages_produced() / 4) << " messages - IN ORDER ✓" << std::endl;
-        std::cout << "  Producer 2: " << (g_producer_manager->get_total_messages_produced() / 4) << " messages - IN ORDER ✓" << std::endl;
-        std::cout << "  Producer 3: " << (g_producer_manager->get_total_messages_produced() / 4) << " messages - IN ORDER ✓" << std::endl;
+        for (const auto& thread : threads) {
+            if (thread.thread.starts_with("producer-")) {
+                std::cout << "  Producer " << thread.thread.substr(9) << ": " << thread[Metric::MessagesProduced]
+                          << " messages" << std::endl;
+            }
+        }
+        std::cout << "  Violations:         " << ordering_violations << std::endl;
         std::cout << "" << std::endl;
-        std::cout << "Test Result: " << ((g_stage1_router->get_routing_errors() + g_stage2_router->get_routing_errors() == 0) ? "PASSED" : "FAILED") << std::endl;
+        std::cout << "Test Result: " << ((g_stage1_router->get_routing_errors() + g_stage2_router->get_routing_errors() == 0 &&
+                                          ordering_violations == 0) ? "PASSED" : "FAILED") << std::endl;
+        
+        // The rings go away with their components
+        if (config->trace.enabled && config->trace.dump_on_exit) {
+            std::cout << "" << std::endl;
+            dump_trace(config->trace);
+        }
         
         
         delete g_strategy_manager;
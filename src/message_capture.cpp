@@ -0,0 +1,241 @@
+#include "../include/message_capture.h"
+#include "../include/tsc_clock.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+namespace {
+
+// Producers above this id are sequence-encoded against 0 instead of their
+// previous sequence, keeping the per-producer table bounded
+constexpr size_t kMaxTrackedProducers = size_t(1) << 20;
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline uint8_t* put_varint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+inline const uint8_t* get_varint(const uint8_t* in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+inline SequenceNumber& tracked_sequence(std::vector<SequenceNumber>& table, ProducerId producer_id,
+                                        SequenceNumber& scratch) {
+    if (producer_id >= kMaxTrackedProducers) {
+        scratch = 0;
+        return scratch;
+    }
+    if (producer_id >= table.size()) {
+        table.resize(producer_id + 1, 0);
+    }
+    return table[producer_id];
+}
+
+} // namespace
+
+MessageCaptureWriter::MessageCaptureWriter(const std::string& path)
+    : path_(path)
+    , fd_(-1)
+    , data_(nullptr)
+    , mapped_bytes_(0)
+    , write_pos_(sizeof(CaptureFileHeader))
+    , record_count_(0)
+    , first_timestamp_(0)
+    , last_timestamp_(0) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open capture file " + path + ": " + std::strerror(errno));
+    }
+    grow();
+}
+
+MessageCaptureWriter::~MessageCaptureWriter() {
+    close();
+}
+
+void MessageCaptureWriter::grow() {
+    size_t new_size = mapped_bytes_ + kGrowBytes;
+    if (::ftruncate(fd_, static_cast<off_t>(new_size)) != 0) {
+        throw std::runtime_error("Cannot extend capture file " + path_ + ": " + std::strerror(errno));
+    }
+
+    void* mapping = data_
+        ? ::mremap(data_, mapped_bytes_, new_size, MREMAP_MAYMOVE)
+        : ::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map capture file " + path_ + ": " + std::strerror(errno));
+    }
+    data_ = static_cast<uint8_t*>(mapping);
+    mapped_bytes_ = new_size;
+}
+
+void MessageCaptureWriter::encode(const Message& message) {
+    if (record_count_ == 0) {
+        first_timestamp_ = message.timestamp;
+        last_timestamp_ = message.timestamp;
+    }
+
+    SequenceNumber scratch;
+    SequenceNumber& last_sequence = tracked_sequence(last_sequence_, message.producer_id, scratch);
+
+    uint8_t* out = data_ + write_pos_;
+    out = put_varint(out, zigzag(static_cast<int64_t>(message.timestamp - last_timestamp_)));
+    *out++ = message.msg_type;
+    out = put_varint(out, message.producer_id);
+    out = put_varint(out, zigzag(static_cast<int64_t>(message.sequence_number - (last_sequence + 1))));
+    out = put_varint(out, message.processor_id);
+    out = put_varint(out, message.processing_timestamp == 0
+        ? 0 : zigzag(static_cast<int64_t>(message.processing_timestamp - message.timestamp)) + 1);
+
+    write_pos_ = static_cast<size_t>(out - data_);
+    last_timestamp_ = message.timestamp;
+    last_sequence = message.sequence_number;
+    ++record_count_;
+}
+
+void MessageCaptureWriter::close() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    CaptureFileHeader header{};
+    header.magic = CaptureFileHeader::kMagic;
+    header.version = CaptureFileHeader::kVersion;
+    header.record_count = record_count_;
+    header.data_bytes = write_pos_ - sizeof(CaptureFileHeader);
+    header.first_timestamp = first_timestamp_;
+    header.nanos_per_tick = 1.0 / TscClock::ticks_per_nano();
+    std::memcpy(data_, &header, sizeof(header));
+
+    ::msync(data_, write_pos_, MS_SYNC);
+    ::munmap(data_, mapped_bytes_);
+    if (::ftruncate(fd_, static_cast<off_t>(write_pos_)) != 0) {
+        // Leave the zero padding in place; readers stop at data_bytes anyway
+    }
+    ::close(fd_);
+
+    fd_ = -1;
+    data_ = nullptr;
+    mapped_bytes_ = 0;
+}
+
+MessageCaptureReader::MessageCaptureReader(const std::string& path)
+    : fd_(-1)
+    , data_(nullptr)
+    , mapped_bytes_(0)
+    , header_(nullptr)
+    , cursor_(nullptr)
+    , end_(nullptr)
+    , records_read_(0)
+    , last_timestamp_(0) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open capture file " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CaptureFileHeader)) {
+        ::close(fd_);
+        throw std::runtime_error("Capture file too small: " + path);
+    }
+    mapped_bytes_ = static_cast<size_t>(st.st_size);
+
+    void* mapping = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("Cannot map capture file " + path + ": " + std::strerror(errno));
+    }
+    ::madvise(mapping, mapped_bytes_, MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t*>(mapping);
+    header_ = reinterpret_cast<const CaptureFileHeader*>(data_);
+
+    if (header_->magic != CaptureFileHeader::kMagic || header_->version != CaptureFileHeader::kVersion ||
+        sizeof(CaptureFileHeader) + header_->data_bytes > mapped_bytes_) {
+        ::munmap(mapping, mapped_bytes_);
+        ::close(fd_);
+        throw std::runtime_error("Not a valid capture file: " + path);
+    }
+    rewind();
+}
+
+MessageCaptureReader::~MessageCaptureReader() {
+    if (data_) {
+        ::munmap(const_cast<uint8_t*>(data_), mapped_bytes_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void MessageCaptureReader::rewind() {
+    cursor_ = data_ + sizeof(CaptureFileHeader);
+    end_ = cursor_ + header_->data_bytes;
+    records_read_ = 0;
+    last_timestamp_ = header_->first_timestamp;
+    last_sequence_.clear();
+}
+
+bool MessageCaptureReader::next(Message& message) {
+    if (records_read_ >= header_->record_count || cursor_ >= end_) {
+        return false;
+    }
+
+    const uint8_t* in = cursor_;
+    uint64_t timestamp_delta, producer_id, sequence_delta, processor_id, processing_delta;
+
+    if (!(in = get_varint(in, end_, timestamp_delta)) || in >= end_) {
+        return false;
+    }
+    MessageType msg_type = *in++;
+    if (!(in = get_varint(in, end_, producer_id)) ||
+        !(in = get_varint(in, end_, sequence_delta)) ||
+        !(in = get_varint(in, end_, processor_id)) ||
+        !(in = get_varint(in, end_, processing_delta))) {
+        return false;
+    }
+
+    SequenceNumber scratch;
+    SequenceNumber& last_sequence = tracked_sequence(last_sequence_, static_cast<ProducerId>(producer_id), scratch);
+
+    message.msg_type = msg_type;
+    message.producer_id = static_cast<ProducerId>(producer_id);
+    message.timestamp = last_timestamp_ + static_cast<uint64_t>(unzigzag(timestamp_delta));
+    message.sequence_number = last_sequence + 1 + static_cast<uint64_t>(unzigzag(sequence_delta));
+    message.processor_id = static_cast<ProcessorId>(processor_id);
+    message.processing_timestamp = processing_delta == 0
+        ? 0 : message.timestamp + static_cast<uint64_t>(unzigzag(processing_delta - 1));
+
+    last_timestamp_ = message.timestamp;
+    last_sequence = message.sequence_number;
+    cursor_ = in;
+    ++records_read_;
+    return true;
+}
+
+} // namespace MessageRouter
@@ -0,0 +1,247 @@
+#include "../include/metrics_exporter.h"
+#include "../include/latency_histogram.h"
+#include "../include/tsc_clock.h"
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+namespace {
+
+const char* metric_help(Metric metric) {
+    switch (metric) {
+        case Metric::MessagesProduced: return "Messages sent by producers";
+        case Metric::MessagesRouted: return "Messages handed to the next stage by a router";
+        case Metric::RoutingErrors: return "Messages a router dropped: no route or the queue stayed full";
+        case Metric::MessagesProcessed: return "Messages forwarded by processors";
+        case Metric::MessagesDelivered: return "Messages delivered to strategies";
+        case Metric::OrderingViolations: return "Messages a strategy saw behind a later one of the same producer and type";
+        case Metric::MessagesExpired: return "Messages dropped past their time-to-live";
+        case Metric::OutputsDropped: return "Strategy outputs dropped because the egress queue stayed full";
+        case Metric::JournalDropped: return "Journal records dropped because the journal queue stayed full";
+        case Metric::SyncWithheld: return "Sync-journaled outputs withheld because the journal never confirmed their record";
+        case Metric::PayloadMismatches: return "Message bodies that failed their content check on delivery";
+        case Metric::SendsBehindSchedule: return "Open-loop sends later than the schedule lag tolerance";
+        case Metric::InlinePayloads: return "Message bodies small enough to travel inline";
+        default: return "";
+    }
+}
+
+// Whether threads of stage ever write metric; other series would always read 0
+bool stage_writes(const std::string& stage, Metric metric) {
+    switch (metric) {
+        case Metric::MessagesProduced: return stage == "producer" || stage == "replay";
+        case Metric::MessagesRouted:
+        case Metric::RoutingErrors: return stage == "stage1" || stage == "stage2";
+        case Metric::MessagesProcessed: return stage == "processor";
+        case Metric::MessagesDelivered:
+        case Metric::OrderingViolations:
+        case Metric::OutputsDropped:
+        case Metric::JournalDropped:
+        case Metric::SyncWithheld:
+        case Metric::PayloadMismatches: return stage == "strategy";
+        case Metric::MessagesExpired: return stage == "processor" || stage == "strategy";
+        case Metric::SendsBehindSchedule:
+        case Metric::InlinePayloads: return stage == "producer";
+        default: return false;
+    }
+}
+
+// Latency bucket bounds in seconds, 1 us .. 1 s
+constexpr double kLatencyBounds[] = {
+    1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4,
+    1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 1e-1, 2.5e-1, 5e-1, 1.0
+};
+
+} // namespace
+
+MetricsExporter::MetricsExporter(const SystemConfig* config, std::vector<Monitor::QueueGroup> queue_groups,
+                                 const StrategyManager* strategies)
+    : queue_groups_(std::move(queue_groups))
+    , strategies_(strategies)
+    , listen_fd_(-1)
+    , port_(0)
+    , running_(false)
+    , scrapes_(0) {
+    const auto& http = config->metrics_http;
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error(std::string("metrics_http socket failed: ") + std::strerror(errno));
+    }
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(http.port));
+    if (::inet_pton(AF_INET, http.bind_address.c_str(), &addr.sin_addr) != 1) {
+        ::close(listen_fd_);
+        throw std::runtime_error("metrics_http bind_address is not an IPv4 address: " + http.bind_address);
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, 16) != 0) {
+        int err = errno;
+        ::close(listen_fd_);
+        throw std::runtime_error("metrics_http bind to " + http.bind_address + ":" + std::to_string(http.port) +
+                                 " failed: " + std::strerror(err));
+    }
+
+    socklen_t len = sizeof(addr);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+    }
+}
+
+void MetricsExporter::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    server_thread_ = std::make_unique<std::thread>(&MetricsExporter::serve_loop, this);
+}
+
+void MetricsExporter::stop() {
+    running_.store(false);
+    if (server_thread_ && server_thread_->joinable()) {
+        server_thread_->join();
+    }
+}
+
+void MetricsExporter::serve_loop() {
+    while (running_.load()) {
+        // Wake up regularly to notice stop()
+        pollfd listener{listen_fd_, POLLIN, 0};
+        if (::poll(&listener, 1, 100) <= 0) {
+            continue;
+        }
+        int client_fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            continue;
+        }
+        serve(client_fd);
+        ::close(client_fd);
+    }
+}
+
+void MetricsExporter::serve(int client_fd) {
+    // A stuck client must not hold the endpoint
+    timeval timeout{1, 0};
+    ::setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t received = ::recv(client_fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    std::string status = "200 OK";
+    std::string content_type = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    std::string body;
+    if (request.starts_with("GET /metrics ") || request.starts_with("GET /metrics?")) {
+        body = render();
+        scrapes_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        status = "404 Not Found";
+        content_type = "text/plain; charset=utf-8";
+        body = "GET /metrics\n";
+    }
+
+    const std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type +
+                                 "\r\nContent-Length: " + std::to_string(body.size()) +
+                                 "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t written = ::send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(written);
+    }
+}
+
+std::string MetricsExporter::render() const {
+    std::ostringstream out;
+
+    // Counters per thread, labelled with the stage the thread belongs to;
+    // per-stage throughput is their rate summed by stage
+    std::vector<MetricsSnapshot> threads;
+    MetricsRegistry::instance().snapshot(threads);
+    for (size_t i = 0; i < kMetricCount; ++i) {
+        const Metric metric = static_cast<Metric>(i);
+        const std::string family = std::string("router_") + metric_name(metric);
+        out << "# TYPE " << family << " counter\n";
+        out << "# HELP " << family << " " << metric_help(metric) << "\n";
+        for (const auto& thread : threads) {
+            const std::string stage = thread.thread.substr(0, thread.thread.find('-'));
+            if (stage_writes(stage, metric)) {
+                out << family << "_total{stage=\"" << stage << "\",thread=\"" << thread.thread << "\"} "
+                    << thread[metric] << "\n";
+            }
+        }
+    }
+
+    out << "# TYPE router_queue_depth gauge\n";
+    out << "# HELP router_queue_depth Messages waiting in a queue\n";
+    for (const auto& group : queue_groups_) {
+        for (size_t i = 0; i < group.queues.size(); ++i) {
+            out << "router_queue_depth{edge=\"" << group.name << "\",queue=\"" << i << "\"} "
+                << group.queues[i]->size() << "\n";
+        }
+    }
+
+    // Re-bucket the log-linear histogram onto fixed bounds; a source bucket
+    // counts toward the first bound its upper edge fits under
+    LatencyHistogram latency;
+    strategies_->collect_latency(latency);
+    constexpr size_t kBounds = sizeof(kLatencyBounds) / sizeof(kLatencyBounds[0]);
+    uint64_t bound_ticks[kBounds];
+    for (size_t b = 0; b < kBounds; ++b) {
+        bound_ticks[b] = TscClock::nanos_to_ticks(static_cast<uint64_t>(kLatencyBounds[b] * 1e9));
+    }
+    uint64_t cumulative[kBounds] = {};
+    uint64_t total = 0;
+    for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+        const uint64_t count = latency.bucket_count(i);
+        if (count == 0) {
+            continue;
+        }
+        total += count;
+        const uint64_t upper = LatencyHistogram::bucket_upper_bound(i);
+        for (size_t b = 0; b < kBounds; ++b) {
+            if (upper <= bound_ticks[b]) {
+                cumulative[b] += count;
+            }
+        }
+    }
+    out << "# TYPE router_end_to_end_latency_seconds histogram\n";
+    out << "# HELP router_end_to_end_latency_seconds Producer send to strategy delivery\n";
+    for (size_t b = 0; b < kBounds; ++b) {
+        out << "router_end_to_end_latency_seconds_bucket{le=\"" << kLatencyBounds[b] << "\"} " << cumulative[b] << "\n";
+    }
+    out << "router_end_to_end_latency_seconds_bucket{le=\"+Inf\"} " << total << "\n";
+    out << "router_end_to_end_latency_seconds_count " << total << "\n";
+    out << "# EOF\n";
+    return out.str();
+}
+
+} // namespace MessageRouter
\ No newline at end of file
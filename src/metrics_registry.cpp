@@ -0,0 +1,82 @@
+#include "../include/metrics_registry.h"
+#include <algorithm>
+#include <immintrin.h>
+
+namespace MessageRouter {
+
+const char* metric_name(Metric metric) {
+    switch (metric) {
+        case Metric::MessagesProduced: return "messages_produced";
+        case Metric::MessagesRouted: return "messages_routed";
+        case Metric::RoutingErrors: return "routing_errors";
+        case Metric::MessagesProcessed: return "messages_processed";
+        case Metric::MessagesDelivered: return "messages_delivered";
+        case Metric::OrderingViolations: return "ordering_violations";
+        case Metric::MessagesExpired: return "messages_expired";
+        case Metric::OutputsDropped: return "outputs_dropped";
+        case Metric::JournalDropped: return "journal_dropped";
+        case Metric::SyncWithheld: return "sync_withheld";
+        case Metric::PayloadMismatches: return "payload_mismatches";
+        case Metric::SendsBehindSchedule: return "sends_behind_schedule";
+        case Metric::InlinePayloads: return "inline_payloads";
+        default: return "unknown";
+    }
+}
+
+std::array<uint64_t, kMetricCount> MetricsBlock::snapshot() const {
+    std::array<uint64_t, kMetricCount> values;
+    while (true) {
+        const uint32_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            _mm_pause();
+            continue;
+        }
+        for (size_t i = 0; i < kMetricCount; ++i) {
+            values[i] = values_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) == before) {
+            return values;
+        }
+    }
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsBlock* MetricsRegistry::register_thread(std::string thread) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back(Entry{std::move(thread), std::make_unique<MetricsBlock>()});
+    return entries_.back().block.get();
+}
+
+void MetricsRegistry::unregister_thread(const MetricsBlock* block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [block](const Entry& entry) { return entry.block.get() == block; }),
+                   entries_.end());
+}
+
+void MetricsRegistry::snapshot(std::vector<MetricsSnapshot>& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.reserve(out.size() + entries_.size());
+    for (const auto& entry : entries_) {
+        out.push_back(MetricsSnapshot{entry.thread, entry.block->snapshot()});
+    }
+}
+
+MetricsSnapshot MetricsRegistry::total() const {
+    MetricsSnapshot total{"total", {}};
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : entries_) {
+        const auto values = entry.block->snapshot();
+        for (size_t i = 0; i < kMetricCount; ++i) {
+            total.values[i] += values[i];
+        }
+    }
+    return total;
+}
+
+} // namespace MessageRouter
\ No newline at end of file
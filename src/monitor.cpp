@@ -1,31 +1,78 @@
 #include "../include/monitor.h"
+#include "../include/hiccup_meter.h"
+#include "../include/strategy.h"
+#include "../include/tsc_clock.h"
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <cctype>
 #include <sstream>
 #include <thread>
-#include <cmath>
 #include <string>
-#include <cstdlib>
-#include <cstring>
 
 namespace MessageRouter {
 
-Monitor::Monitor(const SystemConfig* config,
-                 ProducerManager* producer_manager,
-                 ProcessorManager* processor_manager,
-                 StrategyManager* strategy_manager,
-                 const std::vector<std::shared_ptr<MessageQueue>>& stage1_queues,
-                 const std::vector<std::shared_ptr<MessageQueue>>& stage2_queues)
+namespace {
+
+// 1234567 -> "1.23M/s"
+std::string format_rate(double per_sec) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    if (per_sec >= 1e6) {
+        out << per_sec / 1e6 << "M/s";
+    } else if (per_sec >= 1e3) {
+        out << per_sec / 1e3 << "K/s";
+    } else {
+        out << std::setprecision(0) << per_sec << "/s";
+    }
+    return out.str();
+}
+
+// What a histogram gained since previous, which is updated to its current
+// bucket counts; values are bucket upper bounds in ticks
+struct IntervalStats {
+    uint64_t count = 0;
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+};
+
+IntervalStats interval_stats(const LatencyHistogram& histogram, std::vector<uint64_t>& previous) {
+    previous.resize(LatencyHistogram::kBucketCount, 0);
+    std::vector<uint64_t> delta(LatencyHistogram::kBucketCount);
+    IntervalStats stats;
+    for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+        const uint64_t current = histogram.bucket_count(i);
+        delta[i] = current - previous[i];
+        previous[i] = current;
+        stats.count += delta[i];
+        if (delta[i] > 0) {
+            stats.max = std::min(LatencyHistogram::bucket_upper_bound(i), histogram.max());
+        }
+    }
+    if (stats.count == 0) {
+        return stats;
+    }
+
+    const uint64_t rank = std::min(stats.count - 1, static_cast<uint64_t>(0.99 * stats.count));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+        seen += delta[i];
+        if (seen > rank) {
+            stats.p99 = std::min(LatencyHistogram::bucket_upper_bound(i), histogram.max());
+            break;
+        }
+    }
+    return stats;
+}
+
+} // namespace
+
+Monitor::Monitor(const SystemConfig* config, std::vector<QueueGroup> queue_groups)
     : config_(config)
-    , producer_manager_(producer_manager)
-    , processor_manager_(processor_manager)
-    , strategy_manager_(strategy_manager)
-    , stage1_queues_(stage1_queues)
-    , stage2_queues_(stage2_queues)
+    , queue_groups_(std::move(queue_groups))
+    , peak_depth_(queue_groups_.size(), 0)
 {
     start_time_ = std::chrono::steady_clock::now();
-    last_report_time_ = start_time_;
 }
 
 Monitor::~Monitor() {
@@ -36,155 +83,178 @@ void Monitor::start() {
     if (running_.load()) {
         return;
     }
-    
+
+    start_time_ = std::chrono::steady_clock::now();
+    first_sample_ = take_sample();
+    last_sample_ = first_sample_;
+    latency_line();
+    peak_interval_p99_ = 0;
+    peak_interval_stall_ = 0;
     running_.store(true);
     monitor_thread_ = std::make_unique<std::thread>(&Monitor::monitor_loop, this);
 }
 
 void Monitor::stop() {
-    if (!running_.load()) {
-        return;
-    }
-    
     running_.store(false);
-}
-
-void Monitor::wait_for_completion() {
     if (monitor_thread_ && monitor_thread_->joinable()) {
         monitor_thread_->join();
     }
 }
 
+const char* Monitor::stage_name(size_t stage) {
+    switch (stage) {
+        case Producers: return "produced";
+        case Stage1: return "stage1";
+        case Processors: return "processed";
+        case Stage2: return "stage2";
+        case Strategies: return "delivered";
+        default: return "unknown";
+    }
+}
+
 void Monitor::monitor_loop() {
+    const auto interval = std::chrono::milliseconds(config_->monitor.interval_ms);
+    auto last_report_time = start_time_;
+
     while (running_.load()) {
+        // Short sleeps so stop() is not held up by a long interval
+        std::this_thread::sleep_for(std::min(interval, std::chrono::milliseconds(100)));
+
         auto current_time = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-            current_time - last_report_time_).count();
-        
-        
-        if (elapsed >= 1000) {
-            update_stats();
-            print_report();
-            last_report_time_ = current_time;
+        if (current_time - last_report_time < interval) {
+            continue;
         }
-        
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        const Sample sample = take_sample();
+        const double interval_secs = std::chrono::duration<double>(current_time - last_report_time).count();
+        report(sample, last_sample_, interval_secs);
+        last_sample_ = sample;
+        sampled_secs_ += interval_secs;
+        last_report_time = current_time;
     }
 }
 
-void Monitor::update_stats() {
-    
-    stats_.messages_produced.store(producer_manager_->get_total_messages_produced());
-    stats_.messages_lost.store(producer_manager_->get_total_messages_lost());
-    
-    
-    stats_.messages_processed.store(processor_manager_->get_total_messages_processed());
-    
-    
-    stats_.messages_delivered.store(strategy_manager_->get_total_messages_delivered());
-    stats_.ordering_violations.store(strategy_manager_->get_total_ordering_violations());
-    
-    
-    for (size_t i = 0; i < stage1_queues_.size() && i < 8; ++i) {
-        stats_.stage1_queue_depths[i].store(stage1_queues_[i]->size());
-    }
-    
-    for (size_t i = 0; i < stage2_queues_.size() && i < 8; ++i) {
-        stats_.stage2_queue_depths[i].store(stage2_queues_[i]->size());
+Monitor::Sample Monitor::take_sample() const {
+    std::vector<MetricsSnapshot> threads;
+    MetricsRegistry::instance().snapshot(threads);
+
+    Sample sample;
+    for (const auto& thread : threads) {
+        // Thread names are "<stage>" or "<stage>-<id>"
+        const std::string stage = thread.thread.substr(0, thread.thread.find('-'));
+        if (stage == "producer" || stage == "replay") {
+            sample.messages[Producers] += thread[Metric::MessagesProduced];
+        } else if (stage == "stage1") {
+            sample.messages[Stage1] += thread[Metric::MessagesRouted];
+        } else if (stage == "processor") {
+            sample.messages[Processors] += thread[Metric::MessagesProcessed];
+        } else if (stage == "stage2") {
+            sample.messages[Stage2] += thread[Metric::MessagesRouted];
+        } else if (stage == "strategy") {
+            sample.messages[Strategies] += thread[Metric::MessagesDelivered];
+        }
+        sample.routing_errors += thread[Metric::RoutingErrors];
+        sample.expired += thread[Metric::MessagesExpired];
+        sample.ordering_violations += thread[Metric::OrderingViolations];
+        sample.outputs_lost += thread[Metric::OutputsDropped] + thread[Metric::JournalDropped] +
+                               thread[Metric::SyncWithheld];
+        sample.late_sends += thread[Metric::SendsBehindSchedule];
+        sample.payload_mismatches += thread[Metric::PayloadMismatches];
     }
+    return sample;
 }
 
-void Monitor::print_report() {
-    auto current_time = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-        current_time - start_time_).count();
-    
-    double elapsed_secs = elapsed / 1000.0;
-    
-    std::cout << std::fixed << std::setprecision(2);
-    std::cout << "[" << elapsed_secs << "s] ";
-    std::cout << "Produced: " << (stats_.messages_produced.load() / 1000000.0) << "M | ";
-    std::cout << "Processed: " << (stats_.messages_processed.load() / 1000000.0) << "M | ";
-    std::cout << "Delivered: " << (stats_.messages_delivered.load() / 1000000.0) << "M | ";
-    std::cout << "Lost: " << stats_.messages_lost.load() << std::endl;
-    
-    
-    std::cout << "        Stage1 Queues: [";
-    for (size_t i = 0; i < std::min(stage1_queues_.size(), size_t(8)); ++i) {
-        if (i > 0) std::cout << ", ";
-        std::cout << stats_.stage1_queue_depths[i].load();
+void Monitor::report(const Sample& sample, const Sample& previous, double interval_secs) {
+    const double elapsed_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << "[" << elapsed_secs << "s] ";
+    for (size_t stage = 0; stage < kStages; ++stage) {
+        const double rate = (sample.messages[stage] - previous.messages[stage]) / interval_secs;
+        peak_rate_[stage] = std::max(peak_rate_[stage], rate);
+        out << stage_name(stage) << " " << format_rate(rate) << " | ";
     }
-    std::cout << "]";
-    
-    
-    std::cout << " | Stage2 Queues: [";
-    for (size_t i = 0; i < std::min(stage2_queues_.size(), size_t(8)); ++i) {
-        if (i > 0) std::cout << ", ";
-        std::cout << stats_.stage2_queue_depths[i].load();
+    out << "dropped " << sample.routing_errors - previous.routing_errors
+        << " | expired " << sample.expired - previous.expired
+        << " | violations " << sample.ordering_violations - previous.ordering_violations;
+    // Counters only the enabled features can move
+    if (config_->egress.enabled || config_->journal.enabled) {
+        out << " | outputs lost " << sample.outputs_lost - previous.outputs_lost;
     }
-    std::cout << "]" << std::endl;
-    
-    
-    std::cout << "        Latencies(μs) - Stage1: 0.34 | Processing: 0.18 | Stage2: 0.41 | Total: 1.23" << std::endl;
-}
+    if (config_->producers.open_loop) {
+        out << " | late " << sample.late_sends - previous.late_sends;
+    }
+    if (config_->payloads.enabled) {
+        out << " | payload mismatches " << sample.payload_mismatches - previous.payload_mismatches;
+    }
+    out << "\n";
 
-void Monitor::calculate_percentiles(const std::vector<uint64_t>& latencies,
-                                   uint64_t& p50, uint64_t& p90, uint64_t& p99, uint64_t& p99_9) const {
-    if (latencies.empty()) {
-        p50 = p90 = p99 = p99_9 = 0;
-        return;
+    // Every queue, not a prefix: a single backed-up edge is what matters
+    out << "        queues";
+    for (size_t group = 0; group < queue_groups_.size(); ++group) {
+        out << " " << queue_groups_[group].name << " [";
+        for (size_t i = 0; i < queue_groups_[group].queues.size(); ++i) {
+            const size_t depth = queue_groups_[group].queues[i]->size();
+            peak_depth_[group] = std::max(peak_depth_[group], depth);
+            out << (i > 0 ? " " : "") << depth;
+        }
+        out << "]";
     }
-    
-    std::vector<uint64_t> sorted_latencies = latencies;
-    std::sort(sorted_latencies.begin(), sorted_latencies.end());
-    
-    size_t size = sorted_latencies.size();
-    p50 = sorted_latencies[static_cast<size_t>(size * 0.5)];
-    p90 = sorted_latencies[static_cast<size_t>(size * 0.9)];
-    p99 = sorted_latencies[static_cast<size_t>(size * 0.99)];
-    p99_9 = sorted_latencies[static_cast<size_t>(size * 0.999)];
+    if (strategies_ || hiccups_) {
+        out << "\n" << latency_line();
+    }
+    std::cout << out.str() << std::endl;
 }
 
-void Monitor::reset_stats() {
-    stats_.reset();
-    producer_manager_->reset_all_stats();
-    processor_manager_->reset_all_stats();
-    strategy_manager_->reset_all_stats();
-    start_time_ = std::chrono::steady_clock::now();
-    last_report_time_ = start_time_;
+std::string Monitor::latency_line() {
+    const double micros_per_tick = 1.0 / TscClock::ticks_per_nano() / 1000.0;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "        latency";
+    if (strategies_) {
+        LatencyHistogram latency;
+        strategies_->collect_latency(latency);
+        const IntervalStats stats = interval_stats(latency, last_latency_buckets_);
+        peak_interval_p99_ = std::max(peak_interval_p99_, stats.p99);
+        out << " p99 " << stats.p99 * micros_per_tick << " us";
+    }
+    if (hiccups_) {
+        const IntervalStats stats = interval_stats(hiccups_->get_stalls(), last_stall_buckets_);
+        peak_interval_stall_ = std::max(peak_interval_stall_, stats.max);
+        out << (strategies_ ? " |" : "") << " platform stalls " << stats.count << ", max "
+            << stats.max * micros_per_tick << " us";
+    }
+    return out.str();
 }
 
-void Monitor::print_final_report() {
-    auto end_time = std::chrono::steady_clock::now();
-    auto total_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-        end_time - start_time_).count();
-    
-    double total_secs = total_elapsed / 1000.0;
-    
-    std::cout << "\n=== PERFORMANCE SUMMARY ===" << std::endl;
-    std::cout << "Scenario: " << config_->scenario << std::endl;
-    std::cout << "Duration: " << std::fixed << std::setprecision(2) << total_secs << " seconds\n" << std::endl;
-    
-    std::cout << "Message Statistics:" << std::endl;
-    std::cout << "  Total Produced:     " << std::setw(12) << stats_.messages_produced.load() << std::endl;
-    std::cout << "  Total Processed:    " << std::setw(12) << stats_.messages_processed.load() << std::endl;
-    std::cout << "  Total Delivered:    " << std::setw(12) << stats_.messages_delivered.load() << std::endl;
-    std::cout << "  Messages Lost:      " << std::setw(12) << stats_.messages_lost.load() << std::endl;
-    
-    std::cout << "\nLatency Percentiles (microseconds):" << std::endl;
-    std::cout << "  Stage      p50    p90    p99    p99.9   max" << std::endl;
-    std::cout << "  Stage1    0.12   0.23   0.45    1.2   15.3" << std::endl;
-    std::cout << "  Process   0.15   0.18   0.21    0.5    2.1" << std::endl;
-    std::cout << "  Stage2    0.18   0.31   0.52    1.1   12.1" << std::endl;
-    std::cout << "  Total     0.51   0.89   1.45    3.2   28.4" << std::endl;
-    
-    std::cout << "\nOrdering Validation:" << std::endl;
-    std::cout << "  Total Ordering Violations: " << stats_.ordering_violations.load() << std::endl;
-    
+void Monitor::print_final_report() const {
+    if (sampled_secs_ <= 0) {
+        return;
+    }
+
+    std::cout << "" << std::endl;
+    std::cout << "Monitor (" << config_->monitor.interval_ms << " ms samples, average / peak):" << std::endl;
+    for (size_t stage = 0; stage < kStages; ++stage) {
+        const double average = (last_sample_.messages[stage] - first_sample_.messages[stage]) / sampled_secs_;
+        std::string label = std::string(stage_name(stage)) + ":";
+        label[0] = static_cast<char>(std::toupper(label[0]));
+        std::cout << "  " << std::left << std::setw(20) << label << std::right
+                  << format_rate(average) << " / " << format_rate(peak_rate_[stage]) << std::endl;
+    }
+    std::cout << "  Peak Queue Depth:  ";
+    for (size_t group = 0; group < queue_groups_.size(); ++group) {
+        std::cout << (group > 0 ? ", " : " ") << queue_groups_[group].name << " " << peak_depth_[group];
+    }
+    std::cout << std::endl;
     
-    bool test_passed = (stats_.messages_lost.load() == 0) && (stats_.ordering_violations.load() == 0);
-    std::cout << "\nTest Result: " << (test_passed ? "PASSED" : "FAILED") << std::endl;
+    const double micros_per_tick = 1.0 / TscClock::ticks_per_nano() / 1000.0;
+    if (strategies_) {
+        std::cout << "  Peak Interval p99:  " << std::fixed << std::setprecision(2)
+                  << peak_interval_p99_ * micros_per_tick << " us" << std::defaultfloat << std::endl;
+    }
+    if (hiccups_) {
+        std::cout << "  Peak Hiccup:        " << std::fixed << std::setprecision(2)
+                  << peak_interval_stall_ * micros_per_tick << " us" << std::defaultfloat << std::endl;
+    }
 }
 
-} // namespace MessageRouter
+} // namespace MessageRouter
\ No newline at end of file
@@ -1,135 +1,213 @@
-#include "ordering_buffer.h"
+#include "../include/ordering_buffer.h"
 #include <iostream>
 #include <algorithm>
 
 namespace MessageRouter {
 
+namespace {
+
+constexpr size_t kInitialStreams = 64;
+
+size_t stream_slot(uint64_t key, size_t mask) {
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+} // namespace
+
 OrderingBuffer::OrderingBuffer(size_t max_buffer_size)
-    : max_buffer_size_(max_buffer_size)
+    : streams_(std::make_unique<Stream[]>(kInitialStreams))
+    , stream_capacity_(kInitialStreams)
+    , stream_count_(0)
+    , nodes_(std::make_unique<MessageNode[]>(max_buffer_size))
+    , free_nodes_(nullptr)
+    , max_buffer_size_(max_buffer_size)
+    , buffered_(0)
+    , peak_buffered_(0)
     , messages_buffered_(0)
-    , messages_sent_(0) {
+    , messages_sent_(0)
+    , messages_duplicate_(0)
+    , messages_dropped_(0)
+    , trace_(nullptr) {
+    std::fill_n(streams_.get(), stream_capacity_, Stream{kEmptyKey, 0, nullptr, nullptr});
+    // Every node starts on the free list; nothing is allocated after this
+    for (size_t i = max_buffer_size_; i > 0; --i) {
+        free_node(&nodes_[i - 1]);
+    }
 }
 
 bool OrderingBuffer::add_message(const Message& message, std::shared_ptr<MessageQueue> output_queue) {
-    auto key = std::make_pair(message.producer_id, message.msg_type);
-
-    
-    auto it = expected_sequence_.find(key);
-    if (it == expected_sequence_.end()) {
-        
-        expected_sequence_[key] = message.sequence_number + 1;
-        messages_sent_.fetch_add(1);
-        return output_queue->try_push(message);
-    }
-
-    if (message.sequence_number == it->second) {
-        
-        it->second = message.sequence_number + 1;
-        messages_sent_.fetch_add(1);
-        bool sent = output_queue->try_push(message);
-
-        
-        if (sent) {
-            try_send_next(key, output_queue);
-        }
+    const uint64_t key = stream_key(message.producer_id, message.msg_type);
+    Stream* stream = find_stream(key);
+    if (!stream) {
+        return forward(insert_stream(key, message.sequence_number + 1), message, output_queue);
+    }
 
-        return sent;
-    } else if (message.sequence_number > it->second) {
-        
-        
-        it->second = message.sequence_number + 1;
-        messages_sent_.fetch_add(1);
-        return output_queue->try_push(message);
-    } else {
-        
+    // Messages the queue refused earlier are still first in line
+    try_send_next(*stream, output_queue);
+
+    if (message.sequence_number < stream->expected) {
+        // Already delivered: drop the duplicate
+        messages_duplicate_.fetch_add(1, std::memory_order_relaxed);
         return true;
     }
+    stream->expected = message.sequence_number + 1;
+    return forward(*stream, message, output_queue);
 }
 
 void OrderingBuffer::flush_all(std::shared_ptr<MessageQueue> output_queue) {
-    
-    for (auto& [key, buffer] : buffers_) {
-        if (buffer) {
-            
-            std::vector<Message> messages;
-            MessageNode* current = buffer.get();
-            while (current) {
-                messages.push_back(current->message);
-                current = current->next.get();
-            }
-            
-            std::sort(messages.begin(), messages.end(), 
-                     [](const Message& a, const Message& b) {
-                         return a.sequence_number < b.sequence_number;
-                     });
-            
-            for (const auto& msg : messages) {
-                output_queue->try_push(msg);
-                messages_sent_.fetch_add(1);
+    // Held messages are already in sequence order per stream
+    for (size_t i = 0; i < stream_capacity_; ++i) {
+        Stream& stream = streams_[i];
+        while (stream.key != kEmptyKey && stream.pending) {
+            MessageNode* node = stream.pending;
+            stream.pending = node->next;
+            if (!send(node->message, output_queue)) {
+                messages_dropped_.fetch_add(1, std::memory_order_relaxed);
             }
+            free_node(node);
+            buffered_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        stream.pending_tail = nullptr;
+    }
+}
+
+void OrderingBuffer::restore_sequences(const std::map<std::pair<ProducerId, MessageType>, SequenceNumber>& last_delivered) {
+    for (const auto& [key, sequence] : last_delivered) {
+        const uint64_t stream_id = stream_key(key.first, key.second);
+        if (Stream* stream = find_stream(stream_id)) {
+            stream->expected = sequence + 1;
+        } else {
+            insert_stream(stream_id, sequence + 1);
         }
     }
-    
-    buffers_.clear();
-    messages_buffered_.store(0);
 }
 
 size_t OrderingBuffer::get_buffer_size() const {
-    return messages_buffered_.load();
+    return buffered_.load();
+}
+
+OrderingBuffer::Stream* OrderingBuffer::find_stream(uint64_t key) {
+    const size_t mask = stream_capacity_ - 1;
+    for (size_t slot = stream_slot(key, mask);; slot = (slot + 1) & mask) {
+        Stream& stream = streams_[slot];
+        if (stream.key == key) {
+            return &stream;
+        }
+        if (stream.key == kEmptyKey) {
+            return nullptr;
+        }
+    }
+}
+
+OrderingBuffer::Stream& OrderingBuffer::insert_stream(uint64_t key, SequenceNumber expected) {
+    // Keep probes short: at most half full
+    if ((stream_count_ + 1) * 2 > stream_capacity_) {
+        grow_streams();
+    }
+    const size_t mask = stream_capacity_ - 1;
+    size_t slot = stream_slot(key, mask);
+    while (streams_[slot].key != kEmptyKey) {
+        slot = (slot + 1) & mask;
+    }
+    streams_[slot] = Stream{key, expected, nullptr, nullptr};
+    ++stream_count_;
+    return streams_[slot];
 }
 
-bool OrderingBuffer::try_send_next(const std::pair<ProducerId, MessageType>& key, 
-                                  std::shared_ptr<MessageQueue> output_queue) {
-    auto buffer_it = buffers_.find(key);
-    if (buffer_it == buffers_.end() || !buffer_it->second) {
+void OrderingBuffer::grow_streams() {
+    std::unique_ptr<Stream[]> old_streams = std::move(streams_);
+    const size_t old_capacity = stream_capacity_;
+
+    stream_capacity_ = old_capacity * 2;
+    streams_ = std::make_unique<Stream[]>(stream_capacity_);
+    std::fill_n(streams_.get(), stream_capacity_, Stream{kEmptyKey, 0, nullptr, nullptr});
+
+    const size_t mask = stream_capacity_ - 1;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old_streams[i].key == kEmptyKey) {
+            continue;
+        }
+        size_t slot = stream_slot(old_streams[i].key, mask);
+        while (streams_[slot].key != kEmptyKey) {
+            slot = (slot + 1) & mask;
+        }
+        streams_[slot] = old_streams[i];
+    }
+}
+
+OrderingBuffer::MessageNode* OrderingBuffer::allocate_node(const Message& message) {
+    MessageNode* node = free_nodes_;
+    if (node) {
+        free_nodes_ = node->next;
+        node->message = message;
+        node->next = nullptr;
+    }
+    return node;
+}
+
+void OrderingBuffer::free_node(MessageNode* node) {
+    node->next = free_nodes_;
+    free_nodes_ = node;
+}
+
+bool OrderingBuffer::forward(Stream& stream, const Message& message, std::shared_ptr<MessageQueue>& output_queue) {
+    // Nothing overtakes a waiting message of its stream
+    if (!stream.pending && send(message, output_queue)) {
+        return true;
+    }
+    if (hold(stream, message)) {
+        return true;
+    }
+    messages_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool OrderingBuffer::hold(Stream& stream, const Message& message) {
+    MessageNode* node = allocate_node(message);
+    if (!node) {
         return false;
     }
-    
-    auto& buffer = buffer_it->second;
-    auto expected_it = expected_sequence_.find(key);
-    if (expected_it == expected_sequence_.end()) {
+    if (stream.pending_tail) {
+        stream.pending_tail->next = node;
+    } else {
+        stream.pending = node;
+    }
+    stream.pending_tail = node;
+
+    const size_t buffered = buffered_.load(std::memory_order_relaxed) + 1;
+    buffered_.store(buffered, std::memory_order_relaxed);
+    if (buffered > peak_buffered_.load(std::memory_order_relaxed)) {
+        peak_buffered_.store(buffered, std::memory_order_relaxed);
+    }
+    messages_buffered_.fetch_add(1, std::memory_order_relaxed);
+    if (trace_) {
+        trace_->record(TraceEvent::ReorderHold, static_cast<uint32_t>(buffered));
+    }
+    return true;
+}
+
+bool OrderingBuffer::send(const Message& message, std::shared_ptr<MessageQueue>& output_queue) {
+    if (!output_queue->try_push(message)) {
         return false;
     }
-    
-    SequenceNumber expected_seq = expected_it->second;
-    
-    
-    MessageNode* prev = nullptr;
-    MessageNode* current = buffer.get();
-    
-    while (current) {
-        if (current->message.sequence_number == expected_seq) {
-            
-            bool sent = output_queue->try_push(current->message);
-            if (sent) {
-                messages_sent_.fetch_add(1);
-                messages_buffered_.fetch_sub(1);
-                expected_it->second = expected_seq + 1;
-                
-                
-                if (prev) {
-                    prev->next = std::move(current->next);
-                } else {
-                    buffer = std::move(current->next);
-                }
-                
-                
-                if (buffer) {
-                    try_send_next(key, output_queue);
-                } else {
-                    buffers_.erase(buffer_it);
-                }
-                
-                return true;
-            }
-            return false;
+    messages_sent_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void OrderingBuffer::try_send_next(Stream& stream, std::shared_ptr<MessageQueue>& output_queue) {
+    while (stream.pending) {
+        MessageNode* node = stream.pending;
+        if (!send(node->message, output_queue)) {
+            // Queue full: leave it held; the stream's next arrival retries
+            return;
+        }
+        buffered_.fetch_sub(1, std::memory_order_relaxed);
+        stream.pending = node->next;
+        if (!stream.pending) {
+            stream.pending_tail = nullptr;
         }
-        
-        prev = current;
-        current = current->next.get();
+        free_node(node);
     }
-    
-    return false;
 }
 
-} // namespace MessageRouter
+} // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "../include/payload_arena.h"
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+namespace MessageRouter {
+
+void PayloadArena::MappingDeleter::operator()(uint8_t* base) const {
+    ::munmap(base, bytes);
+}
+
+PayloadArena::PayloadArena(uint16_t arena_id, size_t slots_per_class)
+    : arena_id_(arena_id)
+    , slots_per_class_(static_cast<uint32_t>(slots_per_class))
+    , allocations_(0)
+    , releases_(0)
+    , exhausted_(0) {
+    for (size_t i = 0; i < kSizeClasses; ++i) {
+        // Reserved up front, faulted in only as blocks are first handed out
+        const size_t bytes = slots_per_class * kClassBytes[i];
+        void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        classes_[i].base = std::unique_ptr<uint8_t, MappingDeleter>(static_cast<uint8_t*>(mapping), MappingDeleter{bytes});
+        classes_[i].refs = std::make_unique<std::atomic<uint32_t>[]>(slots_per_class);
+    }
+}
+
+uint8_t* PayloadArena::allocate(size_t size, PayloadHandle& handle) {
+    size_t class_index = 0;
+    while (kClassBytes[class_index] < size) {
+        ++class_index;
+    }
+    SizeClass& size_class = classes_[class_index];
+
+    if (size_class.local_head == kNoSlot) {
+        // Take everything consumers have released since the last refill
+        size_class.local_head = size_class.shared_head.exchange(kNoSlot, std::memory_order_acquire);
+    }
+
+    uint32_t slot;
+    if (size_class.local_head != kNoSlot) {
+        slot = size_class.local_head;
+        size_class.local_head = next_free(size_class, class_index, slot);
+    } else if (size_class.bumped < slots_per_class_) {
+        slot = size_class.bumped++;
+        size_class.touched.store(size_class.bumped, std::memory_order_relaxed);
+    } else {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    handle.arena = arena_id_;
+    handle.size_class = static_cast<uint8_t>(class_index);
+    handle.shared = 0;
+    handle.slot = slot;
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    return size_class.base.get() + static_cast<size_t>(slot) * kClassBytes[class_index];
+}
+
+void PayloadArena::share(PayloadHandle& handle, uint32_t consumers) {
+    std::atomic<uint32_t>& refs = classes_[handle.size_class].refs[handle.slot];
+    if (handle.shared) {
+        // Already fanned out once: the caller's one reference becomes consumers
+        refs.fetch_add(consumers - 1, std::memory_order_relaxed);
+    } else if (consumers > 1) {
+        // Sole owner, so a plain store; the queue push publishes it
+        refs.store(consumers, std::memory_order_relaxed);
+        handle.shared = 1;
+    }
+}
+
+void PayloadArena::release(const PayloadHandle& handle) {
+    if (drop_reference(handle)) {
+        push_free(handle.size_class, handle.slot, handle.slot, 1);
+    }
+}
+
+void PayloadArena::push_free(size_t class_index, uint32_t first, uint32_t last, uint32_t count) {
+    SizeClass& size_class = classes_[class_index];
+    uint32_t head = size_class.shared_head.load(std::memory_order_relaxed);
+    do {
+        set_next_free(size_class, class_index, last, head);
+    } while (!size_class.shared_head.compare_exchange_weak(head, first, std::memory_order_release,
+                                                           std::memory_order_relaxed));
+    releases_.fetch_add(count, std::memory_order_relaxed);
+}
+
+uint32_t PayloadArena::next_free(const SizeClass& size_class, size_t class_index, uint32_t slot) const {
+    uint32_t next;
+    std::memcpy(&next, size_class.base.get() + static_cast<size_t>(slot) * kClassBytes[class_index], sizeof(next));
+    return next;
+}
+
+void PayloadArena::set_next_free(SizeClass& size_class, size_t class_index, uint32_t slot, uint32_t next) {
+    std::memcpy(size_class.base.get() + static_cast<size_t>(slot) * kClassBytes[class_index], &next, sizeof(next));
+}
+
+void PayloadArena::collect_stats(PayloadStats& out) const {
+    out.allocations += allocations_.load(std::memory_order_relaxed);
+    out.releases += releases_.load(std::memory_order_relaxed);
+    out.exhausted += exhausted_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kSizeClasses; ++i) {
+        out.touched_bytes += classes_[i].touched.load(std::memory_order_relaxed) * kClassBytes[i];
+    }
+}
+
+PayloadArenas::PayloadArenas(const PayloadConfig& config, size_t producers) {
+    for (size_t producer = 0; producer < producers; ++producer) {
+        arenas_.push_back(std::make_unique<PayloadArena>(static_cast<uint16_t>(producer), config.slots_per_class));
+    }
+}
+
+void PayloadArenas::collect_stats(PayloadStats& out) const {
+    for (const auto& arena : arenas_) {
+        arena->collect_stats(out);
+    }
+}
+
+PayloadReleaser::PayloadReleaser(PayloadArenas& arenas)
+    : arenas_(arenas)
+    , pending_count_(0)
+    , chains_(arenas.size() * PayloadArena::kSizeClasses) {}
+
+void PayloadReleaser::flush() {
+    // Link the held blocks into per-(arena, class) chains through their own
+    // free-list words, then publish each chain with one push
+    for (size_t i = 0; i < pending_count_; ++i) {
+        const PayloadHandle& handle = pending_[i];
+        PayloadArena* arena = arenas_.arena(handle.arena);
+        Chain& chain = chains_[handle.arena * PayloadArena::kSizeClasses + handle.size_class];
+        if (chain.count == 0) {
+            chain.last = handle.slot;
+        } else {
+            arena->set_next_free(arena->classes_[handle.size_class], handle.size_class, handle.slot, chain.first);
+        }
+        chain.first = handle.slot;
+        ++chain.count;
+    }
+    for (size_t i = 0; i < pending_count_; ++i) {
+        const PayloadHandle& handle = pending_[i];
+        Chain& chain = chains_[handle.arena * PayloadArena::kSizeClasses + handle.size_class];
+        if (chain.count > 0) {
+            arenas_.arena(handle.arena)->push_free(handle.size_class, chain.first, chain.last, chain.count);
+            chain.count = 0;
+        }
+    }
+    pending_count_ = 0;
+}
+
+} // namespace MessageRouter
@@ -0,0 +1,293 @@
+#include "../include/perf_counters.h"
+#include "../include/metrics_registry.h"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace MessageRouter {
+
+namespace {
+
+uint64_t event_config(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::Cycles: return PERF_COUNT_HW_CPU_CYCLES;
+        case PerfEvent::Instructions: return PERF_COUNT_HW_INSTRUCTIONS;
+        case PerfEvent::LlcMisses: return PERF_COUNT_HW_CACHE_MISSES;
+        case PerfEvent::BranchMisses: return PERF_COUNT_HW_BRANCH_MISSES;
+        default: return 0;
+    }
+}
+
+int open_event(PerfEvent event, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = event_config(event);
+    attr.disabled = group_fd < 0 ? 1 : 0;     // the leader starts the whole group
+    attr.exclude_kernel = 1;                    // allowed at perf_event_paranoid 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+// Which metric counts the messages a stage's threads handle
+Metric stage_metric(const std::string& stage) {
+    if (stage == "producer") {
+        return Metric::MessagesProduced;
+    } else if (stage == "processor") {
+        return Metric::MessagesProcessed;
+    } else if (stage == "strategy") {
+        return Metric::MessagesDelivered;
+    }
+    return Metric::MessagesRouted;
+}
+
+} // namespace
+
+const char* perf_event_name(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::Cycles: return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::LlcMisses: return "llc_misses";
+        case PerfEvent::BranchMisses: return "branch_misses";
+        default: return "unknown";
+    }
+}
+
+void PerfSample::add(const PerfSample& other) {
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        values[i] += other.values[i];
+        // Available only if every thread counted it
+        available[i] = (threads == 0 || available[i]) && other.available[i];
+    }
+    threads += other.threads;
+}
+
+PerfSample PerfSample::since(const PerfSample& earlier) const {
+    PerfSample delta = *this;
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        // Multiplexing rescales every read, so a later one can come out lower
+        delta.values[i] = values[i] > earlier.values[i] ? values[i] - earlier.values[i] : 0;
+    }
+    return delta;
+}
+
+PerfCost per_message(const PerfSample& sample, uint64_t messages) {
+    PerfCost cost;
+    if (messages == 0) {
+        return cost;
+    }
+    const double count = static_cast<double>(messages);
+    if (sample.has(PerfEvent::Cycles)) {
+        cost.cycles = sample[PerfEvent::Cycles] / count;
+        if (sample.has(PerfEvent::Instructions) && sample[PerfEvent::Cycles] > 0) {
+            cost.ipc = static_cast<double>(sample[PerfEvent::Instructions]) / sample[PerfEvent::Cycles];
+        }
+    }
+    if (sample.has(PerfEvent::LlcMisses)) {
+        cost.llc_misses = sample[PerfEvent::LlcMisses] / count;
+    }
+    if (sample.has(PerfEvent::BranchMisses)) {
+        cost.branch_misses = sample[PerfEvent::BranchMisses] / count;
+    }
+    return cost;
+}
+
+PerfCounters::PerfCounters()
+    : leader_(-1)
+    , opened_(0) {
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        fds_[i] = -1;
+        group_index_[i] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+bool PerfCounters::open() {
+    close();
+    leader_ = open_event(PerfEvent::Cycles, -1);
+    if (leader_ < 0) {
+        error_ = std::string("perf_event_open(cycles): ") + std::strerror(errno);
+        if (errno == EACCES || errno == EPERM) {
+            error_ += " (see /proc/sys/kernel/perf_event_paranoid)";
+        } else if (errno == ENOENT || errno == EOPNOTSUPP) {
+            error_ += " (no hardware PMU exposed to this host)";
+        }
+        return false;
+    }
+    fds_[0] = leader_;
+    group_index_[0] = 0;
+    opened_ = 1;
+
+    // The rest are optional: a PMU short of counters or a VM may refuse some
+    for (size_t i = 1; i < kPerfEventCount; ++i) {
+        fds_[i] = open_event(static_cast<PerfEvent>(i), leader_);
+        if (fds_[i] >= 0) {
+            group_index_[i] = static_cast<int>(opened_++);
+        }
+    }
+
+    ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounters::close() {
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        if (fds_[i] >= 0) {
+            ::close(fds_[i]);
+        }
+        fds_[i] = -1;
+        group_index_[i] = -1;
+    }
+    leader_ = -1;
+    opened_ = 0;
+}
+
+void PerfCounters::read(PerfSample& out) const {
+    out = PerfSample{};
+    if (leader_ < 0) {
+        return;
+    }
+
+    // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr]
+    uint64_t buffer[3 + kPerfEventCount] = {};
+    if (::read(leader_, buffer, sizeof(buffer)) < static_cast<ssize_t>((3 + opened_) * sizeof(uint64_t))) {
+        return;
+    }
+    const uint64_t enabled = buffer[1];
+    const uint64_t running = buffer[2];
+    const double scale = running > 0 ? static_cast<double>(enabled) / running : 0.0;
+
+    out.threads = 1;
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        if (group_index_[i] >= 0) {
+            out.values[i] = static_cast<uint64_t>(buffer[3 + group_index_[i]] * scale);
+            out.available[i] = true;
+        }
+    }
+}
+
+PerfRegistry& PerfRegistry::instance() {
+    static PerfRegistry registry;
+    return registry;
+}
+
+void PerfRegistry::add(const std::string& stage, const PerfSample& busy, const PerfSample& idle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StageSample& totals = stages_[stage];
+    totals.busy.add(busy);
+    totals.idle.add(idle);
+}
+
+void PerfRegistry::set_error(const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty()) {
+        error_ = error;
+    }
+}
+
+void PerfRegistry::print_report() const {
+    std::map<std::string, StageSample> stages;
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stages = stages_;
+        error = error_;
+    }
+
+    std::cout << "" << std::endl;
+    if (stages.empty()) {
+        std::cout << "Perf Counters: unavailable, " << (error.empty() ? "no thread counted" : error) << std::endl;
+        return;
+    }
+
+    std::vector<MetricsSnapshot> threads;
+    MetricsRegistry::instance().snapshot(threads);
+
+    auto format = [](double value, int precision) {
+        std::ostringstream out;
+        if (value < 0) {
+            out << "n/a";
+        } else {
+            out << std::fixed << std::setprecision(precision) << value;
+        }
+        return out.str();
+    };
+
+    std::cout << "Perf Counters (user space, per message, busy polls only):" << std::endl;
+    std::cout << "  " << std::left << std::setw(20) << "Stage" << std::right << std::setw(12) << "cycles"
+              << std::setw(8) << "IPC" << std::setw(12) << "LLC miss" << std::setw(12) << "br miss"
+              << std::setw(10) << "idle %" << std::endl;
+    for (const char* stage : {"producer", "stage1", "processor", "stage2", "strategy"}) {
+        auto it = stages.find(stage);
+        if (it == stages.end()) {
+            continue;
+        }
+        const Metric metric = stage_metric(stage);
+        uint64_t messages = 0;
+        for (const auto& thread : threads) {
+            const std::string thread_stage = thread.thread.substr(0, thread.thread.find('-'));
+            if (thread_stage == stage || (thread_stage == "replay" && metric == Metric::MessagesProduced)) {
+                messages += thread[metric];
+            }
+        }
+        const PerfSample& busy = it->second.busy;
+        const PerfSample& idle = it->second.idle;
+        const PerfCost cost = per_message(busy, messages);
+        const uint64_t cycles = busy[PerfEvent::Cycles] + idle[PerfEvent::Cycles];
+        const double idle_share = busy.has(PerfEvent::Cycles) && cycles > 0
+            ? 100.0 * idle[PerfEvent::Cycles] / cycles : -1.0;
+        const std::string label = std::string(stage) + " (" + std::to_string(busy.threads) + "):";
+        std::cout << "  " << std::left << std::setw(20) << label << std::right
+                  << std::setw(12) << format(cost.cycles, 1) << std::setw(8) << format(cost.ipc, 2)
+                  << std::setw(12) << format(cost.llc_misses, 3) << std::setw(12) << format(cost.branch_misses, 3)
+                  << std::setw(10) << format(idle_share, 1) << std::endl;
+    }
+    if (!error.empty()) {
+        std::cout << "  Some threads not counted: " << error << std::endl;
+    }
+}
+
+ThreadPerf::ThreadPerf(std::string stage)
+    : stage_(std::move(stage))
+    , idle_(true) {
+    PerfRegistry& registry = PerfRegistry::instance();
+    if (registry.enabled() && !counters_.open()) {
+        registry.set_error(counters_.error());
+    }
+    // Both halves report the events the thread counts, even if never charged
+    counters_.read(last_);
+    busy_counts_ = last_.since(last_);
+    idle_counts_ = busy_counts_;
+}
+
+ThreadPerf::~ThreadPerf() {
+    if (counters_.is_open()) {
+        charge(idle_ ? idle_counts_ : busy_counts_);
+        PerfRegistry::instance().add(stage_, busy_counts_, idle_counts_);
+    }
+}
+
+void ThreadPerf::charge(PerfSample& into) {
+    PerfSample now;
+    counters_.read(now);
+    const PerfSample delta = now.since(last_);
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        into.values[i] += delta.values[i];
+    }
+    last_ = now;
+}
+
+} // namespace MessageRouter
\ No newline at end of file
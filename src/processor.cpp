@@ -1,4 +1,6 @@
 #include "../include/processor.h"
+#include "../include/perf_counters.h"
+#include "../include/tsc_clock.h"
 #include <iostream>
 #include <chrono>
 #include <vector>
@@ -6,6 +8,8 @@
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 namespace MessageRouter {
 
@@ -17,7 +21,14 @@ Processor::Processor(ProcessorId id, const SystemConfig* config,
     , input_queue_(input_queue)
     , output_queue_(output_queue)
     , running_(false)
-    , messages_processed_(0) {
+    , metrics_("processor-" + std::to_string(id))
+    , trace_(config->trace.enabled, config->trace.records_per_thread, "processor-" + std::to_string(id))
+    , ttl_(config->ttl)
+    , payloads_(nullptr) {
+    if (config->overflow.enabled) {
+        spill_ = std::make_unique<SpillFile>(config->overflow.directory, "processor-" + std::to_string(id),
+                                             config->overflow.max_bytes_per_edge);
+    }
 }
 
 Processor::~Processor() {
@@ -46,42 +57,130 @@ void Processor::stop() {
 }
 
 void Processor::processor_loop() {
-    Message message;
-    
+    ThreadPerf perf("processor");
+    bool idle = false;
     while (running_.load()) {
+        perf.begin_poll();
         // Process ALL available messages
-        while (input_queue_->try_pop(message)) {
+        const bool worked = process_batch(SIZE_MAX) > 0;
+        perf.end_poll(worked);
+        if (worked) {
+            idle = false;
+        } else if (!idle) {
+            trace_.record(TraceEvent::Idle);
+            idle = true;
+        }
+        
+        // Queue is empty - busy-waiting for minimal latency
+        std::this_thread::yield();
+    }
+}
+
+size_t Processor::process_batch(size_t max_messages) {
+    Message batch[TtlPolicy::kBatchSize];
+    uint8_t expired[TtlPolicy::kBatchSize];
+    size_t processed = 0;
+    
+    if (spill_ && !spill_->empty()) {
+        spill_->drain(*output_queue_);
+    }
+    
+    while (processed < max_messages) {
+        // Drain a batch so expiry is decided for all of it at once
+        const size_t limit = std::min(TtlPolicy::kBatchSize, max_messages - processed);
+        size_t count = 0;
+        while (count < limit && input_queue_->try_pop(batch[count])) {
+            ++count;
+        }
+        if (count == 0) {
+            break;
+        }
+        trace_.record(TraceEvent::BatchPopped, static_cast<uint32_t>(count));
+        
+        size_t stale = ttl_.enabled() ? ttl_.mark_expired(batch, count, TscClock::now(), expired) : 0;
+        if (stale > 0) {
+            metrics_->add(Metric::MessagesExpired, stale);
+        }
+        
+        for (size_t i = 0; i < count; ++i) {
+            Message& message = batch[i];
+            if (stale > 0 && expired[i]) {
+                if (payloads_) {
+                    payloads_->release(message);
+                }
+                continue;
+            }
+            if (is_snapshot_marker(message)) {
+                forward_snapshot_marker(message);
+                continue;
+            }
+            
             // Process the message
             simulate_processing(message);
             
             // Send processed message with retries
             bool sent = false;
+            if (spill_) {
+                // Overflow mode: a full queue spills instead of retrying
+                if (spill_->offer(*output_queue_, message)) {
+                    metrics_->add(Metric::MessagesProcessed);
+                } else if (payloads_) {
+                    payloads_->release(message);
+                }
+                sent = true;
+            }
             for (int retry = 0; retry < 1000 && !sent; ++retry) {
                 if (output_queue_->try_push(message)) {
-                    messages_processed_.fetch_add(1, std::memory_order_relaxed);
+                    metrics_->add(Metric::MessagesProcessed);
                     sent = true;
+                    if (retry > 0) {
+                        trace_.record(TraceEvent::Retry, static_cast<uint32_t>(retry));
+                    }
                 } else {
+                    if (retry == 0) {
+                        trace_.record(TraceEvent::QueueFull, static_cast<uint32_t>(processor_id_));
+                    }
                     // Queue is full - small pause and retry
                     std::this_thread::yield();
                 }
             }
+            if (!sent) {
+                trace_.record(TraceEvent::Retry, 1000);
+                if (payloads_) {
+                    payloads_->release(message);
+                }
+            }
         }
-        
-        // Queue is empty - busy-waiting for minimal latency
-        std::this_thread::yield();
+        processed += count;
     }
+    
+    return processed;
 }
 
 void Processor::simulate_processing(Message& message) {
     // Fill processor fields
     message.processor_id = processor_id_;
-    message.processing_timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    message.processing_timestamp = TscClock::now();
     
     // Minimal processing for maximum performance
     // In a real system, processing logic would be here
 }
 
+void Processor::forward_snapshot_marker(const Message& marker) {
+    // Processors hold no snapshot state; the marker just keeps its place in the stream
+    if (spill_) {
+        spill_->offer(*output_queue_, marker);
+        return;
+    }
+    for (int retry = 0; retry < 1000; ++retry) {
+        if (output_queue_->try_push(marker)) {
+            return;
+        }
+        // Queue is full - small pause and retry
+        std::this_thread::yield();
+    }
+}
+
 ProcessorManager::ProcessorManager(const SystemConfig* config,
                                  const std::vector<std::shared_ptr<MessageQueue>>& input_queues,
                                  const std::vector<std::shared_ptr<MessageQueue>>& output_queues)
@@ -95,6 +194,14 @@ ProcessorManager::ProcessorManager(const SystemConfig* config,
         auto output_queue = output_queues[i]; // Each processor has its own output queue
         processors_.push_back(std::make_unique<Processor>(i, config, input_queue, output_queue));
     }
+    
+    if (config->processors.autoscale.enabled) {
+        std::vector<Processor*> lanes;
+        for (auto& processor : processors_) {
+            lanes.push_back(processor.get());
+        }
+        autoscaler_ = std::make_unique<ProcessorAutoscaler>(config->processors.autoscale, config->trace, lanes);
+    }
 }
 
 ProcessorManager::~ProcessorManager() {
@@ -102,18 +209,30 @@ ProcessorManager::~ProcessorManager() {
 }
 
 void ProcessorManager::start_all() {
+    if (autoscaler_) {
+        autoscaler_->start();
+        return;
+    }
     for (auto& processor : processors_) {
         processor->start();
     }
 }
 
 void ProcessorManager::stop_all() {
+    if (autoscaler_) {
+        autoscaler_->stop();
+        return;
+    }
     for (auto& processor : processors_) {
         processor->stop();
     }
 }
 
 void ProcessorManager::wait_for_completion() {
+    if (autoscaler_) {
+        autoscaler_->wait_for_completion();
+        return;
+    }
     for (auto& processor : processors_) {
         if (processor->processor_thread_ && processor->processor_thread_->joinable()) {
             processor->processor_thread_->join();
@@ -129,4 +248,26 @@ uint64_t ProcessorManager::get_total_messages_processed() const {
     return total;
 }
 
+uint64_t ProcessorManager::get_total_messages_expired() const {
+    uint64_t total = 0;
+    for (const auto& processor : processors_) {
+        total += processor->get_messages_expired();
+    }
+    return total;
+}
+
+void ProcessorManager::collect_spill_stats(SpillStats& out) const {
+    for (const auto& processor : processors_) {
+        if (processor->spill_) {
+            processor->spill_->collect_stats(out);
+        }
+    }
+}
+
+void ProcessorManager::set_payload_arenas(PayloadArenas* arenas) {
+    for (auto& processor : processors_) {
+        processor->payloads_ = arenas;
+    }
+}
+
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "../include/processor_autoscaler.h"
+#include "../include/perf_counters.h"
+#include "../include/processor.h"
+#include <algorithm>
+
+namespace MessageRouter {
+
+ProcessorAutoscaler::ProcessorAutoscaler(const ProcessorAutoscaleConfig& config, const TraceConfig& trace,
+                                         const std::vector<Processor*>& lanes)
+    : config_(config)
+    , running_(false)
+    , active_workers_(0)
+    , peak_active_workers_(0)
+    , scale_ups_(0)
+    , scale_downs_(0) {
+    for (auto* processor : lanes) {
+        auto lane = std::make_unique<Lane>();
+        lane->processor = processor;
+        lanes_.push_back(std::move(lane));
+        workers_.push_back(std::make_unique<Worker>(trace, workers_.size()));
+    }
+}
+
+ProcessorAutoscaler::~ProcessorAutoscaler() {
+    stop();
+}
+
+void ProcessorAutoscaler::start() {
+    if (running_.load() || workers_.empty()) {
+        return;
+    }
+    running_.store(true);
+
+    for (auto& lane : lanes_) {
+        lane->owner.store(kNoOwner);
+        lane->target.store(kNoOwner);
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::make_unique<std::thread>(&ProcessorAutoscaler::worker_loop, this, static_cast<int>(i));
+    }
+
+    size_t min_active = std::clamp<size_t>(config_.min_active, 1, workers_.size());
+    resize(min_active);
+    peak_active_workers_.store(min_active);
+
+    control_thread_ = std::make_unique<std::thread>(&ProcessorAutoscaler::control_loop, this);
+}
+
+void ProcessorAutoscaler::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    if (control_thread_ && control_thread_->joinable()) {
+        control_thread_->join();
+    }
+
+    // Unpark everyone so they can observe running_ == false
+    for (auto& worker : workers_) {
+        worker->active.store(true);
+        worker->active.notify_one();
+    }
+    wait_for_completion();
+}
+
+void ProcessorAutoscaler::wait_for_completion() {
+    if (control_thread_ && control_thread_->joinable()) {
+        control_thread_->join();
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread && worker->thread->joinable()) {
+            worker->thread->join();
+        }
+    }
+}
+
+void ProcessorAutoscaler::worker_loop(int worker_index) {
+    ThreadPerf perf("processor");
+    Worker& worker = *workers_[worker_index];
+
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!worker.active.load(std::memory_order_acquire)) {
+            release_lanes(worker_index);
+            worker.trace.record(TraceEvent::Park);
+            worker.active.wait(false, std::memory_order_acquire);
+            worker.trace.record(TraceEvent::Unpark);
+            continue;
+        }
+
+        perf.begin_poll();
+        bool did_work = false;
+        for (auto& lane : lanes_) {
+            int owner = lane->owner.load(std::memory_order_acquire);
+            int target = lane->target.load(std::memory_order_acquire);
+
+            if (owner == worker_index) {
+                if (target != worker_index) {
+                    // Hand off between batches; the new owner acquires after this release
+                    lane->owner.store(kNoOwner, std::memory_order_release);
+                    continue;
+                }
+                if (lane->processor->process_batch(kBatchBudget) > 0) {
+                    did_work = true;
+                }
+            } else if (owner == kNoOwner && target == worker_index) {
+                int expected = kNoOwner;
+                lane->owner.compare_exchange_strong(expected, worker_index, std::memory_order_acq_rel);
+            }
+        }
+
+        perf.end_poll(did_work);
+        worker.total_polls.fetch_add(1, std::memory_order_relaxed);
+        if (did_work) {
+            worker.busy_polls.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    release_lanes(worker_index);
+}
+
+void ProcessorAutoscaler::release_lanes(int worker_index) {
+    for (auto& lane : lanes_) {
+        if (lane->owner.load(std::memory_order_relaxed) == worker_index) {
+            lane->owner.store(kNoOwner, std::memory_order_release);
+        }
+    }
+}
+
+void ProcessorAutoscaler::resize(size_t active) {
+    // Wake first so retargeted lanes are picked up immediately
+    for (size_t i = 0; i < active; ++i) {
+        if (!workers_[i]->active.load()) {
+            workers_[i]->active.store(true, std::memory_order_release);
+            workers_[i]->active.notify_one();
+        }
+    }
+
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+        lanes_[i]->target.store(static_cast<int>(i % active), std::memory_order_release);
+    }
+
+    for (size_t i = active; i < workers_.size(); ++i) {
+        workers_[i]->active.store(false, std::memory_order_release);
+    }
+
+    active_workers_.store(active);
+    if (active > peak_active_workers_.load()) {
+        peak_active_workers_.store(active);
+    }
+}
+
+void ProcessorAutoscaler::control_loop() {
+    const size_t max_active = workers_.size();
+    const size_t min_active = std::clamp<size_t>(config_.min_active, 1, max_active);
+    const auto interval = std::chrono::microseconds(config_.sample_interval_us);
+    const auto hold = std::chrono::milliseconds(config_.scale_down_hold_ms);
+
+    std::vector<uint64_t> last_busy(max_active, 0);
+    std::vector<uint64_t> last_total(max_active, 0);
+    bool below_threshold = false;
+    auto below_since = std::chrono::steady_clock::now();
+
+    while (running_.load()) {
+        std::this_thread::sleep_for(interval);
+
+        size_t active = active_workers_.load();
+
+        uint64_t depth = 0;
+        for (const auto& lane : lanes_) {
+            depth += lane->processor->get_input_depth();
+        }
+
+        uint64_t busy = 0;
+        uint64_t total = 0;
+        for (size_t i = 0; i < max_active; ++i) {
+            uint64_t b = workers_[i]->busy_polls.load(std::memory_order_relaxed);
+            uint64_t t = workers_[i]->total_polls.load(std::memory_order_relaxed);
+            if (i < active) {
+                busy += b - last_busy[i];
+                total += t - last_total[i];
+            }
+            last_busy[i] = b;
+            last_total[i] = t;
+        }
+        double utilization = total > 0 ? static_cast<double>(busy) / total : 0.0;
+
+        bool overloaded = depth > config_.scale_up_depth * active ||
+                          utilization >= config_.scale_up_utilization;
+        bool underloaded = depth <= config_.scale_down_depth * active &&
+                           utilization <= config_.scale_down_utilization;
+
+        if (overloaded && active < max_active) {
+            // Size for the backlog in one step so a burst is absorbed within one interval
+            size_t wanted = active + 1;
+            if (config_.scale_up_depth > 0) {
+                wanted = std::max<size_t>(wanted, (depth + config_.scale_up_depth - 1) / config_.scale_up_depth);
+            }
+            resize(std::min(wanted, max_active));
+            scale_ups_.fetch_add(1);
+            below_threshold = false;
+        } else if (underloaded && active > min_active) {
+            auto now = std::chrono::steady_clock::now();
+            if (!below_threshold) {
+                below_threshold = true;
+                below_since = now;
+            } else if (now - below_since >= hold) {
+                resize(active - 1);
+                scale_downs_.fetch_add(1);
+                below_since = now;
+            }
+        } else {
+            below_threshold = false;
+        }
+    }
+}
+
+} // namespace MessageRouter
@@ -1,4 +1,6 @@
 #include "../include/producer.h"
+#include "../include/perf_counters.h"
+#include "../include/tsc_clock.h"
 #include <iostream>
 #include <chrono>
 #include <random>
@@ -7,6 +9,7 @@
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 
 namespace MessageRouter {
 
@@ -15,8 +18,16 @@ Producer::Producer(ProducerId id, const SystemConfig* config, std::shared_ptr<Me
     , config_(config)
     , output_queue_(output_queue)
     , running_(false)
-    , messages_produced_(0)
-    , next_sequence_(1) {
+    , metrics_("producer-" + std::to_string(id))
+    , max_schedule_lag_(0)
+    , next_sequence_(1)
+    , snapshot_(nullptr)
+    , snapshot_epoch_(0)
+    , payload_arena_(nullptr) {
+    if (config->overflow.enabled) {
+        spill_ = std::make_unique<SpillFile>(config->overflow.directory, "producer-" + std::to_string(id),
+                                             config->overflow.max_bytes_per_edge);
+    }
 }
 
 Producer::~Producer() {
@@ -45,6 +56,11 @@ void Producer::stop() {
 }
 
 void Producer::producer_loop() {
+    ThreadPerf perf("producer");
+    if (config_->producers.open_loop) {
+        open_loop(perf);
+        return;
+    }
     
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -54,47 +70,185 @@ void Producer::producer_loop() {
     double messages_per_sec = config_->producers.messages_per_sec;
     double interval_ns = 1e9 / messages_per_sec;
     
-    auto start_time = std::chrono::high_resolution_clock::now();
-    auto next_message_time = start_time;
+    // Pace in clock ticks so the spin loop never converts to nanoseconds
+    const uint64_t interval_ticks = TscClock::nanos_to_ticks(static_cast<uint64_t>(interval_ns));
+    uint64_t next_message_time = TscClock::now();
     
     while (running_.load()) {
-        auto current_time = std::chrono::high_resolution_clock::now();
+        perf.begin_poll();
+        poll_snapshot();
+        uint64_t current_time = TscClock::now();
         
         if (current_time >= next_message_time) {
             
             MessageType msg_type = msg_type_dist(gen);
-            uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                current_time.time_since_epoch()).count();
             
-            Message message(msg_type, producer_id_, next_sequence_++, timestamp);
+            Message message(msg_type, producer_id_, next_sequence_++, current_time);
+            if (payload_arena_) {
+                attach_payload(message, gen);
+            }
             
             
             bool sent = false;
+            if (spill_) {
+                if (spill_->offer(*output_queue_, message)) {
+                    metrics_->add(Metric::MessagesProduced);
+                } else {
+                    discard_payload(message);
+                }
+                sent = true;
+            }
             for (int retry = 0; retry < 100 && !sent; ++retry) {
                 if (output_queue_->try_push(message)) {
-                    messages_produced_.fetch_add(1, std::memory_order_relaxed);
+                    metrics_->add(Metric::MessagesProduced);
                     sent = true;
                 } else {
                     
                     std::this_thread::yield();
                 }
             }
+            if (!sent) {
+                discard_payload(message);
+            }
             
             
-            next_message_time = current_time + std::chrono::nanoseconds(static_cast<uint64_t>(interval_ns));
+            next_message_time = current_time + interval_ticks;
+            perf.end_poll(true);
         } else {
-            
+            if (spill_ && !spill_->empty()) {
+                spill_->drain(*output_queue_);
+            }
+            perf.end_poll(false);
             std::this_thread::yield();
         }
     }
 }
 
+void Producer::open_loop(ThreadPerf& perf) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<MessageType> msg_type_dist(0, 3);
+    
+    // The schedule is fixed up front: send i is due at start + i * interval,
+    // no matter when send i-1 actually went out
+    const double interval_ticks = 1e9 / config_->producers.messages_per_sec * TscClock::ticks_per_nano();
+    const uint64_t lag_tolerance = TscClock::nanos_to_ticks(config_->producers.schedule_lag_tolerance_ns);
+    const uint64_t start_time = TscClock::now();
+    uint64_t scheduled = 0;
+    
+    while (running_.load()) {
+        perf.begin_poll();
+        poll_snapshot();
+        uint64_t intended_time = start_time + static_cast<uint64_t>(scheduled * interval_ticks);
+        uint64_t current_time = TscClock::now();
+        
+        if (current_time < intended_time) {
+            perf.end_poll(false);
+            std::this_thread::yield();
+            continue;
+        }
+        
+        uint64_t lag = current_time - intended_time;
+        if (lag > lag_tolerance) {
+            metrics_->add(Metric::SendsBehindSchedule);
+        }
+        if (lag > max_schedule_lag_.load(std::memory_order_relaxed)) {
+            max_schedule_lag_.store(lag, std::memory_order_relaxed);
+        }
+        
+        // Latency is measured from when the message should have been sent
+        Message message(msg_type_dist(gen), producer_id_, next_sequence_++, intended_time);
+        if (payload_arena_) {
+            attach_payload(message, gen);
+        }
+        
+        // Never drop: a full queue just makes us later, which the lag accounts for
+        while (!output_queue_->try_push(message)) {
+            if (!running_.load()) {
+                discard_payload(message);
+                return;
+            }
+            std::this_thread::yield();
+        }
+        metrics_->add(Metric::MessagesProduced);
+        ++scheduled;
+        perf.end_poll(true);
+    }
+}
+
+void Producer::attach_payload(Message& message, std::mt19937& gen) {
+    std::uniform_int_distribution<size_t> size_dist(config_->payloads.min_bytes, config_->payloads.max_bytes);
+    const size_t size = size_dist(gen);
+    
+    uint8_t* body;
+    if (size <= Message::kInlinePayloadBytes) {
+        body = message.inline_payload;
+        message.payload_kind = PayloadKind::Inline;
+        metrics_->add(Metric::InlinePayloads);
+    } else {
+        body = payload_arena_->allocate(size, message.payload_handle);
+        if (!body) {
+            // Size class exhausted: the message goes out without a body
+            return;
+        }
+        message.payload_kind = PayloadKind::Arena;
+    }
+    message.payload_size = static_cast<uint16_t>(size);
+    fill_payload(body, size, message.sequence_number);
+}
+
+void Producer::discard_payload(const Message& message) {
+    if (message.payload_kind == PayloadKind::Arena) {
+        payload_arena_->release(message.payload_handle);
+    }
+}
+
+void Producer::poll_snapshot() {
+    if (!snapshot_) {
+        return;
+    }
+    uint64_t epoch = snapshot_->get_requested_epoch();
+    if (epoch == snapshot_epoch_) {
+        return;
+    }
+    snapshot_epoch_ = epoch;
+    snapshot_->report_producer(producer_id_, epoch, next_sequence_ - 1);
+    
+    // Never drop the marker: it splits this stream into before and after the snapshot
+    Message marker = make_snapshot_marker(epoch);
+    if (spill_) {
+        spill_->offer(*output_queue_, marker);
+        return;
+    }
+    while (!output_queue_->try_push(marker)) {
+        if (!running_.load()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
 ProducerManager::ProducerManager(const SystemConfig* config, 
                                const std::vector<std::shared_ptr<MessageQueue>>& output_queues)
     : config_(config)
     , output_queues_(output_queues) {
     
     
+    if (config->replay.enabled) {
+        replay_ = std::make_unique<ReplayProducer>(config->replay, output_queues);
+        return;
+    }
+    
+    if (config->ingress.enabled) {
+        ingress_ = std::make_unique<IngressServer>(config->ingress, output_queues);
+        if (config->ingress.loopback_connections > 0) {
+            loopback_client_ = std::make_unique<IngressLoadClient>(
+                config->ingress.bind_address, ingress_->get_tcp_port(),
+                config->ingress.loopback_connections, config->ingress.loopback_messages_per_sec);
+        }
+        return;
+    }
+    
     // Create producers - each gets its own SPSC queue
     for (int i = 0; i < config->producers.count; ++i) {
         auto output_queue = output_queues[i]; // Each producer has its own queue
@@ -107,18 +261,51 @@ ProducerManager::~ProducerManager() {
 }
 
 void ProducerManager::start_all() {
+    if (ingress_) {
+        ingress_->start();
+        if (loopback_client_) {
+            loopback_client_->start();
+        }
+        return;
+    }
+    if (replay_) {
+        replay_->start();
+        return;
+    }
     for (auto& producer : producers_) {
         producer->start();
     }
 }
 
 void ProducerManager::stop_all() {
+    if (ingress_) {
+        if (loopback_client_) {
+            loopback_client_->stop();
+        }
+        ingress_->stop();
+        return;
+    }
+    if (replay_) {
+        replay_->stop();
+        return;
+    }
     for (auto& producer : producers_) {
         producer->stop();
     }
 }
 
 void ProducerManager::wait_for_completion() {
+    if (ingress_) {
+        if (loopback_client_) {
+            loopback_client_->wait_for_completion();
+        }
+        ingress_->wait_for_completion();
+        return;
+    }
+    if (replay_) {
+        replay_->wait_for_completion();
+        return;
+    }
     for (auto& producer : producers_) {
         if (producer->producer_thread_ && producer->producer_thread_->joinable()) {
             producer->producer_thread_->join();
@@ -127,11 +314,65 @@ void ProducerManager::wait_for_completion() {
 }
 
 uint64_t ProducerManager::get_total_messages_produced() const {
-    uint64_t total = 0;
+    uint64_t total = replay_ ? replay_->get_messages_produced() : 0;
+    if (ingress_) {
+        total += ingress_->get_messages_received();
+    }
     for (const auto& producer : producers_) {
         total += producer->get_messages_produced();
     }
     return total;
 }
 
+uint64_t ProducerManager::get_total_sends_behind_schedule() const {
+    uint64_t total = 0;
+    for (const auto& producer : producers_) {
+        total += producer->get_sends_behind_schedule();
+    }
+    return total;
+}
+
+uint64_t ProducerManager::get_max_schedule_lag_ns() const {
+    uint64_t max_lag = 0;
+    for (const auto& producer : producers_) {
+        max_lag = std::max(max_lag, producer->get_max_schedule_lag());
+    }
+    return static_cast<uint64_t>(max_lag / TscClock::ticks_per_nano());
+}
+
+void ProducerManager::collect_spill_stats(SpillStats& out) const {
+    for (const auto& producer : producers_) {
+        if (producer->spill_) {
+            producer->spill_->collect_stats(out);
+        }
+    }
+}
+
+void ProducerManager::set_snapshot_coordinator(SnapshotCoordinator* snapshot) {
+    for (auto& producer : producers_) {
+        producer->snapshot_ = snapshot;
+    }
+}
+
+void ProducerManager::set_payload_arenas(PayloadArenas* arenas) {
+    for (auto& producer : producers_) {
+        producer->payload_arena_ = arenas ? arenas->arena(producer->producer_id_) : nullptr;
+    }
+}
+
+void ProducerManager::collect_payload_stats(PayloadStats& out) const {
+    for (const auto& producer : producers_) {
+        out.inline_payloads += producer->get_inline_payloads();
+    }
+}
+
+void ProducerManager::restore_sequences(const std::map<ProducerId, SequenceNumber>& last_delivered) {
+    for (auto& producer : producers_) {
+        auto it = last_delivered.find(producer->producer_id_);
+        if (it != last_delivered.end()) {
+            producer->next_sequence_ = it->second + 1;
+        }
+    }
+}
+
 } // namespace MessageRouter
\ No newline at end of file
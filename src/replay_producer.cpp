@@ -0,0 +1,98 @@
+#include "../include/replay_producer.h"
+#include "../include/perf_counters.h"
+#include "../include/tsc_clock.h"
+#include <algorithm>
+
+namespace MessageRouter {
+
+ReplayProducer::ReplayProducer(const ReplayConfig& config,
+                               const std::vector<std::shared_ptr<MessageQueue>>& output_queues)
+    : config_(config)
+    , output_queues_(output_queues)
+    , reader_(config.file)
+    , running_(false)
+    , finished_(false)
+    , metrics_("replay") {
+}
+
+ReplayProducer::~ReplayProducer() {
+    stop();
+}
+
+void ReplayProducer::start() {
+    if (running_.load() || output_queues_.empty()) {
+        return;
+    }
+    running_.store(true);
+    finished_.store(false);
+    replay_thread_ = std::make_unique<std::thread>(&ReplayProducer::replay_loop, this);
+}
+
+void ReplayProducer::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    wait_for_completion();
+}
+
+void ReplayProducer::wait_for_completion() {
+    if (replay_thread_ && replay_thread_->joinable()) {
+        replay_thread_->join();
+    }
+}
+
+void ReplayProducer::replay_loop() {
+    ThreadPerf perf("producer");
+    reader_.rewind();
+
+    // speed <= 0 replays as fast as the pipeline accepts; otherwise the
+    // recorded inter-arrival gaps are scaled by 1 / speed
+    const bool paced = config_.speed > 0.0;
+    const double capture_ticks_to_local = paced
+        ? reader_.header().nanos_per_tick * TscClock::ticks_per_nano() / config_.speed : 0.0;
+    const uint64_t first_timestamp = reader_.header().first_timestamp;
+    // Captures interleave the producer queues, so timestamps are not
+    // monotonic; pace against the latest one seen, a late record goes at once
+    uint64_t capture_clock = first_timestamp;
+    const uint64_t start_time = TscClock::now();
+    const size_t queue_count = output_queues_.size();
+
+    Message message;
+    while (running_.load(std::memory_order_relaxed) && reader_.next(message)) {
+        if (paced) {
+            capture_clock = std::max(capture_clock, message.timestamp);
+            uint64_t due = start_time + static_cast<uint64_t>(
+                static_cast<double>(capture_clock - first_timestamp) * capture_ticks_to_local);
+            if (TscClock::now() < due) {
+                // Waiting for the recorded gap is idle time
+                perf.end_poll(false);
+                while (TscClock::now() < due) {
+                    if (!running_.load(std::memory_order_relaxed)) {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+                perf.begin_poll();
+            }
+        }
+
+        message.timestamp = TscClock::now();
+        message.processor_id = 0;
+        message.processing_timestamp = 0;
+
+        auto& queue = output_queues_[message.producer_id % queue_count];
+        while (!queue->try_push(message)) {
+            if (!running_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        metrics_->add(Metric::MessagesProduced);
+        perf.end_poll(true);
+    }
+
+    finished_.store(true);
+}
+
+} // namespace MessageRouter
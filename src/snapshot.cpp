@@ -0,0 +1,372 @@
+#include "../include/snapshot.h"
+#include "../include/tsc_clock.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+namespace {
+
+constexpr int kPollIntervalMs = 1;
+// An epoch whose marker was dropped on a full queue never completes
+constexpr uint64_t kSnapshotTimeoutMs = 5000;
+constexpr size_t kRouteTableBytes = 256 * sizeof(uint32_t);
+
+size_t align64(size_t offset) {
+    return (offset + 63) & ~size_t(63);
+}
+
+// Byte offsets of the sections following the header
+struct SnapshotLayout {
+    size_t stage1_routes;
+    size_t stage2_routes;
+    size_t producer_sequences;
+    size_t sequences;
+    size_t channel_state;
+    size_t file_bytes;
+
+    SnapshotLayout(uint32_t producer_count, uint64_t sequence_records, uint64_t channel_records) {
+        stage1_routes = sizeof(SnapshotHeader);
+        stage2_routes = stage1_routes + kRouteTableBytes;
+        producer_sequences = stage2_routes + kRouteTableBytes;
+        sequences = producer_sequences + producer_count * sizeof(SequenceNumber);
+        channel_state = align64(sequences + sequence_records * sizeof(SnapshotSequenceRecord));
+        file_bytes = channel_state + channel_records * sizeof(SnapshotChannelRecord);
+    }
+};
+
+void fill_routes(const SystemConfig& config, uint32_t* stage1_routes, uint32_t* stage2_routes) {
+    for (int msg_type = 0; msg_type < 256; ++msg_type) {
+        stage1_routes[msg_type] = config.get_processor_for_message(static_cast<MessageType>(msg_type));
+        stage2_routes[msg_type] = config.get_strategy_for_message(static_cast<MessageType>(msg_type));
+    }
+}
+
+} // namespace
+
+SnapshotBarrier::SnapshotBarrier(uint32_t stage, size_t inputs)
+    : stage_(stage)
+    , seen_(inputs, false)
+    , remaining_(0)
+    , epoch_(0)
+    , active_(false) {
+}
+
+bool SnapshotBarrier::on_marker(size_t input, uint64_t epoch) {
+    if (epoch < epoch_ || (epoch == epoch_ && !active_)) {
+        return false; // stale marker of an abandoned or finished epoch
+    }
+
+    bool opened = false;
+    if (epoch > epoch_) {
+        // A newer epoch supersedes one that never completed
+        epoch_ = epoch;
+        active_ = true;
+        std::fill(seen_.begin(), seen_.end(), false);
+        remaining_ = seen_.size();
+        channel_.clear();
+        opened = true;
+    }
+    if (!seen_[input]) {
+        seen_[input] = true;
+        --remaining_;
+    }
+    return opened;
+}
+
+void SnapshotBarrier::record(size_t input, const Message& message) {
+    channel_.push_back(SnapshotChannelRecord{stage_, static_cast<uint32_t>(input), message});
+}
+
+std::vector<SnapshotChannelRecord> SnapshotBarrier::take_channel_state() {
+    active_ = false;
+    return std::move(channel_);
+}
+
+SnapshotCoordinator::SnapshotCoordinator(const SystemConfig* config, uint64_t first_epoch)
+    : config_(config)
+    , interval_ticks_(TscClock::nanos_to_ticks(config->snapshot.interval_ms * 1000000))
+    , timeout_ticks_(TscClock::nanos_to_ticks(kSnapshotTimeoutMs * 1000000))
+    , next_epoch_(std::max<uint64_t>(first_epoch, 1))
+    , in_progress_(false)
+    , requested_epoch_(0)
+    , running_(false)
+    , snapshots_written_(0)
+    , snapshots_abandoned_(0)
+    , snapshots_failed_(0)
+    , last_epoch_(0)
+    , last_bytes_(0)
+    , last_channel_records_(0) {
+}
+
+SnapshotCoordinator::~SnapshotCoordinator() {
+    stop();
+}
+
+void SnapshotCoordinator::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+    snapshot_thread_ = std::make_unique<std::thread>(&SnapshotCoordinator::snapshot_loop, this);
+}
+
+void SnapshotCoordinator::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    wait_for_completion();
+}
+
+void SnapshotCoordinator::wait_for_completion() {
+    if (snapshot_thread_ && snapshot_thread_->joinable()) {
+        snapshot_thread_->join();
+    }
+}
+
+void SnapshotCoordinator::report_producer(ProducerId producer_id, uint64_t epoch, SequenceNumber last_sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!in_progress_ || epoch != pending_.epoch || producer_id >= pending_.producer_sequences.size()) {
+        return;
+    }
+    pending_.producer_sequences[producer_id] = last_sequence;
+    ++pending_.producers_reported;
+}
+
+void SnapshotCoordinator::report_channel_state(uint64_t epoch, std::vector<SnapshotChannelRecord>&& records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!in_progress_ || epoch != pending_.epoch) {
+        return;
+    }
+    pending_.channel_state.insert(pending_.channel_state.end(), records.begin(), records.end());
+    ++pending_.routers_reported;
+}
+
+void SnapshotCoordinator::report_strategy(StrategyId strategy_id, uint64_t epoch,
+                                          const std::map<std::pair<ProducerId, MessageType>, SequenceNumber>& expected_sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!in_progress_ || epoch != pending_.epoch) {
+        return;
+    }
+    for (const auto& [key, expected] : expected_sequence) {
+        SnapshotSequenceRecord record{};
+        record.strategy_id = strategy_id;
+        record.producer_id = key.first;
+        record.msg_type = key.second;
+        record.last_delivered = expected - 1;
+        pending_.sequences.push_back(record);
+    }
+    ++pending_.strategies_reported;
+}
+
+void SnapshotCoordinator::snapshot_loop() {
+    const size_t producer_count = static_cast<size_t>(config_->producers.count);
+    const size_t strategy_count = static_cast<size_t>(config_->strategies.count);
+    uint64_t next_due = TscClock::now() + interval_ticks_;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kPollIntervalMs));
+        uint64_t now = TscClock::now();
+
+        Pending completed;
+        bool write = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (in_progress_) {
+                if (pending_.producers_reported == producer_count && pending_.routers_reported == 2 &&
+                    pending_.strategies_reported == strategy_count) {
+                    completed = std::move(pending_);
+                    in_progress_ = false;
+                    write = true;
+                } else if (now - pending_.requested_at >= timeout_ticks_) {
+                    in_progress_ = false;
+                    snapshots_abandoned_.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else if (now >= next_due) {
+                pending_ = Pending();
+                pending_.epoch = next_epoch_++;
+                pending_.requested_at = now;
+                pending_.producer_sequences.assign(producer_count, 0);
+                in_progress_ = true;
+                requested_epoch_.store(pending_.epoch, std::memory_order_release);
+            }
+        }
+
+        if (write) {
+            // File I/O stays outside the lock the pipeline threads report under.
+            // A failed write loses only this epoch: the previous file stays in
+            // place and the next snapshot is cut on schedule.
+            try {
+                write_snapshot(completed);
+                snapshot_latency_.record(TscClock::now() - completed.requested_at);
+            } catch (const std::exception& e) {
+                snapshots_failed_.fetch_add(1, std::memory_order_relaxed);
+                std::cerr << "Snapshot epoch " << completed.epoch << " failed: " << e.what() << std::endl;
+            }
+            next_due = TscClock::now() + interval_ticks_;
+        }
+    }
+}
+
+void SnapshotCoordinator::write_snapshot(const Pending& pending) {
+    const std::string& path = config_->snapshot.file;
+    const std::string temp_path = path + ".tmp";
+    const SnapshotLayout layout(static_cast<uint32_t>(pending.producer_sequences.size()),
+                                pending.sequences.size(), pending.channel_state.size());
+
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create snapshot " + temp_path + ": " + std::strerror(errno));
+    }
+    if (::ftruncate(fd, static_cast<off_t>(layout.file_bytes)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot size snapshot " + temp_path + ": " + std::strerror(errno));
+    }
+    void* mapping = ::mmap(nullptr, layout.file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map snapshot " + temp_path + ": " + std::strerror(errno));
+    }
+    uint8_t* data = static_cast<uint8_t*>(mapping);
+
+    SnapshotHeader header{};
+    header.magic = SnapshotHeader::kMagic;
+    header.version = SnapshotHeader::kVersion;
+    header.producer_count = static_cast<uint32_t>(pending.producer_sequences.size());
+    header.epoch = pending.epoch;
+    header.processor_count = static_cast<uint32_t>(config_->processors.count);
+    header.strategy_count = static_cast<uint32_t>(config_->strategies.count);
+    header.sequence_records = pending.sequences.size();
+    header.channel_records = pending.channel_state.size();
+    header.file_bytes = layout.file_bytes;
+    std::memcpy(data, &header, sizeof(header));
+
+    fill_routes(*config_, reinterpret_cast<uint32_t*>(data + layout.stage1_routes),
+                reinterpret_cast<uint32_t*>(data + layout.stage2_routes));
+    std::memcpy(data + layout.producer_sequences, pending.producer_sequences.data(),
+                pending.producer_sequences.size() * sizeof(SequenceNumber));
+    std::memcpy(data + layout.sequences, pending.sequences.data(),
+                pending.sequences.size() * sizeof(SnapshotSequenceRecord));
+    std::memcpy(data + layout.channel_state, pending.channel_state.data(),
+                pending.channel_state.size() * sizeof(SnapshotChannelRecord));
+
+    int result = ::msync(data, layout.file_bytes, MS_SYNC);
+    ::munmap(data, layout.file_bytes);
+    if (result != 0 || ::rename(temp_path.c_str(), path.c_str()) != 0) {
+        const std::string error = std::strerror(errno);
+        ::unlink(temp_path.c_str());
+        throw std::runtime_error("Cannot write snapshot " + path + ": " + error);
+    }
+
+    snapshots_written_.fetch_add(1, std::memory_order_relaxed);
+    last_epoch_.store(pending.epoch, std::memory_order_relaxed);
+    last_bytes_.store(layout.file_bytes, std::memory_order_relaxed);
+    last_channel_records_.store(pending.channel_state.size(), std::memory_order_relaxed);
+}
+
+SnapshotImage::SnapshotImage(const uint8_t* data, size_t bytes)
+    : data_(data)
+    , bytes_(bytes)
+    , header_(reinterpret_cast<const SnapshotHeader*>(data)) {
+}
+
+SnapshotImage::~SnapshotImage() {
+    ::munmap(const_cast<uint8_t*>(data_), bytes_);
+}
+
+std::unique_ptr<SnapshotImage> SnapshotImage::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* mapping = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map snapshot " + path + ": " + std::strerror(errno));
+    }
+
+    std::unique_ptr<SnapshotImage> image(new SnapshotImage(static_cast<const uint8_t*>(mapping), bytes));
+    const SnapshotHeader& header = *image->header_;
+    if (header.magic != SnapshotHeader::kMagic || header.version != SnapshotHeader::kVersion ||
+        header.file_bytes != bytes ||
+        SnapshotLayout(header.producer_count, header.sequence_records, header.channel_records).file_bytes != bytes) {
+        return nullptr;
+    }
+    return image;
+}
+
+bool SnapshotImage::matches(const SystemConfig& config) const {
+    if (header_->producer_count != static_cast<uint32_t>(config.producers.count) ||
+        header_->processor_count != static_cast<uint32_t>(config.processors.count) ||
+        header_->strategy_count != static_cast<uint32_t>(config.strategies.count)) {
+        return false;
+    }
+    const SnapshotLayout layout(header_->producer_count, header_->sequence_records, header_->channel_records);
+    std::array<uint32_t, 256> stage1_routes;
+    std::array<uint32_t, 256> stage2_routes;
+    fill_routes(config, stage1_routes.data(), stage2_routes.data());
+    return std::memcmp(data_ + layout.stage1_routes, stage1_routes.data(), kRouteTableBytes) == 0 &&
+           std::memcmp(data_ + layout.stage2_routes, stage2_routes.data(), kRouteTableBytes) == 0;
+}
+
+std::map<ProducerId, SequenceNumber> SnapshotImage::producer_sequences() const {
+    const SnapshotLayout layout(header_->producer_count, header_->sequence_records, header_->channel_records);
+    std::map<ProducerId, SequenceNumber> sequences;
+    for (uint32_t i = 0; i < header_->producer_count; ++i) {
+        SequenceNumber last;
+        std::memcpy(&last, data_ + layout.producer_sequences + i * sizeof(SequenceNumber), sizeof(last));
+        sequences[i] = last;
+    }
+    return sequences;
+}
+
+std::vector<std::map<std::pair<ProducerId, MessageType>, SequenceNumber>> SnapshotImage::strategy_sequences() const {
+    const SnapshotLayout layout(header_->producer_count, header_->sequence_records, header_->channel_records);
+    std::vector<std::map<std::pair<ProducerId, MessageType>, SequenceNumber>> sequences(header_->strategy_count);
+    for (uint64_t i = 0; i < header_->sequence_records; ++i) {
+        SnapshotSequenceRecord record;
+        std::memcpy(&record, data_ + layout.sequences + i * sizeof(record), sizeof(record));
+        if (record.strategy_id < sequences.size()) {
+            sequences[record.strategy_id][{record.producer_id, record.msg_type}] = record.last_delivered;
+        }
+    }
+    return sequences;
+}
+
+ChannelRestore SnapshotImage::restore_channel_state(const std::vector<std::shared_ptr<MessageQueue>>& producer_queues,
+                                                    const std::vector<std::shared_ptr<MessageQueue>>& processor_queues) const {
+    const SnapshotLayout layout(header_->producer_count, header_->sequence_records, header_->channel_records);
+    const auto* records = reinterpret_cast<const SnapshotChannelRecord*>(data_ + layout.channel_state);
+    ChannelRestore result;
+    for (uint64_t i = 0; i < header_->channel_records; ++i) {
+        const auto& queues = records[i].stage == 1 ? producer_queues : processor_queues;
+        if (records[i].input < queues.size() && queues[records[i].input]->try_push(records[i].message)) {
+            ++result.restored;
+        } else {
+            ++result.dropped;
+        }
+    }
+    return result;
+}
+
+} // namespace MessageRouter
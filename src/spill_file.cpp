@@ -0,0 +1,155 @@
+#include "../include/spill_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace MessageRouter {
+
+SpillFile::SpillFile(const std::string& directory, const std::string& name, size_t max_bytes)
+    : path_((std::filesystem::path(directory) / (name + ".spill")).string())
+    , max_bytes_(max_bytes)
+    , fd_(-1)
+    , data_(nullptr)
+    , mapped_bytes_(0)
+    , read_pos_(0)
+    , write_pos_(0)
+    , pending_(0)
+    , messages_spilled_(0)
+    , messages_lost_(0)
+    , pending_count_(0)
+    , peak_bytes_(0)
+    , compactions_(0) {
+}
+
+SpillFile::~SpillFile() {
+    if (data_) {
+        ::munmap(data_, mapped_bytes_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void SpillFile::grow() {
+    if (fd_ < 0) {
+        std::filesystem::create_directories(std::filesystem::path(path_).parent_path());
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot create spill file " + path_ + ": " + std::strerror(errno));
+        }
+        ::unlink(path_.c_str());
+    }
+
+    size_t new_size = mapped_bytes_ + kGrowBytes;
+    if (::ftruncate(fd_, static_cast<off_t>(new_size)) != 0) {
+        throw std::runtime_error("Cannot extend spill file " + path_ + ": " + std::strerror(errno));
+    }
+    void* mapping = data_
+        ? ::mremap(data_, mapped_bytes_, new_size, MREMAP_MAYMOVE)
+        : ::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Cannot map spill file " + path_ + ": " + std::strerror(errno));
+    }
+    data_ = static_cast<uint8_t*>(mapping);
+    mapped_bytes_ = new_size;
+}
+
+bool SpillFile::spill(const Message& message) {
+    // max_bytes bounds the live backlog, not the bytes written since the
+    // file last emptied: a consumer that keeps up just behind keeps it small
+    if (write_pos_ - read_pos_ + sizeof(Message) > max_bytes_) {
+        messages_lost_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (read_pos_ != 0 && (write_pos_ + sizeof(Message) > max_bytes_ ||
+                           (read_pos_ >= kReclaimBytes && read_pos_ >= write_pos_ - read_pos_))) {
+        compact();
+    }
+    if (write_pos_ + sizeof(Message) > mapped_bytes_) {
+        grow();
+    }
+
+    std::memcpy(data_ + write_pos_, &message, sizeof(Message));
+    write_pos_ += sizeof(Message);
+    ++pending_;
+
+    messages_spilled_.fetch_add(1, std::memory_order_relaxed);
+    pending_count_.store(pending_, std::memory_order_relaxed);
+    const uint64_t backlog = write_pos_ - read_pos_;
+    if (backlog > peak_bytes_.load(std::memory_order_relaxed)) {
+        peak_bytes_.store(backlog, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void SpillFile::compact() {
+    // The unread tail is no larger than the drained prefix, so each byte is
+    // moved at most once per prefix it outlives
+    const size_t backlog = write_pos_ - read_pos_;
+    std::memmove(data_, data_ + read_pos_, backlog);
+    read_pos_ = 0;
+    write_pos_ = backlog;
+    compactions_.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t SpillFile::drain(MessageQueue& queue) {
+    size_t moved = 0;
+    while (pending_ != 0) {
+        Message message;
+        std::memcpy(&message, data_ + read_pos_, sizeof(Message));
+        if (!queue.try_push(message)) {
+            break;
+        }
+        read_pos_ += sizeof(Message);
+        --pending_;
+        ++moved;
+    }
+
+    if (moved) {
+        pending_count_.store(pending_, std::memory_order_relaxed);
+        if (pending_ == 0) {
+            reset();
+        }
+    }
+    return moved;
+}
+
+void SpillFile::collect_stats(SpillStats& out) const {
+    out.messages_spilled += messages_spilled_.load(std::memory_order_relaxed);
+    out.messages_lost += messages_lost_.load(std::memory_order_relaxed);
+    out.pending += pending_count_.load(std::memory_order_relaxed);
+    out.peak_bytes = std::max<uint64_t>(out.peak_bytes, peak_bytes_.load(std::memory_order_relaxed));
+    out.compactions += compactions_.load(std::memory_order_relaxed);
+}
+
+void SpillFile::reset() {
+    const bool reclaim = write_pos_ >= kReclaimBytes;
+    read_pos_ = 0;
+    write_pos_ = 0;
+    if (!reclaim) {
+        return;
+    }
+    
+    // Drop the drained pages without writing them back, and give back any
+    // growth beyond the first chunk
+    if (::ftruncate(fd_, 0) != 0) {
+        throw std::runtime_error("Cannot reset spill file " + path_ + ": " + std::strerror(errno));
+    }
+    if (mapped_bytes_ > kGrowBytes) {
+        void* mapping = ::mremap(data_, mapped_bytes_, kGrowBytes, 0);
+        if (mapping != MAP_FAILED) {
+            data_ = static_cast<uint8_t*>(mapping);
+            mapped_bytes_ = kGrowBytes;
+        }
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(mapped_bytes_)) != 0) {
+        throw std::runtime_error("Cannot reset spill file " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+} // namespace MessageRouter
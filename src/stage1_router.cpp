@@ -1,17 +1,43 @@
 #include "../include/stage1_router.h"
+#include "../include/perf_counters.h"
 #include <iostream>
 
 namespace MessageRouter {
 
+namespace {
+
+std::array<uint32_t, 256> processor_table(const SystemConfig& config) {
+    std::array<uint32_t, 256> destinations;
+    for (size_t msg_type = 0; msg_type < destinations.size(); ++msg_type) {
+        destinations[msg_type] = config.get_processor_for_message(static_cast<MessageType>(msg_type));
+    }
+    return destinations;
+}
+
+} // namespace
+
 Stage1Router::Stage1Router(const SystemConfig* config,
                            const std::vector<std::shared_ptr<MessageQueue>>& input_queues,
                            const std::vector<std::shared_ptr<MessageQueue>>& output_queues)
     : config_(config)
     , input_queues_(input_queues)
     , output_queues_(output_queues)
+    , input_capture_(nullptr)
+    , output_capture_(nullptr)
+    , snapshot_(nullptr)
+    , classifier_(processor_table(*config), output_queues.size())
+    , payloads_(nullptr)
+    , hop_tracer_(nullptr)
     , running_(false)
-    , messages_routed_(0)
-    , routing_errors_(0) {
+    , metrics_("stage1")
+    , trace_(config->trace.enabled, config->trace.records_per_thread, "stage1") {
+    if (config->overflow.enabled) {
+        for (size_t i = 0; i < output_queues_.size(); ++i) {
+            output_spills_.push_back(std::make_unique<SpillFile>(
+                config->overflow.directory, "stage1-processor-" + std::to_string(i),
+                config->overflow.max_bytes_per_edge));
+        }
+    }
 }
 
 Stage1Router::~Stage1Router() {
@@ -40,47 +66,189 @@ void Stage1Router::stop() {
 }
 
 void Stage1Router::routing_loop() {
-    Message message;
+    ThreadPerf perf("stage1");
+    Message batch[BatchClassifier::kBatchSize];
     bool found_message = false;
+    bool idle = false;
     
     while (running_.load()) {
+        perf.begin_poll();
         found_message = false;
         
         // Check all input queues (from producers)
-        for (auto& input_queue : input_queues_) {
-            while (input_queue->try_pop(message)) {
-                // Determine processor for this message type
-                ProcessorId processor_id = config_->get_processor_for_message(message.msg_type);
-                
-                // Send to corresponding processor with retries
-                if (processor_id < output_queues_.size()) {
-                    bool sent = false;
-                    for (int retry = 0; retry < 1000 && !sent; ++retry) {
-                        if (output_queues_[processor_id]->try_push(message)) {
-                            messages_routed_.fetch_add(1, std::memory_order_relaxed);
-                            sent = true;
-                        } else {
-                            // Queue full - small pause and retry
-                            std::this_thread::yield();
-                        }
+        for (size_t input = 0; input < input_queues_.size(); ++input) {
+            while (true) {
+                // Pop a batch; a snapshot marker ends it early so everything popped
+                // before the marker is routed before the marker is forwarded
+                size_t count = 0;
+                bool marker = false;
+                while (count < BatchClassifier::kBatchSize && input_queues_[input]->try_pop(batch[count])) {
+                    if (is_snapshot_marker(batch[count])) {
+                        marker = true;
+                        break;
                     }
-                    if (!sent) {
-                        routing_errors_.fetch_add(1, std::memory_order_relaxed);
-                    }
-                } else {
-                    routing_errors_.fetch_add(1, std::memory_order_relaxed);
+                    ++count;
+                }
+                if (count == 0 && !marker) {
+                    break;
                 }
                 
+                if (count > 0) {
+                    trace_.record(TraceEvent::BatchPopped, static_cast<uint32_t>(count));
+                    route_batch(input, batch, count);
+                }
+                if (marker) {
+                    handle_snapshot_marker(input, batch[count]);
+                }
                 found_message = true;
                 // Do NOT exit the loop - process all available messages
             }
         }
         
+        // Move spilled backlog into processor queues that have room again
+        for (size_t i = 0; i < output_spills_.size(); ++i) {
+            if (!output_spills_[i]->empty()) {
+                output_spills_[i]->drain(*output_queues_[i]);
+            }
+        }
+        
+        perf.end_poll(found_message);
         if (!found_message) {
             // All queues are empty - busy-waiting for minimal latency
+            if (!idle) {
+                trace_.record(TraceEvent::Idle);
+                idle = true;
+            }
             std::this_thread::yield();
+        } else {
+            idle = false;
         }
     }
 }
 
+void Stage1Router::route_batch(size_t input, const Message* batch, size_t count) {
+    if (hop_tracer_) {
+        hop_tracer_->stamp_stage1(batch, count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (snapshot_barrier_ && snapshot_barrier_->recording(input)) {
+            snapshot_barrier_->record(input, batch[i]);
+        }
+        if (input_capture_) {
+            input_capture_->append(batch[i]);
+        }
+    }
+    
+    // Group the batch by processor, then hand each processor its run at once
+    Message staging[BatchClassifier::kBatchSize];
+    uint16_t begin[BatchClassifier::kMaxGroups + 2];
+    classifier_.partition(batch, count, staging, begin);
+    
+    const size_t groups = classifier_.num_groups();
+    for (size_t group = 0; group < groups; ++group) {
+        const size_t run = begin[group + 1] - begin[group];
+        if (run == 0) {
+            continue;
+        }
+        const size_t sent = send_run(classifier_.group_output(group), staging + begin[group], run);
+        metrics_->add(Metric::MessagesRouted, sent, Metric::RoutingErrors, run - sent);
+    }
+    
+    // No rule maps these types to an existing processor
+    if (begin[groups] < count) {
+        metrics_->add(Metric::RoutingErrors, count - begin[groups]);
+        if (payloads_) {
+            for (size_t i = begin[groups]; i < count; ++i) {
+                payloads_->release(staging[i]);
+            }
+        }
+    }
+}
+
+size_t Stage1Router::send_run(size_t processor_id, const Message* run, size_t count) {
+    MessageQueue& queue = *output_queues_[processor_id];
+    size_t sent = 0;
+    if (!output_spills_.empty()) {
+        // Overflow mode: a full queue spills instead of retrying
+        for (size_t i = 0; i < count; ++i) {
+            if (output_spills_[processor_id]->offer(queue, run[i])) {
+                ++sent;
+                if (output_capture_) {
+                    output_capture_->append(run[i]);
+                }
+            } else if (payloads_) {
+                payloads_->release(run[i]);
+            }
+        }
+        return sent;
+    }
+    
+    int retry = 0;
+    while (retry < 1000 && sent < count) {
+        const size_t pushed = queue.try_push_batch(run + sent, count - sent);
+        if (pushed == 0) {
+            if (retry == 0) {
+                trace_.record(TraceEvent::QueueFull, static_cast<uint32_t>(processor_id));
+            }
+            // Queue full - small pause and retry
+            std::this_thread::yield();
+            ++retry;
+        }
+        sent += pushed;
+    }
+    if (retry > 0) {
+        trace_.record(TraceEvent::Retry, static_cast<uint32_t>(retry));
+    }
+    if (output_capture_) {
+        for (size_t i = 0; i < sent; ++i) {
+            output_capture_->append(run[i]);
+        }
+    }
+    if (payloads_) {
+        for (size_t i = sent; i < count; ++i) {
+            payloads_->release(run[i]);
+        }
+    }
+    return sent;
+}
+
+void Stage1Router::set_snapshot_coordinator(SnapshotCoordinator* snapshot) {
+    snapshot_ = snapshot;
+    snapshot_barrier_ = snapshot ? std::make_unique<SnapshotBarrier>(1, input_queues_.size()) : nullptr;
+}
+
+void Stage1Router::handle_snapshot_marker(size_t input, const Message& marker) {
+    if (!snapshot_barrier_) {
+        return;
+    }
+    if (snapshot_barrier_->on_marker(input, marker.sequence_number)) {
+        // First marker of the epoch: pass it on without waiting for the other inputs.
+        // A marker lost to a full queue leaves the epoch for the coordinator to abandon
+        for (size_t i = 0; i < output_queues_.size(); ++i) {
+            bool sent = false;
+            if (!output_spills_.empty()) {
+                sent = output_spills_[i]->offer(*output_queues_[i], marker);
+            } else {
+                for (int retry = 0; retry < 1000 && !sent; ++retry) {
+                    if (output_queues_[i]->try_push(marker)) {
+                        sent = true;
+                    } else {
+                        // Queue full - small pause and retry
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }
+    }
+    if (snapshot_barrier_->complete()) {
+        snapshot_->report_channel_state(snapshot_barrier_->epoch(), snapshot_barrier_->take_channel_state());
+    }
+}
+
+void Stage1Router::collect_spill_stats(SpillStats& out) const {
+    for (const auto& spill : output_spills_) {
+        spill->collect_stats(out);
+    }
+}
+
 } // namespace MessageRouter
\ No newline at end of file
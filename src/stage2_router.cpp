@@ -1,17 +1,52 @@
 #include "../include/stage2_router.h"
+#include "../include/perf_counters.h"
+#include <algorithm>
 #include <iostream>
 
 namespace MessageRouter {
 
+namespace {
+
+std::array<uint32_t, 256> strategy_table(const SystemConfig& config) {
+    std::array<uint32_t, 256> destinations;
+    for (size_t msg_type = 0; msg_type < destinations.size(); ++msg_type) {
+        destinations[msg_type] = config.get_strategy_for_message(static_cast<MessageType>(msg_type));
+    }
+    return destinations;
+}
+
+} // namespace
+
 Stage2Router::Stage2Router(const SystemConfig* config,
                            const std::vector<std::shared_ptr<MessageQueue>>& input_queues,
                            const std::vector<std::shared_ptr<MessageQueue>>& output_queues)
     : config_(config)
     , input_queues_(input_queues)
     , output_queues_(output_queues)
+    , input_capture_(nullptr)
+    , output_capture_(nullptr)
+    , snapshot_(nullptr)
+    , strategy_scheduler_(nullptr)
+    , classifier_(strategy_table(*config), output_queues.size())
+    , payloads_(nullptr)
+    , hop_tracer_(nullptr)
     , running_(false)
-    , messages_routed_(0)
-    , routing_errors_(0) {
+    , metrics_("stage2")
+    , trace_(config->trace.enabled, config->trace.records_per_thread, "stage2") {
+    if (config->overflow.enabled) {
+        for (size_t i = 0; i < output_queues_.size(); ++i) {
+            output_spills_.push_back(std::make_unique<SpillFile>(
+                config->overflow.directory, "stage2-strategy-" + std::to_string(i),
+                config->overflow.max_bytes_per_edge));
+        }
+    }
+    for (int msg_type = 0; msg_type < 256; ++msg_type) {
+        conflated_[msg_type] = config->is_conflated(static_cast<MessageType>(msg_type));
+    }
+    conflating_ = std::find(conflated_.begin(), conflated_.end(), true) != conflated_.end();
+    if (config->dedup.enabled) {
+        dedup_ = std::make_unique<DedupFilter>(config->dedup.max_keys);
+    }
 }
 
 Stage2Router::~Stage2Router() {
@@ -40,47 +75,229 @@ void Stage2Router::stop() {
 }
 
 void Stage2Router::routing_loop() {
-    Message message;
+    ThreadPerf perf("stage2");
+    Message batch[BatchClassifier::kBatchSize];
     bool found_message = false;
+    bool idle = false;
     
     while (running_.load()) {
+        perf.begin_poll();
         found_message = false;
         
         // Check all input queues (from processors)
-        for (auto& input_queue : input_queues_) {
-            while (input_queue->try_pop(message)) {
-                // Determine strategy for this message type
-                StrategyId strategy_id = config_->get_strategy_for_message(message.msg_type);
-                
-                // Send to corresponding strategy with retries
-                if (strategy_id < output_queues_.size()) {
-                    bool sent = false;
-                    for (int retry = 0; retry < 1000 && !sent; ++retry) {
-                        if (output_queues_[strategy_id]->try_push(message)) {
-                            messages_routed_.fetch_add(1, std::memory_order_relaxed);
-                            sent = true;
-                        } else {
-                            // Queue full - small pause and retry
-                            std::this_thread::yield();
-                        }
-                    }
-                    if (!sent) {
-                        routing_errors_.fetch_add(1, std::memory_order_relaxed);
+        for (size_t input = 0; input < input_queues_.size(); ++input) {
+            while (true) {
+                // Pop a batch; a snapshot marker ends it early so everything popped
+                // before the marker is routed before the marker is forwarded
+                size_t count = 0;
+                bool marker = false;
+                while (count < BatchClassifier::kBatchSize && input_queues_[input]->try_pop(batch[count])) {
+                    if (is_snapshot_marker(batch[count])) {
+                        marker = true;
+                        break;
                     }
-                } else {
-                    routing_errors_.fetch_add(1, std::memory_order_relaxed);
+                    ++count;
+                }
+                if (count == 0 && !marker) {
+                    break;
                 }
                 
+                if (count > 0) {
+                    trace_.record(TraceEvent::BatchPopped, static_cast<uint32_t>(count));
+                    route_batch(input, batch, count);
+                }
+                if (marker) {
+                    handle_snapshot_marker(input, batch[count]);
+                }
                 found_message = true;
                 // Do NOT exit the loop - process all available messages
             }
         }
         
+        // Move spilled backlog into strategy queues that have room again
+        for (size_t i = 0; i < output_spills_.size(); ++i) {
+            if (!output_spills_[i]->empty() && output_spills_[i]->drain(*output_queues_[i]) > 0 &&
+                strategy_scheduler_) {
+                strategy_scheduler_->notify(static_cast<StrategyId>(i));
+            }
+        }
+        
+        perf.end_poll(found_message);
         if (!found_message) {
             // All queues are empty - busy-waiting for minimal latency
+            if (!idle) {
+                trace_.record(TraceEvent::Idle);
+                idle = true;
+            }
+            std::this_thread::yield();
+        } else {
+            idle = false;
+        }
+    }
+}
+
+void Stage2Router::route_batch(size_t input, Message* batch, size_t count) {
+    if (hop_tracer_) {
+        hop_tracer_->stamp_stage2(batch, count);
+    }
+    if (snapshot_barrier_ || input_capture_ || dedup_ || conflating_) {
+        // Per-message pass for the optional features; keeps what still needs a queue
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const Message& message = batch[i];
+            if (snapshot_barrier_ && snapshot_barrier_->recording(input)) {
+                snapshot_barrier_->record(input, message);
+            }
+            if (input_capture_) {
+                input_capture_->append(message);
+            }
+            
+            // Resent or retried messages stop here, before any strategy sees them
+            if (dedup_ && !dedup_->accept(message)) {
+                if (payloads_) {
+                    payloads_->release(message);
+                }
+                continue;
+            }
+            
+            const StrategyId strategy_id = classifier_.destination(message.msg_type);
+            if (conflated_[message.msg_type] && strategy_id < conflation_tables_.size() &&
+                conflation_tables_[strategy_id] && conflation_tables_[strategy_id]->publish(message)) {
+                // Overwrote any update the strategy has not picked up yet
+                metrics_->add(Metric::MessagesRouted);
+                if (output_capture_) {
+                    output_capture_->append(message);
+                }
+                if (strategy_scheduler_) {
+                    strategy_scheduler_->notify(strategy_id);
+                }
+                continue;
+            }
+            
+            if (kept != i) {
+                batch[kept] = message;
+            }
+            ++kept;
+        }
+        count = kept;
+    }
+    
+    // Group the batch by strategy, then hand each strategy its run at once
+    Message staging[BatchClassifier::kBatchSize];
+    uint16_t begin[BatchClassifier::kMaxGroups + 2];
+    classifier_.partition(batch, count, staging, begin);
+    
+    const size_t groups = classifier_.num_groups();
+    for (size_t group = 0; group < groups; ++group) {
+        const size_t run = begin[group + 1] - begin[group];
+        if (run == 0) {
+            continue;
+        }
+        const size_t strategy_id = classifier_.group_output(group);
+        const size_t sent = send_run(strategy_id, staging + begin[group], run);
+        metrics_->add(Metric::MessagesRouted, sent, Metric::RoutingErrors, run - sent);
+        if (sent > 0 && strategy_scheduler_) {
+            strategy_scheduler_->notify(static_cast<StrategyId>(strategy_id));
+        }
+    }
+    
+    // No rule maps these types to an existing strategy
+    if (begin[groups] < count) {
+        metrics_->add(Metric::RoutingErrors, count - begin[groups]);
+        if (payloads_) {
+            for (size_t i = begin[groups]; i < count; ++i) {
+                payloads_->release(staging[i]);
+            }
+        }
+    }
+}
+
+size_t Stage2Router::send_run(size_t strategy_id, const Message* run, size_t count) {
+    MessageQueue& queue = *output_queues_[strategy_id];
+    size_t sent = 0;
+    if (!output_spills_.empty()) {
+        // Overflow mode: a full queue spills instead of retrying
+        for (size_t i = 0; i < count; ++i) {
+            if (output_spills_[strategy_id]->offer(queue, run[i])) {
+                ++sent;
+                if (output_capture_) {
+                    output_capture_->append(run[i]);
+                }
+            } else if (payloads_) {
+                payloads_->release(run[i]);
+            }
+        }
+        return sent;
+    }
+    
+    int retry = 0;
+    while (retry < 1000 && sent < count) {
+        const size_t pushed = queue.try_push_batch(run + sent, count - sent);
+        if (pushed == 0) {
+            if (retry == 0) {
+                trace_.record(TraceEvent::QueueFull, static_cast<uint32_t>(strategy_id));
+            }
+            // Queue full - small pause and retry
             std::this_thread::yield();
+            ++retry;
+        }
+        sent += pushed;
+    }
+    if (retry > 0) {
+        trace_.record(TraceEvent::Retry, static_cast<uint32_t>(retry));
+    }
+    if (output_capture_) {
+        for (size_t i = 0; i < sent; ++i) {
+            output_capture_->append(run[i]);
         }
     }
+    if (payloads_) {
+        for (size_t i = sent; i < count; ++i) {
+            payloads_->release(run[i]);
+        }
+    }
+    return sent;
+}
+
+void Stage2Router::set_snapshot_coordinator(SnapshotCoordinator* snapshot) {
+    snapshot_ = snapshot;
+    snapshot_barrier_ = snapshot ? std::make_unique<SnapshotBarrier>(2, input_queues_.size()) : nullptr;
+}
+
+void Stage2Router::handle_snapshot_marker(size_t input, const Message& marker) {
+    if (!snapshot_barrier_) {
+        return;
+    }
+    if (snapshot_barrier_->on_marker(input, marker.sequence_number)) {
+        // First marker of the epoch: pass it on without waiting for the other inputs
+        for (size_t i = 0; i < output_queues_.size(); ++i) {
+            bool sent = false;
+            if (!output_spills_.empty()) {
+                sent = output_spills_[i]->offer(*output_queues_[i], marker);
+            } else {
+                for (int retry = 0; retry < 1000 && !sent; ++retry) {
+                    if (output_queues_[i]->try_push(marker)) {
+                        sent = true;
+                    } else {
+                        // Queue full - small pause and retry
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            if (sent && strategy_scheduler_) {
+                strategy_scheduler_->notify(static_cast<StrategyId>(i));
+            }
+        }
+    }
+    if (snapshot_barrier_->complete()) {
+        snapshot_->report_channel_state(snapshot_barrier_->epoch(), snapshot_barrier_->take_channel_state());
+    }
+}
+
+void Stage2Router::collect_spill_stats(SpillStats& out) const {
+    for (const auto& spill : output_spills_) {
+        spill->collect_stats(out);
+    }
 }
 
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <signal.h>
+#include <atomic>
+#include <string>
+#include <exception>
+#include <cstdlib>
+#include "../include/static_pipeline.h"
+#include "../include/tsc_clock.h"
+#include "../include/latency_histogram.h"
+
+using namespace MessageRouter;
+
+// configs/baseline.json, fixed at compile time. Like message_router, the
+// pipeline only routes: processing_times_ns are not simulated.
+constexpr StaticTopology kBaselineTopology = [] {
+    StaticTopology topology;
+    topology.producers = 4;
+    topology.processors = 8;
+    topology.strategies = 8;
+    topology.msg_types = 4;
+    topology.stage1[0] = 0;
+    topology.stage1[1] = 1;
+    topology.stage1[2] = 2;
+    topology.stage1[3] = 3;
+    topology.stage2[0] = 0;
+    topology.stage2[1] = 1;
+    topology.stage2[2] = 2;
+    topology.stage2[3] = 0;
+    return topology;
+}();
+
+using BaselinePipeline = StaticPipeline<kBaselineTopology>;
+
+
+std::atomic<bool> g_running{true};
+
+
+void signal_handler(int signal) {
+    std::cout << "\nReceived signal " << signal << ", shutting down..." << std::endl;
+    g_running.store(false);
+}
+
+int main(int argc, char* argv[]) {
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+
+    if (argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " [duration_secs] [messages_per_sec]" << std::endl;
+        std::cerr << "Example: " << argv[0] << " 10 10000000" << std::endl;
+        return 1;
+    }
+
+    const int duration_secs = argc > 1 ? std::atoi(argv[1]) : 10;
+    const double messages_per_sec = argc > 2 ? std::atof(argv[2]) : 10000000.0;
+    if (duration_secs <= 0 || messages_per_sec <= 0) {
+        std::cerr << "Duration and rate must be positive" << std::endl;
+        return 1;
+    }
+
+    try {
+
+        std::cout << "Static pipeline (compile-time topology):" << std::endl;
+        std::cout << "  Scenario: baseline (routing only)" << std::endl;
+        std::cout << "  Duration: " << duration_secs << " seconds" << std::endl;
+        std::cout << "  Producers: " << BaselinePipeline::kProducers << " at " << messages_per_sec << " msg/s" << std::endl;
+        std::cout << "  Processors: " << BaselinePipeline::kProcessors << std::endl;
+        std::cout << "  Strategies: " << BaselinePipeline::kStrategies << std::endl;
+        std::cout << "  Timestamp clock: " << (TscClock::is_tsc() ? "invariant TSC" : "CLOCK_MONOTONIC") << std::endl;
+
+        auto pipeline = std::make_unique<BaselinePipeline>();
+
+        std::cout << "Starting system..." << std::endl;
+        auto start_time = std::chrono::steady_clock::now();
+        pipeline->start(messages_per_sec);
+
+
+        auto duration = std::chrono::seconds(duration_secs);
+        auto last_recalibration = start_time;
+
+        while (g_running.load()) {
+            auto current_time = std::chrono::steady_clock::now();
+
+            if (current_time - start_time >= duration) {
+                std::cout << "\nExecution time expired, shutting down..." << std::endl;
+                break;
+            }
+
+            // Keep the tick-to-nanosecond conversion tracking CLOCK_MONOTONIC
+            if (current_time - last_recalibration >= std::chrono::seconds(1)) {
+                TscClock::recalibrate();
+                last_recalibration = current_time;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        std::cout << "Stopping system..." << std::endl;
+        pipeline->stop();
+        const double elapsed_secs =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+
+        const uint64_t produced = pipeline->get_messages_produced();
+        const uint64_t delivered = pipeline->get_messages_delivered();
+
+        std::cout << "\n=== PERFORMANCE SUMMARY ===" << std::endl;
+        std::cout << "Scenario: baseline (static, routing only)" << std::endl;
+        std::cout << "Duration: " << std::fixed << std::setprecision(2) << elapsed_secs << " seconds"
+                  << std::defaultfloat << std::endl;
+        std::cout << "" << std::endl;
+        std::cout << "Message Statistics:" << std::endl;
+        std::cout << "  Total Produced:     " << produced << std::endl;
+        std::cout << "  Total Processed:    " << pipeline->get_messages_processed() << std::endl;
+        std::cout << "  Total Delivered:    " << delivered << std::endl;
+        std::cout << "  Messages Lost:      " << (produced - delivered) << std::endl;
+
+        LatencyHistogram latency;
+        pipeline->collect_latency(latency);
+        const double nanos_per_tick = 1.0 / TscClock::ticks_per_nano();
+        std::cout << "" << std::endl;
+        std::cout << "End-to-end Latency (microseconds):" << std::endl;
+        std::cout << "  p50: " << latency.value_at_percentile(50.0) * nanos_per_tick / 1000.0
+                  << "  p99: " << latency.value_at_percentile(99.0) * nanos_per_tick / 1000.0
+                  << "  p99.9: " << latency.value_at_percentile(99.9) * nanos_per_tick / 1000.0
+                  << "  max: " << latency.max() * nanos_per_tick / 1000.0 << std::endl;
+        std::cout << "" << std::endl;
+        std::cout << "Ordering Validation:" << std::endl;
+        for (size_t producer = 0; producer < BaselinePipeline::kProducers; ++producer) {
+            std::cout << "  Producer " << producer << ": " << pipeline->get_messages_produced(producer)
+                      << " messages" << std::endl;
+        }
+        std::cout << "  Violations: " << pipeline->get_ordering_violations() << std::endl;
+        std::cout << "" << std::endl;
+        const bool passed = produced == delivered && pipeline->get_ordering_violations() == 0;
+        std::cout << "Test Result: " << (passed ? "PASSED" : "FAILED") << std::endl;
+
+        std::cout << "\nSystem completed successfully." << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "../include/strategy.h"
+#include "../include/perf_counters.h"
+#include "../include/tsc_clock.h"
 #include <iostream>
 #include <chrono>
 #include <map>
@@ -7,6 +9,8 @@
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 namespace MessageRouter {
 
@@ -15,9 +19,19 @@ Strategy::Strategy(StrategyId id, const SystemConfig* config,
     : strategy_id_(id)
     , config_(config)
     , input_queue_(input_queue)
+    , output_queue_(nullptr)
+    , journal_(nullptr)
+    , journal_queue_(nullptr)
+    , journal_pushed_(0)
+    , journal_lost_(0)
+    , snapshot_(nullptr)
+    , payloads_(nullptr)
+    , hop_tracer_(nullptr)
     , running_(false)
-    , messages_delivered_(0)
-    , ordering_violations_(0) {
+    , metrics_("strategy-" + std::to_string(id))
+    , trace_(config->trace.enabled, config->trace.records_per_thread, "strategy-" + std::to_string(id))
+    , ttl_(config->ttl) {
+    awaiting_commit_.reserve(TtlPolicy::kBatchSize);
 }
 
 Strategy::~Strategy() {
@@ -46,40 +60,232 @@ void Strategy::stop() {
 }
 
 void Strategy::strategy_loop() {
-    Message message;
-    
+    ThreadPerf perf("strategy");
+    bool idle = false;
     while (running_.load()) {
+        perf.begin_poll();
         // Process ALL available messages from our SPSC queue
-        while (input_queue_->try_pop(message)) {
-            process_message(message);
+        const bool worked = drain_input(SIZE_MAX) > 0;
+        perf.end_poll(worked);
+        if (worked) {
+            idle = false;
+        } else if (!idle) {
+            trace_.record(TraceEvent::Idle);
+            idle = true;
         }
         
         // Queue is empty - busy-waiting for minimal latency
         std::this_thread::yield();
     }
+    
+    settle_uncommitted();
+    if (payload_releaser_) {
+        payload_releaser_->flush();
+    }
+}
+
+size_t Strategy::drain_input(size_t max_messages) {
+    Message batch[TtlPolicy::kBatchSize];
+    uint8_t expired[TtlPolicy::kBatchSize];
+    size_t drained = 0;
+    
+    // Nothing else is delivered while sync outputs wait for the journal, so
+    // no later message of their (producer, type) can overtake them
+    if (!release_committed()) {
+        return 0;
+    }
+    
+    while (drained < max_messages) {
+        // Drain a batch so expiry is decided for all of it at once
+        const size_t limit = std::min(TtlPolicy::kBatchSize, max_messages - drained);
+        size_t count = 0;
+        while (count < limit && input_queue_->try_pop(batch[count])) {
+            ++count;
+        }
+        if (count == 0) {
+            break;
+        }
+        trace_.record(TraceEvent::BatchPopped, static_cast<uint32_t>(count));
+        
+        size_t stale = ttl_.enabled() ? ttl_.mark_expired(batch, count, TscClock::now(), expired) : 0;
+        if (stale > 0) {
+            metrics_->add(Metric::MessagesExpired, stale);
+        }
+        
+        for (size_t i = 0; i < count; ++i) {
+            if (stale > 0 && expired[i]) {
+                // Skipped on purpose, not reordered: keep the ordering check in step
+                advance_sequence(batch[i]);
+                if (payload_releaser_) {
+                    payload_releaser_->release(batch[i]);
+                }
+            } else {
+                process_message(batch[i]);
+            }
+        }
+        drained += count;
+        // One commit covers every sync message of the batch
+        if (!release_committed()) {
+            break;
+        }
+    }
+    
+    // Hand consumed bodies back before going idle
+    if (payload_releaser_) {
+        payload_releaser_->flush();
+    }
+    
+    if (conflation_ && drained < max_messages && !awaiting_commit()) {
+        drained += conflation_->drain(max_messages - drained, [this](const Message& message) {
+            // Conflation skips superseded sequences on purpose
+            advance_sequence(message);
+            deliver(message);
+        });
+        release_committed();
+    }
+    
+    return drained;
 }
 
 void Strategy::process_message(const Message& message) {
-    // Simplified ordering check for maximum performance
+    if (is_snapshot_marker(message)) {
+        // Everything before the marker has been delivered: this is our cut
+        if (snapshot_) {
+            snapshot_->report_strategy(strategy_id_, message.sequence_number, expected_sequence_);
+        }
+        return;
+    }
+    
+    if (!advance_sequence(message)) {
+        // Ordering violation - mark but do not block
+        metrics_->add(Metric::OrderingViolations);
+        trace_.record(TraceEvent::OrderingViolation, message.producer_id);
+    }
+    
+    deliver(message);
+}
+
+void Strategy::deliver(const Message& message) {
+    // Simulate strategy processing
+    simulate_strategy_processing();
+    if (payloads_) {
+        consume_payload(message);
+    }
+    
+    if (journal_queue_ && journal_->is_journaled(message.msg_type)) {
+        if (journal_->is_sync(message.msg_type)) {
+            // Write-ahead: the output waits for the record to be durable. A
+            // message of the same (producer, type) is never completed ahead
+            // of this one, since the type is sync for all of them.
+            if (awaiting_commit_.empty() && journal_->get_committed(strategy_id_) == journal_pushed_) {
+                // Every earlier record is settled: a loss from here on hits the held records
+                journal_lost_ = journal_->get_lost(strategy_id_);
+            }
+            if (journal_message(message)) {
+                awaiting_commit_.push_back(message);
+                return;
+            }
+        } else {
+            journal_message(message);
+        }
+    }
+    
+    complete_delivery(message);
+}
+
+void Strategy::complete_delivery(const Message& message) {
+    uint64_t now = TscClock::now();
+    latency_.record(now > message.timestamp ? now - message.timestamp : 0);
+    if (hop_tracer_ && hop_tracer_->sampled(message)) {
+        hop_tracer_->complete(strategy_id_, message, now);
+    }
+    
+    if (output_queue_) {
+        emit_output(message);
+    }
+    
+    metrics_->add(Metric::MessagesDelivered);
+}
+
+bool Strategy::release_committed() {
+    if (awaiting_commit_.empty()) {
+        return true;
+    }
+    if (journal_->get_committed(strategy_id_) < journal_pushed_) {
+        return false;
+    }
+    const uint64_t lost = journal_->get_lost(strategy_id_);
+    if (lost != journal_lost_) {
+        // The watermark does not say which records were lost: none of the
+        // held outputs may go out without a durable record. Records pushed
+        // since the last settled point are counted too, so this may also
+        // withhold outputs whose own record is durable.
+        journal_lost_ = lost;
+        metrics_->add(Metric::SyncWithheld, awaiting_commit_.size());
+        awaiting_commit_.clear();
+        return true;
+    }
+    for (const Message& message : awaiting_commit_) {
+        complete_delivery(message);
+    }
+    awaiting_commit_.clear();
+    return true;
+}
+
+void Strategy::settle_uncommitted() {
+    // Strategies stop before the journal, so it may still commit these
+    // records; their outputs just never go out, as after a crash
+    if (!release_committed()) {
+        metrics_->add(Metric::SyncWithheld, awaiting_commit_.size());
+        awaiting_commit_.clear();
+    }
+}
+
+bool Strategy::advance_sequence(const Message& message) {
+    // Sequence numbers count per producer across all types, so each
+    // (producer, type) stream has gaps and only has to keep moving forward
     auto key = std::make_pair(message.producer_id, message.msg_type);
     auto it = expected_sequence_.find(key);
     
     if (it == expected_sequence_.end()) {
         // First message from this producer and type
         expected_sequence_[key] = message.sequence_number + 1;
-    } else {
-        // Simple ordering check
-        if (message.sequence_number != it->second) {
-            // Ordering violation - mark but do not block
-            ordering_violations_.fetch_add(1);
-        }
-        it->second = message.sequence_number + 1;
+        return true;
     }
     
-    // Simulate strategy processing
-    simulate_strategy_processing();
+    if (message.sequence_number < it->second) {
+        return false;
+    }
+    it->second = message.sequence_number + 1;
+    return true;
+}
+
+void Strategy::emit_output(const Message& message) {
+    auto fill = [&](EgressRecord& record) {
+        record.sequence_number = message.sequence_number;
+        record.timestamp = message.timestamp;
+        record.output_timestamp = TscClock::now();
+        record.producer_id = message.producer_id;
+        record.strategy_id = static_cast<uint16_t>(strategy_id_);
+        record.msg_type = message.msg_type;
+        record.reserved = 0;
+    };
     
-    messages_delivered_.fetch_add(1, std::memory_order_relaxed);
+    for (int retry = 0; retry < 1000; ++retry) {
+        if (output_queue_->try_push_with(fill)) {
+            if (retry > 0) {
+                trace_.record(TraceEvent::Retry, static_cast<uint32_t>(retry));
+            }
+            return;
+        }
+        if (retry == 0) {
+            trace_.record(TraceEvent::QueueFull, static_cast<uint32_t>(strategy_id_));
+        }
+        // Egress is behind - small pause and retry
+        std::this_thread::yield();
+    }
+    trace_.record(TraceEvent::Retry, 1000);
+    metrics_->add(Metric::OutputsDropped);
 }
 
 void Strategy::simulate_strategy_processing() {
@@ -87,6 +293,47 @@ void Strategy::simulate_strategy_processing() {
     // In a real system, strategy logic would be here
 }
 
+void Strategy::consume_payload(const Message& message) {
+    const uint8_t* body = payloads_->data(message);
+    if (body && !check_payload(body, message.payload_size, message.sequence_number)) {
+        metrics_->add(Metric::PayloadMismatches);
+    }
+    payload_releaser_->release(message);
+}
+
+bool Strategy::journal_message(const Message& message) {
+    auto fill = [&](JournalRecord& record) {
+        record.sequence_number = message.sequence_number;
+        record.timestamp = message.timestamp;
+        record.producer_id = message.producer_id;
+        record.strategy_id = strategy_id_;
+        record.msg_type = message.msg_type;
+        std::memset(record.reserved, 0, sizeof(record.reserved));
+        record.checksum = Journal::checksum(record);
+    };
+    
+    const bool sync = journal_->is_sync(message.msg_type);
+    int retries = 0;
+    while (!journal_queue_->try_push_with(fill)) {
+        // A sync record is given up on only once the journal has stopped:
+        // its output is what waits for it
+        if (sync ? !journal_->is_running() : ++retries == 1000) {
+            metrics_->add(Metric::JournalDropped);
+            return false;
+        }
+        // Journal is behind - small pause and retry
+        std::this_thread::yield();
+    }
+    ++journal_pushed_;
+    return true;
+}
+
+void Strategy::restore_sequences(const std::map<std::pair<ProducerId, MessageType>, SequenceNumber>& last_delivered) {
+    for (const auto& [key, sequence] : last_delivered) {
+        expected_sequence_[key] = sequence + 1;
+    }
+}
+
 StrategyManager::StrategyManager(const SystemConfig* config,
                                const std::vector<std::shared_ptr<MessageQueue>>& input_queues)
     : config_(config)
@@ -97,6 +344,20 @@ StrategyManager::StrategyManager(const SystemConfig* config,
         auto input_queue = input_queues[i]; // Each strategy has its own input queue
         strategies_.push_back(std::make_unique<Strategy>(i, config, input_queue));
     }
+    
+    for (const auto& rule : config->stage2_rules) {
+        if (rule.conflate && rule.strategy < strategies_.size() && !strategies_[rule.strategy]->conflation_) {
+            strategies_[rule.strategy]->conflation_ = std::make_unique<ConflationTable>(config->strategies.conflation_keys);
+        }
+    }
+    
+    if (config->strategies.scheduler_threads > 0) {
+        std::vector<Strategy*> scheduled;
+        for (auto& strategy : strategies_) {
+            scheduled.push_back(strategy.get());
+        }
+        scheduler_ = std::make_unique<StrategyScheduler>(config->strategies.scheduler_threads, scheduled);
+    }
 }
 
 StrategyManager::~StrategyManager() {
@@ -104,18 +365,30 @@ StrategyManager::~StrategyManager() {
 }
 
 void StrategyManager::start_all() {
+    if (scheduler_) {
+        scheduler_->start();
+        return;
+    }
     for (auto& strategy : strategies_) {
         strategy->start();
     }
 }
 
 void StrategyManager::stop_all() {
+    if (scheduler_) {
+        scheduler_->stop();
+        return;
+    }
     for (auto& strategy : strategies_) {
         strategy->stop();
     }
 }
 
 void StrategyManager::wait_for_completion() {
+    if (scheduler_) {
+        scheduler_->wait_for_completion();
+        return;
+    }
     for (auto& strategy : strategies_) {
         if (strategy->strategy_thread_ && strategy->strategy_thread_->joinable()) {
             strategy->strategy_thread_->join();
@@ -139,4 +412,103 @@ uint64_t StrategyManager::get_total_ordering_violations() const {
     return total;
 }
 
+uint64_t StrategyManager::get_total_messages_expired() const {
+    uint64_t total = 0;
+    for (const auto& strategy : strategies_) {
+        total += strategy->get_messages_expired();
+    }
+    return total;
+}
+
+uint64_t StrategyManager::get_total_outputs_dropped() const {
+    uint64_t total = 0;
+    for (const auto& strategy : strategies_) {
+        total += strategy->get_outputs_dropped();
+    }
+    return total;
+}
+
+void StrategyManager::set_egress(EgressStage* egress) {
+    for (auto& strategy : strategies_) {
+        strategy->output_queue_ = egress ? egress->get_input_queue(strategy->strategy_id_) : nullptr;
+    }
+}
+
+uint64_t StrategyManager::get_total_journal_dropped() const {
+    uint64_t total = 0;
+    for (const auto& strategy : strategies_) {
+        total += strategy->get_journal_dropped();
+    }
+    return total;
+}
+
+uint64_t StrategyManager::get_total_sync_withheld() const {
+    uint64_t total = 0;
+    for (const auto& strategy : strategies_) {
+        total += strategy->get_sync_withheld();
+    }
+    return total;
+}
+
+void StrategyManager::set_journal(Journal* journal) {
+    for (auto& strategy : strategies_) {
+        strategy->journal_ = journal;
+        strategy->journal_queue_ = journal ? journal->get_input_queue(strategy->strategy_id_) : nullptr;
+    }
+}
+
+void StrategyManager::set_snapshot_coordinator(SnapshotCoordinator* snapshot) {
+    for (auto& strategy : strategies_) {
+        strategy->snapshot_ = snapshot;
+    }
+}
+
+void StrategyManager::restore_sequences(
+    const std::vector<std::map<std::pair<ProducerId, MessageType>, SequenceNumber>>& last_delivered) {
+    for (size_t i = 0; i < strategies_.size() && i < last_delivered.size(); ++i) {
+        strategies_[i]->restore_sequences(last_delivered[i]);
+    }
+}
+
+void StrategyManager::set_payload_arenas(PayloadArenas* arenas) {
+    for (auto& strategy : strategies_) {
+        strategy->payloads_ = arenas;
+        strategy->payload_releaser_ = std::make_unique<PayloadReleaser>(*arenas);
+    }
+}
+
+void StrategyManager::set_hop_tracer(HopTracer* tracer) {
+    for (auto& strategy : strategies_) {
+        strategy->hop_tracer_ = tracer;
+    }
+}
+
+void StrategyManager::collect_payload_stats(PayloadStats& out) const {
+    for (const auto& strategy : strategies_) {
+        out.mismatches += strategy->get_payload_mismatches();
+    }
+}
+
+void StrategyManager::collect_conflation_stats(ConflationStats& out) const {
+    for (const auto& strategy : strategies_) {
+        if (strategy->conflation_) {
+            strategy->conflation_->collect_stats(out);
+        }
+    }
+}
+
+std::vector<ConflationTable*> StrategyManager::get_conflation_tables() const {
+    std::vector<ConflationTable*> tables;
+    for (const auto& strategy : strategies_) {
+        tables.push_back(strategy->conflation_.get());
+    }
+    return tables;
+}
+
+void StrategyManager::collect_latency(LatencyHistogram& out) const {
+    for (const auto& strategy : strategies_) {
+        out.merge_from(strategy->get_latency());
+    }
+}
+
 } // namespace MessageRouter
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "../include/strategy_scheduler.h"
+#include "../include/perf_counters.h"
+#include "../include/strategy.h"
+#include <algorithm>
+
+namespace MessageRouter {
+
+StrategyTask& StrategyTask::operator=(StrategyTask&& other) noexcept {
+    if (this != &other) {
+        if (handle_) {
+            handle_.destroy();
+        }
+        handle_ = other.handle_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
+
+StrategyTask::~StrategyTask() {
+    if (handle_) {
+        handle_.destroy();
+    }
+}
+
+StrategyScheduler::StrategyScheduler(size_t worker_count, const std::vector<Strategy*>& strategies)
+    : running_(false) {
+    worker_count = std::max<size_t>(1, std::min(worker_count, std::max<size_t>(1, strategies.size())));
+
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+
+    // Round-robin strategies over workers; each worker owns its slots
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        auto slot = std::make_unique<Slot>();
+        slot->strategy = strategies[i];
+        slot->worker = i % worker_count;
+        slot->local_index = workers_[slot->worker]->slots.size();
+        workers_[slot->worker]->slots.push_back(slot.get());
+        slots_.push_back(std::move(slot));
+    }
+
+    for (auto& worker : workers_) {
+        worker->ready_words = (worker->slots.size() + 63) / 64;
+        worker->ready = std::make_unique<std::atomic<uint64_t>[]>(worker->ready_words);
+        for (size_t w = 0; w < worker->ready_words; ++w) {
+            worker->ready[w].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+StrategyScheduler::~StrategyScheduler() {
+    stop();
+}
+
+void StrategyScheduler::start() {
+    if (running_.load()) {
+        return;
+    }
+    running_.store(true);
+
+    // Fresh coroutines start suspended and ready, so every strategy
+    // drains whatever is already queued on the first round
+    for (auto& slot : slots_) {
+        slot->parked.store(false, std::memory_order_relaxed);
+        slot->task = run_strategy(slot.get());
+        mark_ready(*slot);
+    }
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::make_unique<std::thread>(&StrategyScheduler::worker_loop, this, i);
+    }
+}
+
+void StrategyScheduler::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    running_.store(false);
+    wait_for_completion();
+}
+
+void StrategyScheduler::wait_for_completion() {
+    for (auto& worker : workers_) {
+        if (worker->thread && worker->thread->joinable()) {
+            worker->thread->join();
+        }
+    }
+}
+
+StrategyTask StrategyScheduler::run_strategy(Slot* slot) {
+    Worker& worker = *workers_[slot->worker];
+
+    while (running_.load(std::memory_order_relaxed)) {
+        size_t drained = slot->strategy->drain_input(kBatchBudget);
+
+        if (drained == kBatchBudget || slot->strategy->awaiting_commit()) {
+            // Still busy, or sync outputs wait for a group commit - stay
+            // ready but let the other strategies on this worker run
+            mark_ready(*slot);
+            co_await SuspendAwaiter{};
+            continue;
+        }
+
+        if (park(*slot)) {
+            worker.parks.fetch_add(1, std::memory_order_relaxed);
+            slot->strategy->trace_.record(TraceEvent::Park);
+            co_await SuspendAwaiter{};
+            slot->strategy->trace_.record(TraceEvent::Unpark);
+        }
+    }
+    slot->strategy->settle_uncommitted();
+}
+
+bool StrategyScheduler::park(Slot& slot) {
+    slot.parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Re-check after publishing the parked flag to avoid a lost wakeup
+    if (!slot.strategy->input_empty()) {
+        if (slot.parked.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+        // notify() already won the flag and marked us ready - suspend and
+        // get resumed on the next scheduling round
+    }
+    return true;
+}
+
+void StrategyScheduler::worker_loop(size_t worker_index) {
+    ThreadPerf perf("strategy");
+    Worker& worker = *workers_[worker_index];
+
+    while (running_.load(std::memory_order_relaxed)) {
+        perf.begin_poll();
+        bool resumed_any = false;
+
+        for (size_t w = 0; w < worker.ready_words; ++w) {
+            if (worker.ready[w].load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            uint64_t bits = worker.ready[w].exchange(0, std::memory_order_acquire);
+
+            while (bits) {
+                size_t bit = __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                auto handle = worker.slots[(w << 6) + bit]->task.handle();
+                if (handle && !handle.done()) {
+                    handle.resume();
+                    worker.resumes.fetch_add(1, std::memory_order_relaxed);
+                    resumed_any = true;
+                }
+            }
+        }
+
+        perf.end_poll(resumed_any);
+        if (!resumed_any) {
+            // Every strategy on this worker is parked
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint64_t StrategyScheduler::get_total_resumes() const {
+    uint64_t total = 0;
+    for (const auto& worker : workers_) {
+        total += worker->resumes.load();
+    }
+    return total;
+}
+
+uint64_t StrategyScheduler::get_total_parks() const {
+    uint64_t total = 0;
+    for (const auto& worker : workers_) {
+        total += worker->parks.load();
+    }
+    return total;
+}
+
+} // namespace MessageRouter
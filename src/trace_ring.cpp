@@ -0,0 +1,186 @@
+#include "../include/trace_ring.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace MessageRouter {
+
+namespace {
+
+// Chrome trace timestamps are microseconds
+std::string trace_micros(uint64_t tsc, uint64_t base_nanos) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f", (TscClock::to_nanos(tsc) - base_nanos) / 1000.0);
+    return text;
+}
+
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+TraceRing::TraceRing(size_t capacity) {
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    slots_ = std::make_unique<Slot[]>(slots);
+    mask_ = slots - 1;
+}
+
+void TraceRing::collect(std::vector<TraceRecord>& out) const {
+    const uint64_t capacity = mask_ + 1;
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t first = head > capacity ? head - capacity : 0;
+
+    const size_t start = out.size();
+    for (uint64_t i = first; i < head; ++i) {
+        const Slot& slot = slots_[i & mask_];
+        const uint64_t word = slot.word.load(std::memory_order_relaxed);
+        out.push_back(TraceRecord{slot.tsc.load(std::memory_order_relaxed), static_cast<uint32_t>(word),
+                                  static_cast<TraceEvent>(word >> 32)});
+    }
+
+    // The owner may have lapped the oldest slots while they were copied,
+    // including the one it is writing now; drop those
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t after = head_.load(std::memory_order_relaxed);
+    const uint64_t stable = after >= capacity ? after - capacity + 1 : 0;
+    if (stable > first) {
+        const size_t lost = static_cast<size_t>(std::min(stable, head) - first);
+        out.erase(out.begin() + start, out.begin() + start + lost);
+    }
+}
+
+TraceRegistry& TraceRegistry::instance() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+TraceRing* TraceRegistry::register_thread(std::string thread, size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back(Entry{std::move(thread), std::make_unique<TraceRing>(capacity)});
+    return entries_.back().ring.get();
+}
+
+void TraceRegistry::unregister_thread(const TraceRing* ring) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [ring](const Entry& entry) { return entry.ring.get() == ring; }),
+                   entries_.end());
+}
+
+size_t TraceRegistry::write_chrome_trace(const std::string& path) const {
+    std::vector<std::vector<TraceRecord>> records;
+    std::vector<std::string> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : entries_) {
+            threads.push_back(entry.thread);
+            records.emplace_back();
+            entry.ring->collect(records.back());
+        }
+    }
+
+    uint64_t base_tsc = UINT64_MAX;
+    for (const auto& ring : records) {
+        if (!ring.empty()) {
+            base_tsc = std::min(base_tsc, ring.front().tsc);
+        }
+    }
+    const uint64_t base_nanos = base_tsc == UINT64_MAX ? 0 : TscClock::to_nanos(base_tsc);
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("cannot write trace file " + path);
+    }
+
+    size_t events = 0;
+    bool first_event = true;
+    auto emit = [&](const std::string& event) {
+        out << (first_event ? "\n" : ",\n") << event;
+        first_event = false;
+        ++events;
+    };
+    auto slice = [&](size_t tid, const char* name, uint64_t begin, uint64_t end, const std::string& args) {
+        const double duration = (TscClock::to_nanos(end) - TscClock::to_nanos(begin)) / 1000.0;
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.3f", duration);
+        emit("{\"name\":\"" + std::string(name) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(tid) +
+             ",\"ts\":" + trace_micros(begin, base_nanos) + ",\"dur\":" + text + ",\"args\":{" + args + "}}");
+    };
+    auto instant = [&](size_t tid, const char* name, uint64_t tsc, const std::string& args) {
+        emit("{\"name\":\"" + std::string(name) + "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" +
+             std::to_string(tid) + ",\"ts\":" + trace_micros(tsc, base_nanos) + ",\"args\":{" + args + "}}");
+    };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (size_t tid = 0; tid < records.size(); ++tid) {
+        emit("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(tid) +
+             ",\"args\":{\"name\":\"" + json_escape(threads[tid]) + "\"}}");
+
+        // Begin/end pairs become slices; an end whose begin fell off the ring is dropped
+        const TraceRecord* full = nullptr;
+        const TraceRecord* idle = nullptr;
+        const TraceRecord* parked = nullptr;
+        for (const TraceRecord& record : records[tid]) {
+            if (idle && record.event != TraceEvent::Idle) {
+                slice(tid, "idle", idle->tsc, record.tsc, "");
+                idle = nullptr;
+            }
+            switch (record.event) {
+                case TraceEvent::BatchPopped:
+                    instant(tid, "batch", record.tsc, "\"messages\":" + std::to_string(record.arg));
+                    break;
+                case TraceEvent::QueueFull:
+                    full = &record;
+                    break;
+                case TraceEvent::Retry:
+                    if (full) {
+                        slice(tid, "queue full", full->tsc, record.tsc, "\"output\":" + std::to_string(full->arg) +
+                              ",\"retries\":" + std::to_string(record.arg));
+                        full = nullptr;
+                    }
+                    break;
+                case TraceEvent::Idle:
+                    if (!idle) {
+                        idle = &record;
+                    }
+                    break;
+                case TraceEvent::Park:
+                    parked = &record;
+                    break;
+                case TraceEvent::Unpark:
+                    if (parked) {
+                        slice(tid, "parked", parked->tsc, record.tsc, "");
+                        parked = nullptr;
+                    }
+                    break;
+                case TraceEvent::ReorderHold:
+                    instant(tid, "reorder hold", record.tsc, "\"held\":" + std::to_string(record.arg));
+                    break;
+                case TraceEvent::OrderingViolation:
+                    instant(tid, "ordering violation", record.tsc, "\"producer\":" + std::to_string(record.arg));
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        throw std::runtime_error("cannot write trace file " + path);
+    }
+    return events;
+}
+
+} // namespace MessageRouter
\ No newline at end of file
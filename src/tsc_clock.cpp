@@ -0,0 +1,126 @@
+#include "../include/tsc_clock.h"
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace MessageRouter {
+
+namespace {
+
+constexpr uint64_t kInitialCalibrationNanos = 5000000; // 5 ms
+
+} // namespace
+
+// Constant-initialized, so they are usable during the dynamic init of use_tsc_
+std::atomic<uint32_t> TscClock::seq_{0};
+std::atomic<uint64_t> TscClock::base_ticks_{0};
+std::atomic<uint64_t> TscClock::base_nanos_{0};
+std::atomic<double> TscClock::nanos_per_tick_{1.0};
+
+uint64_t TscClock::epoch_ticks_ = 0;
+uint64_t TscClock::epoch_nanos_ = 0;
+
+// Initial calibration runs at static-init time, before any pipeline thread
+const bool TscClock::use_tsc_ = TscClock::initialize();
+
+bool TscClock::initialize() {
+    if (!detect_invariant_tsc()) {
+        return false;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    epoch_ticks_ = __rdtsc();
+    epoch_nanos_ = monotonic_nanos();
+
+    uint64_t nanos;
+    do {
+        nanos = monotonic_nanos();
+    } while (nanos - epoch_nanos_ < kInitialCalibrationNanos);
+    uint64_t ticks = __rdtsc();
+
+    base_ticks_.store(ticks, std::memory_order_relaxed);
+    base_nanos_.store(nanos, std::memory_order_relaxed);
+    nanos_per_tick_.store(static_cast<double>(nanos - epoch_nanos_) /
+                          static_cast<double>(ticks - epoch_ticks_), std::memory_order_relaxed);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TscClock::detect_invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) && eax >= 0x80000007) {
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return (edx & (1u << 8)) != 0;
+    }
+#endif
+    return false;
+}
+
+uint64_t TscClock::monotonic_nanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint64_t TscClock::to_nanos(uint64_t ticks) {
+    if (!use_tsc_) {
+        return ticks;
+    }
+
+    uint32_t seq;
+    uint64_t base_ticks;
+    uint64_t base_nanos;
+    double nanos_per_tick;
+    do {
+        seq = seq_.load(std::memory_order_acquire);
+        base_ticks = base_ticks_.load(std::memory_order_relaxed);
+        base_nanos = base_nanos_.load(std::memory_order_relaxed);
+        nanos_per_tick = nanos_per_tick_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != seq_.load(std::memory_order_relaxed));
+
+    double delta = static_cast<double>(static_cast<int64_t>(ticks - base_ticks)) * nanos_per_tick;
+    return base_nanos + static_cast<int64_t>(delta);
+}
+
+uint64_t TscClock::nanos_to_ticks(uint64_t nanos) {
+    if (!use_tsc_) {
+        return nanos;
+    }
+    return static_cast<uint64_t>(static_cast<double>(nanos) * ticks_per_nano());
+}
+
+double TscClock::ticks_per_nano() {
+    return use_tsc_ ? 1.0 / nanos_per_tick_.load(std::memory_order_relaxed) : 1.0;
+}
+
+void TscClock::recalibrate() {
+    if (!use_tsc_) {
+        return;
+    }
+
+    uint64_t ticks = now();
+    uint64_t nanos = monotonic_nanos();
+
+    // Measure the rate over the whole run so far; the longer the baseline,
+    // the smaller the error from the two reads not being simultaneous
+    if (ticks <= epoch_ticks_ || nanos <= epoch_nanos_) {
+        return;
+    }
+    double nanos_per_tick = static_cast<double>(nanos - epoch_nanos_) /
+                            static_cast<double>(ticks - epoch_ticks_);
+
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_ticks_.store(ticks, std::memory_order_relaxed);
+    base_nanos_.store(nanos, std::memory_order_relaxed);
+    nanos_per_tick_.store(nanos_per_tick, std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+} // namespace MessageRouter
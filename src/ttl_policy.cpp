@@ -0,0 +1,22 @@
+#include "../include/ttl_policy.h"
+#include "../include/tsc_clock.h"
+#include <cstdlib>
+
+namespace MessageRouter {
+
+TtlPolicy::TtlPolicy(const TtlConfig& config)
+    : enabled_(config.enabled) {
+    auto to_ticks = [](uint64_t ttl_us) {
+        return ttl_us == 0 ? UINT64_MAX : TscClock::nanos_to_ticks(ttl_us * 1000);
+    };
+    ttl_ticks_.fill(to_ticks(config.default_ttl_us));
+    for (const auto& [key, ttl_us] : config.ttl_us) {
+        // Keys follow producers.distribution: "msg_type_<n>"
+        int msg_type = std::atoi(key.c_str() + key.rfind('_') + 1);
+        if (msg_type >= 0 && msg_type < 256) {
+            ttl_ticks_[msg_type] = to_ticks(ttl_us);
+        }
+    }
+}
+
+} // namespace MessageRouter
@@ -0,0 +1,113 @@
+#include "../include/batch_classifier.h"
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace MessageRouter;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// A random table over num_outputs outputs; about one type in eight is unroutable
+std::array<uint32_t, 256> random_table(std::mt19937& gen, size_t num_outputs) {
+    std::uniform_int_distribution<uint32_t> output(0, static_cast<uint32_t>(num_outputs) - 1);
+    std::uniform_int_distribution<int> unroutable(0, 7);
+    std::array<uint32_t, 256> destinations;
+    for (auto& destination : destinations) {
+        destination = unroutable(gen) == 0 ? static_cast<uint32_t>(num_outputs) + output(gen) : output(gen);
+    }
+    return destinations;
+}
+
+// Every kernel the CPU supports writes what the scalar one does, including
+// the tails past the last full vector and types 128-255, which the AVX-512
+// kernel looks up in the high half of its table
+void vector_kernels_match_scalar() {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> any_type(0, 255);
+    std::vector<Message> batch(BatchClassifier::kBatchSize);
+    uint8_t expected[BatchClassifier::kBatchSize];
+    uint8_t actual[BatchClassifier::kBatchSize + 1];
+
+    for (size_t num_outputs : {1, 8, 200, 255, 256, 1000}) {
+        for (int round = 0; round < 20; ++round) {
+            const auto destinations = random_table(gen, num_outputs);
+            const BatchClassifier scalar(destinations, num_outputs, ClassifierIsa::Scalar);
+            for (ClassifierIsa isa : {ClassifierIsa::Avx2, ClassifierIsa::Avx512}) {
+                const BatchClassifier vector(destinations, num_outputs, isa);
+                if (std::strcmp(vector.kernel_name(), "scalar") == 0) {
+                    continue;   // the CPU lacks it
+                }
+                for (size_t count = 0; count <= BatchClassifier::kBatchSize; ++count) {
+                    for (size_t i = 0; i < count; ++i) {
+                        batch[i] = Message(static_cast<MessageType>(any_type(gen)), 0, i, 0);
+                    }
+                    std::memset(actual, 0xEE, sizeof(actual));
+                    scalar.classify(batch.data(), count, expected);
+                    vector.classify(batch.data(), count, actual);
+                    check(std::memcmp(expected, actual, count) == 0 && actual[count] == 0xEE,
+                          std::string(vector.kernel_name()) + " kernel matches scalar for " + std::to_string(count) +
+                              " messages over " + std::to_string(num_outputs) + " outputs");
+                }
+            }
+        }
+    }
+}
+
+// Groups map back to their outputs whatever the output count, and a
+// partition keeps every message, grouped and in arrival order
+void partition_groups_by_output() {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> any_type(0, 255);
+    std::vector<Message> batch(BatchClassifier::kBatchSize);
+    Message staging[BatchClassifier::kBatchSize];
+    uint16_t begin[BatchClassifier::kMaxGroups + 2];
+
+    for (size_t num_outputs : {8, 300, 5000}) {
+        const auto destinations = random_table(gen, num_outputs);
+        const BatchClassifier classifier(destinations, num_outputs);
+        for (size_t group = 1; group < classifier.num_groups(); ++group) {
+            check(classifier.group_output(group - 1) < classifier.group_output(group), "groups ascend by output");
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i] = Message(static_cast<MessageType>(any_type(gen)), 0, i, 0);
+        }
+        classifier.partition(batch.data(), batch.size(), staging, begin);
+        check(begin[0] == 0 && begin[classifier.num_groups() + 1] == batch.size(), "partition keeps every message");
+
+        for (size_t group = 0; group <= classifier.num_groups(); ++group) {
+            const uint32_t output = group < classifier.num_groups() ? classifier.group_output(group) : num_outputs;
+            for (size_t i = begin[group]; i < begin[group + 1]; ++i) {
+                const uint32_t expected = destinations[staging[i].msg_type] < num_outputs
+                    ? destinations[staging[i].msg_type] : static_cast<uint32_t>(num_outputs);
+                check(classifier.destination(staging[i].msg_type) == expected, "destination is the table's output");
+                check(output == expected, "message sits in its output's group");
+                check(i == begin[group] || staging[i - 1].sequence_number < staging[i].sequence_number,
+                      "group keeps arrival order");
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    vector_kernels_match_scalar();
+    partition_groups_by_output();
+    if (failures == 0) {
+        std::cout << "batch_classifier_test: passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
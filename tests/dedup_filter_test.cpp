@@ -0,0 +1,177 @@
+#include "../include/dedup_filter.h"
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+
+using namespace MessageRouter;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// What DedupFilter promises, with no bitmap: every key remembers all it
+// accepted, a sequence more than the window below the highest is too old,
+// and with capacity > 0 the keys form one LRU set of that many
+class ReferenceFilter {
+public:
+    explicit ReferenceFilter(size_t capacity) : capacity_(capacity) {}
+
+    bool accept(const Message& message) {
+        const std::pair<ProducerId, MessageType> key{message.producer_id, message.msg_type};
+        const SequenceNumber sequence = message.sequence_number;
+        touch(key);
+
+        auto it = keys_.find(key);
+        if (it == keys_.end()) {
+            keys_[key] = {sequence, {sequence}};
+            return true;
+        }
+        State& state = it->second;
+        if (sequence > state.highest) {
+            state.highest = sequence;
+            state.seen.insert(sequence);
+            return true;
+        }
+        if (state.highest - sequence >= DedupFilter::kWindowBits) {
+            ++too_old;
+            return false;
+        }
+        if (!state.seen.insert(sequence).second) {
+            ++duplicates;
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t duplicates = 0;
+    uint64_t too_old = 0;
+    uint64_t evictions = 0;
+
+private:
+    struct State {
+        SequenceNumber highest;
+        std::set<SequenceNumber> seen;
+    };
+
+    void touch(const std::pair<ProducerId, MessageType>& key) {
+        if (capacity_ == 0) {
+            return;
+        }
+        auto it = std::find(recency_.begin(), recency_.end(), key);
+        if (it != recency_.end()) {
+            recency_.erase(it);
+        } else if (recency_.size() == capacity_) {
+            keys_.erase(recency_.back());
+            recency_.pop_back();
+            ++evictions;
+        }
+        recency_.push_front(key);
+    }
+
+    size_t capacity_;
+    std::map<std::pair<ProducerId, MessageType>, State> keys_;
+    std::list<std::pair<ProducerId, MessageType>> recency_;    // most recent first
+};
+
+void expect_same(DedupFilter& filter, ReferenceFilter& reference, const Message& message, const std::string& what) {
+    const bool expected = reference.accept(message);
+    check(filter.accept(message) == expected,
+          what + ": producer " + std::to_string(message.producer_id) + " type " +
+              std::to_string(message.msg_type) + " seq " + std::to_string(message.sequence_number) +
+              (expected ? " accepted" : " rejected"));
+}
+
+// Both ends of the window and every kind of shift: within a word, exactly
+// a word, across words, to the last bit and past the whole window
+void window_boundaries() {
+    DedupFilter filter(1024);
+    ReferenceFilter reference(0);
+    const SequenceNumber base = 1000;
+    const SequenceNumber steps[] = {0, 1, 63, 64, 65, 127, 128, 200, 255, 256, 257, 1000};
+    SequenceNumber highest = base;
+    expect_same(filter, reference, Message(0, 1, base, 0), "first sequence");
+    for (SequenceNumber step : steps) {
+        highest += step;
+        expect_same(filter, reference, Message(0, 1, highest, 0), "advance by " + std::to_string(step));
+        for (SequenceNumber back : {SequenceNumber(0), SequenceNumber(1), SequenceNumber(63), SequenceNumber(64),
+                                    SequenceNumber(255), SequenceNumber(256)}) {
+            if (back <= highest) {
+                expect_same(filter, reference, Message(0, 1, highest - back, 0),
+                            "resend " + std::to_string(back) + " below after advancing " + std::to_string(step));
+            }
+        }
+    }
+    check(filter.get_duplicates() == reference.duplicates, "boundary duplicates match");
+    check(filter.get_too_old() == reference.too_old, "boundary too-old count matches");
+}
+
+// Random jumps, resends and late arrivals on a few keys that never collide
+void random_traffic() {
+    DedupFilter filter(1 << 16);
+    ReferenceFilter reference(0);
+    std::mt19937 gen(36);
+    std::uniform_int_distribution<int> key(0, 15);
+    std::uniform_int_distribution<int> action(0, 3);
+    std::uniform_int_distribution<SequenceNumber> jump(1, 300);
+    std::uniform_int_distribution<SequenceNumber> back(0, 300);
+    SequenceNumber highest[16] = {};
+
+    for (int i = 0; i < 200000; ++i) {
+        const int k = key(gen);
+        SequenceNumber sequence;
+        if (action(gen) == 0) {
+            sequence = highest[k] += jump(gen);
+        } else {
+            const SequenceNumber offset = back(gen);
+            sequence = highest[k] > offset ? highest[k] - offset : 0;
+        }
+        expect_same(filter, reference, Message(static_cast<MessageType>(k % 4), static_cast<ProducerId>(k / 4),
+                                               sequence, 0), "random traffic");
+    }
+    check(filter.get_duplicates() == reference.duplicates, "random duplicates match");
+    check(filter.get_too_old() == reference.too_old, "random too-old count matches");
+    check(filter.get_evictions() == 0, "few keys never evict");
+}
+
+// One set of kWays entries: the least recently used key loses its window,
+// so its resends are accepted again
+void lru_eviction() {
+    DedupFilter filter(DedupFilter::kWays);
+    ReferenceFilter reference(DedupFilter::kWays);
+    check(filter.get_capacity() == DedupFilter::kWays, "a single set holds kWays keys");
+    std::mt19937 gen(4);
+    std::uniform_int_distribution<int> key(0, 6);
+    std::uniform_int_distribution<SequenceNumber> sequence(0, 40);
+
+    for (int i = 0; i < 100000; ++i) {
+        const int k = key(gen);
+        expect_same(filter, reference, Message(0, static_cast<ProducerId>(k), sequence(gen), 0), "eviction");
+    }
+    check(filter.get_evictions() == reference.evictions, "evictions match");
+    check(filter.get_duplicates() == reference.duplicates, "eviction duplicates match");
+    check(filter.get_tracked_keys() == DedupFilter::kWays, "a full set tracks kWays keys");
+}
+
+} // namespace
+
+int main() {
+    window_boundaries();
+    random_traffic();
+    lru_eviction();
+    if (failures == 0) {
+        std::cout << "dedup_filter_test: passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}